@@ -0,0 +1,78 @@
+package org.apache.hadoop.fs.connector.generic;
+
+import java.io.DataInput;
+import java.io.DataOutput;
+import java.io.IOException;
+
+import org.apache.hadoop.classification.InterfaceAudience;
+import org.apache.hadoop.classification.InterfaceStability;
+import org.apache.hadoop.fs.FileChecksum;
+import org.apache.hadoop.fs.Options.ChecksumOpt;
+import org.apache.hadoop.util.DataChecksum;
+
+// CRC32C of the whole file contents. Algorithm name and byte layout follow HDFS
+// COMPOSITE_CRC mode, so checksums compare equal across both file systems.
+@InterfaceAudience.Public
+@InterfaceStability.Evolving
+public class GenericCompositeCrcFileChecksum extends FileChecksum {
+
+	public static final String ALGORITHM_NAME = "COMPOSITE-CRC32C";
+	public static final int LENGTH = 4;
+
+	private int crc;
+	private int bytesPerCrc;
+
+	public GenericCompositeCrcFileChecksum() {
+		super();
+	}
+
+	public GenericCompositeCrcFileChecksum(int crc, int bytesPerCrc) {
+		super();
+		this.crc = crc;
+		this.bytesPerCrc = bytesPerCrc;
+	}
+
+	@Override
+	public String getAlgorithmName() {
+		return ALGORITHM_NAME;
+	}
+
+	@Override
+	public int getLength() {
+		return LENGTH;
+	}
+
+	@Override
+	public byte[] getBytes() {
+
+		// Big-endian, as HDFS does
+		return new byte[] {
+			(byte) (crc >>> 24),
+			(byte) (crc >>> 16),
+			(byte) (crc >>> 8),
+			(byte) crc
+		};
+	}
+
+	@Override
+	public ChecksumOpt getChecksumOpt() {
+		return new ChecksumOpt(DataChecksum.Type.CRC32C, bytesPerCrc);
+	}
+
+	@Override
+	public void write(DataOutput out) throws IOException {
+		out.writeInt(crc);
+		out.writeInt(bytesPerCrc);
+	}
+
+	@Override
+	public void readFields(DataInput in) throws IOException {
+		crc = in.readInt();
+		bytesPerCrc = in.readInt();
+	}
+
+	@Override
+	public String toString() {
+		return getAlgorithmName() + ":" + String.format("0x%08x", crc);
+	}
+}
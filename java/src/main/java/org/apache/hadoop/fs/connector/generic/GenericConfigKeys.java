@@ -0,0 +1,101 @@
+package org.apache.hadoop.fs.connector.generic;
+
+import org.apache.hadoop.classification.InterfaceAudience;
+import org.apache.hadoop.classification.InterfaceStability;
+
+@InterfaceAudience.Public
+@InterfaceStability.Evolving
+public class GenericConfigKeys {
+
+	// Maximum number of native threads used by a single batch operation
+	public static final String THREADS_KEY = "fs.generic.threads";
+	public static final int THREADS_DEFAULT = 8;
+
+	// Backend session of each authority, shared by every instance (the first
+	// instance of an authority gives these values): helper threads of native
+	// batch operations, and bytes of native transfer buffers (0 is unlimited)
+	public static final String SESSION_THREADS_KEY = "fs.generic.session.threads";
+	public static final int SESSION_THREADS_DEFAULT = 16;
+	public static final String SESSION_BUFFER_BUDGET_KEY = "fs.generic.session.buffer.budget";
+	public static final long SESSION_BUFFER_BUDGET_DEFAULT = 256L * 1024 * 1024;
+
+	// Metadata cache, JVM-wide (a listing counts as its entries plus one; zero
+	// disables it). Entries expire after the TTL unless their directory is
+	// watched by the backend, in which case they last until it changes.
+	public static final String METADATA_CACHE_SIZE_KEY = "fs.generic.metadata.cache.size";
+	public static final int METADATA_CACHE_SIZE_DEFAULT = 0;
+	public static final String METADATA_CACHE_TTL_KEY = "fs.generic.metadata.cache.ttl";
+	public static final long METADATA_CACHE_TTL_DEFAULT = 1000L;
+	public static final String METADATA_CACHE_WATCH_KEY = "fs.generic.metadata.cache.watch";
+	public static final boolean METADATA_CACHE_WATCH_DEFAULT = true;
+
+	// Logical block size reported to Hadoop when the backend has no preference
+	public static final String BLOCK_SIZE_KEY = "fs.generic.block.size";
+	public static final long BLOCK_SIZE_DEFAULT = 128L * 1024 * 1024;
+
+	// JVM-wide cache of open read handles (requires fs_pread support)
+	public static final String HANDLE_CACHE_SIZE_KEY = "fs.generic.handle.cache.size";
+	public static final int HANDLE_CACHE_SIZE_DEFAULT = 128;
+	public static final String HANDLE_CACHE_TTL_KEY = "fs.generic.handle.cache.ttl";
+	public static final long HANDLE_CACHE_TTL_DEFAULT = 30000L;
+
+	// File checksums (composite CRC32C, comparable to HDFS COMPOSITE_CRC mode)
+	public static final String CHECKSUM_ENABLED_KEY = "fs.generic.checksum.enabled";
+	public static final boolean CHECKSUM_ENABLED_DEFAULT = false;
+	public static final String CHECKSUM_BLOCK_SIZE_KEY = "fs.generic.checksum.block.size";
+	public static final long CHECKSUM_BLOCK_SIZE_DEFAULT = 128L * 1024 * 1024;
+	public static final String CHECKSUM_CACHE_SIZE_KEY = "fs.generic.checksum.cache.size";
+	public static final int CHECKSUM_CACHE_SIZE_DEFAULT = 1024;
+
+	// Bytes per CRC reported by checksums (the HDFS key, so options match)
+	public static final String BYTES_PER_CHECKSUM_KEY = "dfs.bytes-per-checksum";
+	public static final int BYTES_PER_CHECKSUM_DEFAULT = 512;
+
+	// Entries returned by each native listing call (listings hold two pages at most)
+	public static final String LISTING_PAGE_SIZE_KEY = "fs.generic.listing.page.size";
+	public static final int LISTING_PAGE_SIZE_DEFAULT = 1000;
+
+	// Hedged reads (requires fs_pread_replica support, 0 threads disables them)
+	public static final String HEDGED_READ_THREADS_KEY = "fs.generic.hedged.read.threads";
+	public static final int HEDGED_READ_THREADS_DEFAULT = 0;
+	public static final String HEDGED_READ_PERCENTILE_KEY = "fs.generic.hedged.read.percentile";
+	public static final float HEDGED_READ_PERCENTILE_DEFAULT = 95.0f;
+	public static final String HEDGED_READ_THRESHOLD_MIN_KEY = "fs.generic.hedged.read.threshold.min";
+	public static final long HEDGED_READ_THRESHOLD_MIN_DEFAULT = 50L;
+	public static final String STRIPED_READ_THREADS_KEY = "fs.generic.striped.read.threads";
+	public static final int STRIPED_READ_THREADS_DEFAULT = 0;
+	public static final String STRIPED_READ_STRIPE_SIZE_KEY = "fs.generic.striped.read.stripe.size";
+	public static final int STRIPED_READ_STRIPE_SIZE_DEFAULT = 8 * 1024 * 1024;
+	public static final String STRIPED_WRITE_THREADS_KEY = "fs.generic.striped.write.threads";
+	public static final int STRIPED_WRITE_THREADS_DEFAULT = 0;
+	public static final String STRIPED_WRITE_STRIPE_SIZE_KEY = "fs.generic.striped.write.stripe.size";
+	public static final int STRIPED_WRITE_STRIPE_SIZE_DEFAULT = 8 * 1024 * 1024;
+	public static final String SPARSE_WRITE_KEY = "fs.generic.sparse.write";
+	public static final boolean SPARSE_WRITE_DEFAULT = true;
+	public static final String PREALLOCATE_SIZE_KEY = "fs.generic.preallocate.size";
+	public static final long PREALLOCATE_SIZE_DEFAULT = 0L;	// Disabled (-1 means the block size given to create)
+	public static final String UNBUFFER_RELEASE_HANDLE_KEY = "fs.generic.unbuffer.release.handle";
+	public static final boolean UNBUFFER_RELEASE_HANDLE_DEFAULT = true;
+	public static final String STREAM_BUFFER_MAX_KEY = "fs.generic.stream.buffer.max";
+	public static final int STREAM_BUFFER_MAX_DEFAULT = 1024 * 1024;
+
+	// Access pattern expected of input streams: adaptive, sequential or random
+	// (streams opened through openFile() may ask for another one)
+	public static final String READ_POLICY_KEY = "fs.generic.read.policy";
+	public static final String READ_POLICY_DEFAULT = "adaptive";
+
+	// Small-file packing (comma-separated roots, none by default)
+	public static final String PACK_PATHS_KEY = "fs.generic.pack.paths";
+	public static final String PACK_THRESHOLD_KEY = "fs.generic.pack.threshold";
+	public static final int PACK_THRESHOLD_DEFAULT = 64 * 1024;
+	public static final String PACK_CONTAINER_SIZE_KEY = "fs.generic.pack.container.size";
+	public static final long PACK_CONTAINER_SIZE_DEFAULT = 256L * 1024 * 1024;
+	public static final String PACK_REFRESH_INTERVAL_KEY = "fs.generic.pack.refresh.interval";
+	public static final long PACK_REFRESH_INTERVAL_DEFAULT = 5000L;
+	public static final String PACK_COMPACT_INTERVAL_KEY = "fs.generic.pack.compact.interval";
+	public static final long PACK_COMPACT_INTERVAL_DEFAULT = 10L * 60 * 1000;
+	public static final String PACK_COMPACT_RATIO_KEY = "fs.generic.pack.compact.ratio";
+	public static final float PACK_COMPACT_RATIO_DEFAULT = 0.5f;
+
+	private GenericConfigKeys() {}
+}
@@ -1,12 +1,27 @@
 package org.apache.hadoop.fs.connector.generic;
 
+import java.io.File;
 import java.io.FileNotFoundException;
 import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
 
 import java.net.URI;
 
+import java.nio.ByteBuffer;
+
+import java.util.ArrayDeque;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
+import java.util.Collections;
+import java.util.Deque;
+import java.util.EnumSet;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
 import java.util.List;
+import java.util.Map;
+import java.util.NoSuchElementException;
 
 import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
@@ -14,18 +29,35 @@ import org.apache.commons.logging.LogFactory;
 import org.apache.hadoop.classification.InterfaceAudience;
 import org.apache.hadoop.classification.InterfaceStability;
 import org.apache.hadoop.conf.Configuration;
+import org.apache.hadoop.io.IOUtils;
 import org.apache.hadoop.util.Progressable;
 import org.apache.hadoop.fs.BlockLocation;
+import org.apache.hadoop.fs.CommonConfigurationKeysPublic;
+import org.apache.hadoop.fs.ContentSummary;
+import org.apache.hadoop.fs.CreateFlag;
 import org.apache.hadoop.fs.FSDataInputStream;
 import org.apache.hadoop.fs.FSDataOutputStream;
+import org.apache.hadoop.fs.FileChecksum;
 import org.apache.hadoop.fs.FileStatus;
 import org.apache.hadoop.fs.FileSystem;
+import org.apache.hadoop.fs.LocalFileSystem;
+import org.apache.hadoop.fs.LocatedFileStatus;
 import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.PathFilter;
+import org.apache.hadoop.fs.RemoteIterator;
 import org.apache.hadoop.fs.FileAlreadyExistsException;
 import org.apache.hadoop.fs.ParentNotDirectoryException;
 import org.apache.hadoop.fs.permission.FsPermission;
+import org.apache.hadoop.fs.connector.generic.pack.GenericPackedFiles;
+import org.apache.hadoop.fs.connector.generic.pack.GenericPackedInputStream;
+import org.apache.hadoop.fs.connector.generic.pack.GenericPackedOutputStream;
+import org.apache.hadoop.fs.connector.generic.stream.GenericHandleCache;
+import org.apache.hadoop.fs.connector.generic.stream.GenericHedgedReads;
 import org.apache.hadoop.fs.connector.generic.stream.GenericInputStream;
 import org.apache.hadoop.fs.connector.generic.stream.GenericOutputStream;
+import org.apache.hadoop.fs.connector.generic.stream.GenericReadPolicy;
+import org.apache.hadoop.fs.connector.generic.stream.GenericStripedReads;
+import org.apache.hadoop.fs.connector.generic.stream.GenericStripedWrites;
 
 @InterfaceAudience.Public
 @InterfaceStability.Stable
@@ -33,8 +65,62 @@ public class GenericFileSystem extends FileSystem {
 
 	public final static Log LOG = LogFactory.getLog(GenericFileSystem.class);
 
+	// Backend capabilities (see FS_CAP_* in fs/filesystem.h)
+	public final static int CAP_PREAD = 0x1;
+	public final static int CAP_REPLICA = 0x2;
+	public final static int CAP_PWRITE = 0x4;
+	public final static int CAP_SEEK_HOLE = 0x8;
+
+	private final static PathFilter ACCEPT_ALL = new PathFilter() {
+		@Override
+		public boolean accept(Path file) {
+			return true;
+		}
+	};
+
+	static {
+
+		// Load required native library (JNI IDs are cached once, on load)
+		System.loadLibrary("generic");
+	}
+
 	private URI uri;	// Initial URI for FileSystem
+	private GenericSession session;	// Backend session of the authority (shared with streams and handles)
+	private boolean closed;	// Whether the backend reference has been released
+	private int capabilities;	// Optional features implemented by the backend
+	private boolean watching;	// Whether changes of the backend are received by the metadata cache
+	private boolean handleCache;	// Whether streams share cached handles (needs positional reads)
 	private Path workingDir;	// Current working directory
+	private int threads;	// Native threads per batch operation (read from JNI)
+	private long blockSize;	// Logical block size unless backend provides one (read from JNI)
+	private boolean checksumEnabled;	// Whether getFileChecksum computes checksums
+	private long checksumBlockSize;	// Bytes checksummed by each native thread
+	private int bytesPerChecksum;	// Bytes per CRC reported by checksums (as HDFS does)
+	private Map<Path, CachedChecksum> checksums;	// Checksums of unmodified files
+	private GenericHedgedReads hedgedReads;	// Hedging policy for streams (null if disabled)
+	private GenericStripedReads stripedReads;	// Striping policy for streams (null if disabled)
+	private GenericStripedWrites stripedWrites;	// Striping policy for created files (null if disabled)
+	private boolean sparseWrites;	// Whether created files keep runs of zeros as holes
+	private long preallocationSize;	// Storage reserved ahead of writes (-1 means the block size of each file)
+	private int stripeSize;	// Bytes fetched by each native thread in copyToLocalFile
+	private boolean releaseOnUnbuffer;	// Whether unbuffered streams give back their handle
+	private int maxBufferSize;	// Size stream buffers may grow up to
+	private GenericReadPolicy readPolicy;	// Access pattern expected of streams (unless opened with another)
+	private int listingPageSize;	// Entries per native listing call
+	private GenericPackedFiles packedFiles;	// Small files packed into containers (under configured roots only)
+
+	// Checksum together with the file version it was computed for
+	private static class CachedChecksum {
+		private final long modificationTime;
+		private final long length;
+		private final FileChecksum checksum;
+
+		private CachedChecksum(long modificationTime, long length, FileChecksum checksum) {
+			this.modificationTime = modificationTime;
+			this.length = length;
+			this.checksum = checksum;
+		}
+	}
 
 	public GenericFileSystem() {
 		super();
@@ -52,6 +138,44 @@ public class GenericFileSystem extends FileSystem {
 		return new Path(workingDir, f);
 	}
 
+	// Drops the cached checksums of a path and of everything below it (keys
+	// are compared without scheme and authority, which may or may not be given)
+	private void forgetChecksums(Path f) {
+		String path = f.toUri().getPath();
+		String prefix = path.endsWith("/") ? path : path + "/";
+
+		synchronized(checksums) {
+			for(Iterator<Path> it = checksums.keySet().iterator(); it.hasNext(); ) {
+				String key = it.next().toUri().getPath();
+
+				if(key.equals(path) || key.startsWith(prefix)) it.remove();
+			}
+		}
+	}
+
+	// Cached statuses and listings of a path (and of everything below it) no
+	// longer match, nor do those of its parents if they may have been created
+	private void forgetStatuses(Path f, boolean parents) {
+		GenericMetadataCache.get().invalidate(f, true);
+		for(Path p = f.getParent(); parents && p != null; p = p.getParent()) GenericMetadataCache.get().invalidate(p, false);
+	}
+
+	// Output stream whose file is forgotten by the metadata cache once closed
+	// (as its length and times change while it is written)
+	private FSDataOutputStream forgetOnClose(OutputStream out, final Path f) throws IOException {
+		return new FSDataOutputStream(out) {
+			@Override
+			public void close() throws IOException {
+				try {
+					super.close();
+				}
+				finally {
+					forgetStatuses(f, false);
+				}
+			}
+		};
+	}
+
 	@Override
 	public void initialize(URI uri, Configuration conf) throws IOException {
 		LOG.debug("Initializing filesystem");
@@ -59,12 +183,79 @@ public class GenericFileSystem extends FileSystem {
 		super.initialize(uri, conf);
 		this.uri = uri;
 		this.workingDir = new Path(uri);
+		this.threads = Math.max(1, conf.getInt(GenericConfigKeys.THREADS_KEY, GenericConfigKeys.THREADS_DEFAULT));
+		this.blockSize = conf.getLong(GenericConfigKeys.BLOCK_SIZE_KEY, GenericConfigKeys.BLOCK_SIZE_DEFAULT);
+		if(this.blockSize <= 0) throw new IllegalArgumentException(GenericConfigKeys.BLOCK_SIZE_KEY + " must be positive");
+		this.checksumEnabled = conf.getBoolean(GenericConfigKeys.CHECKSUM_ENABLED_KEY, GenericConfigKeys.CHECKSUM_ENABLED_DEFAULT);
+		this.checksumBlockSize = Math.max(1L, conf.getLong(GenericConfigKeys.CHECKSUM_BLOCK_SIZE_KEY, GenericConfigKeys.CHECKSUM_BLOCK_SIZE_DEFAULT));
+		this.bytesPerChecksum = conf.getInt(GenericConfigKeys.BYTES_PER_CHECKSUM_KEY, GenericConfigKeys.BYTES_PER_CHECKSUM_DEFAULT);
+		this.listingPageSize = Math.max(1, conf.getInt(GenericConfigKeys.LISTING_PAGE_SIZE_KEY, GenericConfigKeys.LISTING_PAGE_SIZE_DEFAULT));
+		this.releaseOnUnbuffer = conf.getBoolean(GenericConfigKeys.UNBUFFER_RELEASE_HANDLE_KEY, GenericConfigKeys.UNBUFFER_RELEASE_HANDLE_DEFAULT);
+		this.maxBufferSize = Math.max(1, conf.getInt(GenericConfigKeys.STREAM_BUFFER_MAX_KEY, GenericConfigKeys.STREAM_BUFFER_MAX_DEFAULT));
+		this.readPolicy = GenericReadPolicy.fromString(conf.get(GenericConfigKeys.READ_POLICY_KEY), GenericReadPolicy.fromString(GenericConfigKeys.READ_POLICY_DEFAULT, null));
+
+		// LRU cache of computed checksums
+		final int checksumCacheSize = conf.getInt(GenericConfigKeys.CHECKSUM_CACHE_SIZE_KEY, GenericConfigKeys.CHECKSUM_CACHE_SIZE_DEFAULT);
+		this.checksums = new LinkedHashMap<Path, CachedChecksum>(16, 0.75f, true) {
+			@Override
+			protected boolean removeEldestEntry(Map.Entry<Path, CachedChecksum> eldest) {
+				return size() > checksumCacheSize;
+			}
+		};
+
+		// Open backend session (Expand Library, once per authority)
+		this.session = GenericSession.open(uri.getAuthority() == null ? "" : uri.getAuthority(),
+			conf.getInt(GenericConfigKeys.SESSION_THREADS_KEY, GenericConfigKeys.SESSION_THREADS_DEFAULT),
+			conf.getLong(GenericConfigKeys.SESSION_BUFFER_BUDGET_KEY, GenericConfigKeys.SESSION_BUFFER_BUDGET_DEFAULT));
+		this.capabilities = session.getCapabilities();
+
+		// Statuses and listings are cached JVM-wide, and kept while unchanged if
+		// the backend notifies changes
+		GenericMetadataCache.get().configure(
+			conf.getInt(GenericConfigKeys.METADATA_CACHE_SIZE_KEY, GenericConfigKeys.METADATA_CACHE_SIZE_DEFAULT),
+			conf.getLong(GenericConfigKeys.METADATA_CACHE_TTL_KEY, GenericConfigKeys.METADATA_CACHE_TTL_DEFAULT));
+		this.watching = GenericMetadataCache.get().isEnabled() && conf.getBoolean(GenericConfigKeys.METADATA_CACHE_WATCH_KEY, GenericConfigKeys.METADATA_CACHE_WATCH_DEFAULT);
+		if(watching) GenericMetadataCache.get().attach(session);
+
+		// Handles are shared between streams through positional reads only, so
+		// instances without them neither use nor configure the cache
+		int handleCacheSize = conf.getInt(GenericConfigKeys.HANDLE_CACHE_SIZE_KEY, GenericConfigKeys.HANDLE_CACHE_SIZE_DEFAULT);
+		this.handleCache = (capabilities & CAP_PREAD) != 0 && handleCacheSize > 0;
+		if(handleCache) GenericHandleCache.get().configure(handleCacheSize, conf.getLong(GenericConfigKeys.HANDLE_CACHE_TTL_KEY, GenericConfigKeys.HANDLE_CACHE_TTL_DEFAULT));
+
+		// Reads are hedged on another replica only if the backend can address them
+		int hedgedThreads = conf.getInt(GenericConfigKeys.HEDGED_READ_THREADS_KEY, GenericConfigKeys.HEDGED_READ_THREADS_DEFAULT);
+		if((capabilities & CAP_REPLICA) != 0 && hedgedThreads > 0) {
+			this.hedgedReads = new GenericHedgedReads(hedgedThreads,
+				conf.getFloat(GenericConfigKeys.HEDGED_READ_PERCENTILE_KEY, GenericConfigKeys.HEDGED_READ_PERCENTILE_DEFAULT),
+				conf.getLong(GenericConfigKeys.HEDGED_READ_THRESHOLD_MIN_KEY, GenericConfigKeys.HEDGED_READ_THRESHOLD_MIN_DEFAULT));
+		}
 
-		// Load required native library
-		System.loadLibrary("generic");
+		// Sequential reads are striped over positional reads only
+		int stripedThreads = conf.getInt(GenericConfigKeys.STRIPED_READ_THREADS_KEY, GenericConfigKeys.STRIPED_READ_THREADS_DEFAULT);
+		this.stripeSize = Math.max(1, conf.getInt(GenericConfigKeys.STRIPED_READ_STRIPE_SIZE_KEY, GenericConfigKeys.STRIPED_READ_STRIPE_SIZE_DEFAULT));
+		if((capabilities & CAP_PREAD) != 0 && stripedThreads > 0) this.stripedReads = new GenericStripedReads(stripedThreads, stripeSize);
 
-		// Initialize connector (JNI IDs and Expand Library)
-		initConnector();
+		// Created files are striped over positional writes only
+		stripedThreads = conf.getInt(GenericConfigKeys.STRIPED_WRITE_THREADS_KEY, GenericConfigKeys.STRIPED_WRITE_THREADS_DEFAULT);
+		if((capabilities & CAP_PWRITE) != 0 && stripedThreads > 0) {
+			this.stripedWrites = new GenericStripedWrites(stripedThreads,
+				Math.max(1, conf.getInt(GenericConfigKeys.STRIPED_WRITE_STRIPE_SIZE_KEY, GenericConfigKeys.STRIPED_WRITE_STRIPE_SIZE_DEFAULT)));
+		}
+
+		// Holes are only left where the backend can tell them apart
+		this.sparseWrites = (capabilities & CAP_SEEK_HOLE) != 0 && conf.getBoolean(GenericConfigKeys.SPARSE_WRITE_KEY, GenericConfigKeys.SPARSE_WRITE_DEFAULT);
+
+		this.preallocationSize = conf.getLong(GenericConfigKeys.PREALLOCATE_SIZE_KEY, GenericConfigKeys.PREALLOCATE_SIZE_DEFAULT);
+
+		// Small files are packed under the configured roots only
+		this.packedFiles = new GenericPackedFiles(this, conf.getTrimmedStringCollection(GenericConfigKeys.PACK_PATHS_KEY),
+			conf.getInt(GenericConfigKeys.PACK_THRESHOLD_KEY, GenericConfigKeys.PACK_THRESHOLD_DEFAULT),
+			conf.getLong(GenericConfigKeys.PACK_CONTAINER_SIZE_KEY, GenericConfigKeys.PACK_CONTAINER_SIZE_DEFAULT),
+			conf.getLong(GenericConfigKeys.PACK_REFRESH_INTERVAL_KEY, GenericConfigKeys.PACK_REFRESH_INTERVAL_DEFAULT),
+			conf.getLong(GenericConfigKeys.PACK_COMPACT_INTERVAL_KEY, GenericConfigKeys.PACK_COMPACT_INTERVAL_DEFAULT),
+			conf.getFloat(GenericConfigKeys.PACK_COMPACT_RATIO_KEY, GenericConfigKeys.PACK_COMPACT_RATIO_DEFAULT),
+			this.blockSize);
 
 		return;
 	}
@@ -73,8 +264,30 @@ public class GenericFileSystem extends FileSystem {
 	public void close() throws IOException {
 		LOG.debug("Closing filesystem");
 
-		// Destroy connector (JNI Global References and Expand Library)
-		destConnector();
+		// Release backend only once per instance (and only if initialized)
+		synchronized(this) {
+			if(closed || this.session == null) return;
+			closed = true;
+		}
+
+		// Process pending deletions and remove instance from cache
+		try {
+			super.close();
+		}
+		finally {
+
+			// Containers being written get their index
+			if(packedFiles != null) packedFiles.shutdown();
+
+			// Open streams keep working, reading from the calling thread
+			if(hedgedReads != null) hedgedReads.shutdown();
+			if(stripedReads != null) stripedReads.shutdown();
+			if(stripedWrites != null) stripedWrites.shutdown();
+
+			// Release backend session (destroyed once its last user is gone)
+			if(watching) GenericMetadataCache.get().detach(session);
+			session.release();
+		}
 
 		return;
 	}
@@ -86,6 +299,12 @@ public class GenericFileSystem extends FileSystem {
 		return this.uri;
 	}
 
+	// Counters of the backend session (calls, bytes moved, buffer budget and
+	// its waits, threads), shared by every instance of the same authority
+	public Map<String, Long> getSessionMetrics() {
+		return session.getMetrics();
+	}
+
 	@Override
 	public Path getWorkingDirectory() {
 		LOG.debug("Get working directory " + this.workingDir);
@@ -112,8 +331,12 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Set owner for " + f + " to " + username + " and group to " + groupname);
 
+		// Packed files belong to the owner of their container
+		if(packedFiles.getFileStatus(f) != null) return;
+
 		// Set ownership
-		setOwner0(f, username, groupname);
+		setOwner0(session.getHandle(), f, username, groupname);
+		GenericMetadataCache.get().invalidate(f, false);
 
 		return;
 	}
@@ -126,12 +349,22 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Set permissions for " + f + " to " + permission);
 
+		// Packed files have the permissions of their container
+		if(packedFiles.getFileStatus(f) != null) return;
+
 		// Apply permissions
-		setPermission0(f, permission.toShort());
+		setPermission0(session.getHandle(), f, permission.toShort());
+		GenericMetadataCache.get().invalidate(f, false);
 
 		return;
 	}
 
+	@Override
+	@Deprecated
+	public long getDefaultBlockSize() {
+		return this.blockSize;
+	}
+
 	@Override
 	public BlockLocation[] getFileBlockLocations(FileStatus file, long start, long len) throws IOException {
 		LOG.debug("Get block location for " + file.getPath() + "[start: " + start + ", len: " + len + "]");
@@ -149,31 +382,139 @@ public class GenericFileSystem extends FileSystem {
 			return new BlockLocation[0];
 		}
 
-		return getFileBlockLocations0(file, start, len);
+		// Packed files are located within their container
+		if(file.isFile() && packedFiles.isPacked(file.getPath()) && packedFiles.getFileStatus(file.getPath()) != null) return packedFiles.getFileBlockLocations(file, start, len);
+
+		return getFileBlockLocations0(session.getHandle(), file, start, len);
 	}
 
 	@Override
-	public FSDataInputStream open(Path f, int bufferSize) throws IOException {
-		GenericInputStream in;
+	public FileChecksum getFileChecksum(Path f, long length) throws IOException {
 		FileStatus stat;
+		FileChecksum checksum;
+		CachedChecksum cached;
+		boolean whole;
+
+		// Checksums are opt-in, as they require reading the whole file
+		if(!checksumEnabled) return null;
 
 		// Compose absolute path
 		f = makeAbsolute(f);
 
-		LOG.debug("Open file " + f);
+		LOG.debug("Get checksum for " + f + " [length: " + length + "]");
 
 		// If file doesn't exists, throw exception
 		stat = getFileStatus(f);
 
 		// If file is directory, throw exception
-		if(stat.isDirectory()) throw new FileNotFoundException("open() cannot open directories");
+		if(stat.isDirectory()) throw new FileNotFoundException("getFileChecksum() cannot checksum directories");
 
-		// Create stream
-		in = new GenericInputStream(f, stat.getLen(), statistics);
+		// Packed files are not files of the backend, so they have no checksum
+		if(packedFiles.isPacked(f) && packedFiles.getFileStatus(f) != null) return null;
+
+		// Only whole-file checksums are cached
+		length = Math.min(length, stat.getLen());
+		whole = length == stat.getLen();
+
+		// Reuse checksum if file has not changed since it was computed
+		if(whole) {
+			synchronized(checksums) {
+				cached = checksums.get(f);
+			}
+			if(cached != null && cached.modificationTime == stat.getModificationTime() && cached.length == stat.getLen()) return cached.checksum;
+		}
+
+		// Compute composite CRC through native threads
+		checksum = new GenericCompositeCrcFileChecksum(getFileChecksum0(session.getHandle(), f, length, checksumBlockSize), bytesPerChecksum);
+
+		if(whole) {
+			synchronized(checksums) {
+				checksums.put(f, new CachedChecksum(stat.getModificationTime(), stat.getLen(), checksum));
+			}
+		}
+
+		return checksum;
+	}
+
+	@Override
+	public FSDataInputStream open(Path f, int bufferSize) throws IOException {
+		return open(f, bufferSize, readPolicy, -1L, 0L, Long.MAX_VALUE);
+	}
+
+	// Opens a file whose status is already known by the caller (for example from
+	// a previous listing), skipping the stat done by open(Path, int)
+	public FSDataInputStream open(FileStatus status, int bufferSize) throws IOException {
+		return open(status, bufferSize, readPolicy, 0L, Long.MAX_VALUE);
+	}
+
+	// Opens a file to be read with the given policy (the default one if null),
+	// within the given range. The stat is skipped if the caller knows the
+	// length (and handles aren't cached).
+	FSDataInputStream open(Path f, int bufferSize, GenericReadPolicy policy, long length, long splitStart, long splitEnd) throws IOException {
+		GenericInputStream in;
+		byte[] data;
+
+		if(policy == null) policy = readPolicy;
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("Open file " + f + " with read policy " + policy);
+
+		// Packed files are read whole from their container
+		if((data = packedFiles.read(f)) != null) return new FSDataInputStream(new GenericPackedInputStream(data, statistics));
+
+		// Cached handles are validated against the current file status
+		if(handleCache && GenericHandleCache.get().isEnabled()) return open(getFileStatus(f), bufferSize, policy, splitStart, splitEnd);
+
+		// Create stream (open and stat in a single native call, which throws if
+		// file doesn't exist or is a directory)
+		if(length >= 0) in = new GenericInputStream(session, f, length, statistics);
+		else in = new GenericInputStream(session, f, statistics);
+
+		return configure(in, bufferSize, policy, splitStart, splitEnd);
+	}
+
+	private FSDataInputStream open(FileStatus status, int bufferSize, GenericReadPolicy policy, long splitStart, long splitEnd) throws IOException {
+		GenericInputStream in;
+		byte[] data;
+		Path f;
+
+		// Compose absolute path
+		f = makeAbsolute(status.getPath());
+
+		LOG.debug("Open file " + f + " with known status");
+
+		// If file is directory, throw exception
+		if(status.isDirectory()) throw new FileNotFoundException("open() cannot open directories");
+
+		// Packed files are read whole from their container
+		if((data = packedFiles.read(f)) != null) return new FSDataInputStream(new GenericPackedInputStream(data, statistics));
+
+		// Create stream (sharing a cached handle if possible)
+		if(handleCache && GenericHandleCache.get().isEnabled()) in = new GenericInputStream(session, f, GenericHandleCache.get().acquire(session, f, status), statistics);
+		else in = new GenericInputStream(session, f, status.getLen(), statistics);
+
+		return configure(in, bufferSize, policy, splitStart, splitEnd);
+	}
+
+	// Applies the stream policies of this instance
+	private FSDataInputStream configure(GenericInputStream in, int bufferSize, GenericReadPolicy policy, long splitStart, long splitEnd) {
+		if((capabilities & CAP_REPLICA) != 0) in.enableReplicaReads(hedgedReads);
+		if(stripedReads != null) in.enableStripedReads(stripedReads);
+		in.setReleaseOnUnbuffer(releaseOnUnbuffer);
+		in.setBufferSize(bufferSize, maxBufferSize);
+		in.setReadPolicy(policy, splitStart, splitEnd);
 
 		return new FSDataInputStream(in);
 	}
 
+	// Builder of streams opened with Hadoop 3 openFile() options (read policy,
+	// known length, split range), as in FileSystem.openFile(path).opt(...).build()
+	public GenericOpenFileBuilder openFile(Path f) {
+		return new GenericOpenFileBuilder(this, f, getConf().getInt(CommonConfigurationKeysPublic.IO_FILE_BUFFER_SIZE_KEY, CommonConfigurationKeysPublic.IO_FILE_BUFFER_SIZE_DEFAULT));
+	}
+
 	@Override
 	public FSDataOutputStream append(Path f, int bufferSize, Progressable progress) throws IOException {
 		GenericOutputStream out;
@@ -184,21 +525,30 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Append to file " + f);
 
+		// Cached checksum (if any) no longer matches
+		forgetChecksums(f);
+
 		// If file doesn't exists, throw exception
 		stat = getFileStatus(f);
 
 		// If file is directory, throw exception
 		if(stat.isDirectory()) throw new FileNotFoundException("open() cannot open directories");
 
+		// Packed files are written out as regular files to be appended to
+		unpack(f);
+
 		// Create stream
-		out = new GenericOutputStream(f, statistics);
+		out = new GenericOutputStream(session, f, statistics);
+		out.setBufferSize(bufferSize, maxBufferSize);
 
-		return new FSDataOutputStream(out);
+		return forgetOnClose(out, f);
 	}
 
 	@Override
-	public FSDataOutputStream create(Path f, FsPermission permission, boolean overwrite, int bufferSize, short replication, long blockSize, Progressable progress) throws IOException {
+	public FSDataOutputStream create(Path f, final FsPermission permission, final boolean overwrite, final int bufferSize, short replication, long blockSize, Progressable progress) throws IOException {
+		final long preallocation = preallocationSize < 0 ? blockSize : preallocationSize;
 		GenericOutputStream out;
+		final Path path;
 		Path parent;
 
 		// Compose absolute path
@@ -206,6 +556,9 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Create file " + f + " with permissions " + permission + " and with overwrite=" + overwrite);
 
+		// Cached checksum (if any) no longer matches
+		forgetChecksums(f);
+
 		// If overwrite not set and file exists, throw error
 		if(!overwrite) {
 			try {
@@ -218,13 +571,289 @@ public class GenericFileSystem extends FileSystem {
 		// Get file container folder
 		parent = f.getParent();
 
+		// Small files under packing roots are packed on close (their parents are
+		// only created once per instance)
+		if(packedFiles.isPacked(f)) {
+			if(!packedFiles.isKnownDirectory(parent)) {
+				mkdirs(parent);
+				packedFiles.addKnownDirectory(parent);
+			}
+			path = f;
+			return new FSDataOutputStream(new GenericPackedOutputStream(packedFiles, f, statistics) {
+				@Override
+				protected OutputStream spill() throws IOException {
+					GenericOutputStream out;
+
+					packedFiles.delete(path, false);
+					out = new GenericOutputStream(session, path, permission, overwrite, stripedWrites, statistics);
+					out.setBufferSize(bufferSize, maxBufferSize);
+					out.setSparse(sparseWrites);
+					out.setPreallocation(preallocation);
+					return out;
+				}
+			});
+		}
+
 		// The folders shall be created with the default permissions
 		if(parent != null) mkdirs(parent);
 
 		// Create ConnectorNOutputStream in CREATE mode after creating all required directories
-		out = new GenericOutputStream(f, permission, overwrite, statistics);
+		out = new GenericOutputStream(session, f, permission, overwrite, stripedWrites, statistics);
+		out.setBufferSize(bufferSize, maxBufferSize);
+		out.setSparse(sparseWrites);
+		out.setPreallocation(preallocation);
+		forgetStatuses(f, false);
 
-		return new FSDataOutputStream(out);
+		return forgetOnClose(out, f);
+	}
+
+	// Fails as rename0 (POSIX rename) would for a packed file moved to dst: a
+	// directory cannot be replaced by a file, and the parent must exist
+	private void checkPackedRename(Path src, Path dst) throws IOException {
+		FileStatus status;
+
+		try {
+			status = getFileStatus(dst);
+		}
+		catch(FileNotFoundException e) {
+			status = null;
+		}
+		if(status != null && status.isDirectory()) throw new IOException("Cannot rename file " + src + " over directory " + dst);
+		if(dst.getParent() == null) throw new IOException("Cannot rename file " + src + " to the root directory");
+
+		try {
+			status = getFileStatus(dst.getParent());
+		}
+		catch(FileNotFoundException e) {
+			throw new FileNotFoundException("Cannot rename file " + src + " to " + dst + ", parent directory does not exist");
+		}
+		if(!status.isDirectory()) throw new IOException("Cannot rename file " + src + " to " + dst + ", parent is not a directory");
+	}
+
+	// Writes a packed file out as a regular file, which replaces it, so that it
+	// can be appended to
+	private void unpack(Path f) throws IOException {
+		byte[] data;
+
+		if((data = packedFiles.read(f)) == null) return;
+
+		LOG.debug("Unpack file " + f + " to append to it");
+
+		writeFile(f, ByteBuffer.wrap(data), EnumSet.of(CreateFlag.CREATE, CreateFlag.OVERWRITE), false);
+		packedFiles.delete(f, false);
+	}
+
+	// Writes a whole (small) file in a single native call: missing parents are
+	// created, and the file is opened, written and closed without further
+	// crossings. Flags follow create semantics: CREATE alone fails if the file
+	// exists, OVERWRITE truncates it and APPEND adds to it.
+	public void writeFile(Path f, byte[] data, EnumSet<CreateFlag> flags) throws IOException {
+		writeFile(f, ByteBuffer.wrap(data), flags);
+	}
+
+	// Writes the remaining bytes of the buffer (direct buffers are not copied)
+	// and advances its position
+	public void writeFile(Path f, ByteBuffer data, EnumSet<CreateFlag> flags) throws IOException {
+		writeFile(f, data, flags, true);
+	}
+
+	private void writeFile(Path f, ByteBuffer data, EnumSet<CreateFlag> flags, boolean pack) throws IOException {
+		FsPermission permission, dirPermission;
+		byte[] packed;
+		Path parent;
+		int len;
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("Write file " + f + " with " + data.remaining() + "B and flags " + flags);
+
+		// Cached checksum (if any) no longer matches
+		forgetChecksums(f);
+
+		// Small files under packing roots are packed (unless appended to)
+		if(pack && !flags.contains(CreateFlag.APPEND) && data.remaining() <= packedFiles.getThreshold() && packedFiles.isPacked(f)) {
+			if(!flags.contains(CreateFlag.OVERWRITE)) {
+				try {
+					getFileStatus(f);
+					throw new FileAlreadyExistsException("File " + f + " already exists");
+				}
+				catch(FileNotFoundException e) {}
+			}
+			parent = f.getParent();
+			if(!packedFiles.isKnownDirectory(parent)) {
+				mkdirs(parent);
+				packedFiles.addKnownDirectory(parent);
+			}
+
+			len = data.remaining();
+			packed = new byte[len];
+			data.get(packed);
+			packedFiles.write(f, packed, len);
+
+			statistics.incrementBytesWritten(len);
+			statistics.incrementWriteOps(1);
+			return;
+		}
+
+		// Regular files replace packed files of the same name (as spilled streams
+		// do), except for appends, which need their contents first
+		if(pack && packedFiles.isPacked(f)) {
+			if(flags.contains(CreateFlag.APPEND)) unpack(f);
+			else if(packedFiles.getFileStatus(f) != null) {
+				if(!flags.contains(CreateFlag.OVERWRITE)) throw new FileAlreadyExistsException("File " + f + " already exists");
+				packedFiles.delete(f, false);
+			}
+		}
+
+		// Default permissions, as create(Path) and mkdirs(Path) would use
+		permission = FsPermission.getFileDefault().applyUMask(FsPermission.getUMask(getConf()));
+		dirPermission = FsPermission.getDirDefault();
+
+		len = data.remaining();
+		if(data.isDirect()) writeFile0(session.getHandle(), f, null, data, data.position(), len, flags.contains(CreateFlag.CREATE), flags.contains(CreateFlag.OVERWRITE), flags.contains(CreateFlag.APPEND), permission.toShort(), dirPermission.toShort());
+		else writeFile0(session.getHandle(), f, data.array(), null, data.arrayOffset() + data.position(), len, flags.contains(CreateFlag.CREATE), flags.contains(CreateFlag.OVERWRITE), flags.contains(CreateFlag.APPEND), permission.toShort(), dirPermission.toShort());
+		data.position(data.limit());
+		forgetStatuses(f, true);
+
+		statistics.incrementBytesWritten(len);
+		statistics.incrementWriteOps(1);
+	}
+
+	// Reads a whole (small) file in a single native call. Files larger than
+	// maxLen are rejected instead of truncated.
+	public byte[] readFile(Path f, int maxLen) throws IOException {
+		byte[] data;
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("Read file " + f + " up to " + maxLen + "B");
+
+		if(maxLen < 0 || maxLen == Integer.MAX_VALUE) throw new IllegalArgumentException("Invalid maxLen parameter");
+
+		data = packedFiles.read(f);
+		if(data != null && data.length > maxLen) throw new IOException("readFile: file is larger than " + maxLen + " bytes");
+		if(data == null) data = readFile0(session.getHandle(), f, maxLen);
+
+		statistics.incrementBytesRead(data.length);
+		statistics.incrementReadOps(1);
+		return data;
+	}
+
+	// Uploads a single local file through a stream that knows its final length,
+	// so that the backend reserves the whole file at once
+	@Override
+	public void copyFromLocalFile(boolean delSrc, boolean overwrite, Path src, Path dst) throws IOException {
+		LocalFileSystem local;
+		FileStatus status;
+		FSDataOutputStream out;
+		InputStream in;
+
+		// Directories (and copies without preallocation) go through the generic copy
+		local = getLocal(getConf());
+		status = local.getFileStatus(src);
+		if(status.isDirectory() || preallocationSize == 0) {
+			super.copyFromLocalFile(delSrc, overwrite, src, dst);
+			return;
+		}
+
+		// Destination may be an existing directory
+		dst = makeAbsolute(dst);
+		try {
+			if(getFileStatus(dst).isDirectory()) dst = new Path(dst, src.getName());
+		}
+		catch(FileNotFoundException e) {}
+
+		LOG.debug("Copy local file " + src + " to " + dst);
+
+		in = local.open(src);
+		try {
+			out = create(dst, overwrite);
+		}
+		catch(IOException e) {
+			IOUtils.closeStream(in);
+			throw e;
+		}
+		try {
+			if(out.getWrappedStream() instanceof GenericOutputStream) ((GenericOutputStream) out.getWrappedStream()).setExpectedLength(status.getLen());
+		}
+		catch(IOException e) {
+			IOUtils.closeStream(out);
+			IOUtils.closeStream(in);
+			throw e;
+		}
+		IOUtils.copyBytes(in, out, getConf(), true);
+
+		if(delSrc) local.delete(src, false);
+	}
+
+	// Downloads a file by stripes, read from several native threads and written
+	// in place into the local file (no checksum file is written for the copy).
+	// Only data is copied: holes of the source stay holes of the local file.
+	@Override
+	public void copyToLocalFile(boolean delSrc, Path src, Path dst, boolean useRawLocalFileSystem) throws IOException {
+		LocalFileSystem local;
+		FileStatus status;
+		File file, crc;
+
+		// Compose absolute path
+		src = makeAbsolute(src);
+
+		// Directories, packed files and backends without positional reads go
+		// through streams
+		if((capabilities & CAP_PREAD) == 0 || packedFiles.isPacked(src)) {
+			super.copyToLocalFile(delSrc, src, dst, useRawLocalFileSystem);
+			return;
+		}
+		status = getFileStatus(src);
+		if(status.isDirectory()) {
+			super.copyToLocalFile(delSrc, src, dst, useRawLocalFileSystem);
+			return;
+		}
+
+		LOG.debug("Copy file " + src + " to local " + dst);
+
+		// Resolve local destination (which may be an existing directory)
+		local = getLocal(getConf());
+		file = local.pathToFile(dst);
+		if(file.isDirectory()) file = new File(file, src.getName());
+		if(file.getParentFile() != null && !file.getParentFile().isDirectory() && !file.getParentFile().mkdirs()) throw new IOException("Mkdirs failed to create " + file.getParent());
+
+		copyToLocal0(session.getHandle(), src, file.getAbsolutePath(), stripeSize);
+
+		// Stale checksum of a previous copy would fail later checked reads
+		crc = local.pathToFile(local.getChecksumFile(new Path(file.toURI())));
+		if(crc.exists() && !crc.delete()) throw new IOException("Cannot delete stale checksum " + crc);
+
+		if(delSrc) delete(src, false);
+	}
+
+	// Data of a file as {offset, length} pairs in order, so that copies of
+	// sparse files can skip their holes. Unless the backend reports
+	// CAP_SEEK_HOLE, a file is a single range (none if empty).
+	public long[][] getDataRanges(Path f) throws IOException {
+		FileStatus status;
+		long[][] ranges;
+		long[] pairs;
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("Get data ranges of file " + f);
+
+		if((capabilities & CAP_SEEK_HOLE) == 0 || packedFiles.getFileStatus(f) != null) {
+			status = getFileStatus(f);
+			if(status.isDirectory()) throw new FileNotFoundException(f + " is a directory");
+			return status.getLen() == 0 ? new long[0][] : new long[][] {{0L, status.getLen()}};
+		}
+
+		pairs = getDataRanges0(session.getHandle(), f);
+		ranges = new long[pairs.length / 2][];
+		for(int i = 0; i < ranges.length; i++) ranges[i] = new long[] {pairs[2 * i], pairs[2 * i + 1]};
+		statistics.incrementReadOps(1);
+
+		return ranges;
 	}
 
 	@Override
@@ -236,7 +865,31 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Rename " + src + " to " + dst);
 
-		return rename0(src, dst);
+		// Renamed trees may carry cached checksums and statuses
+		forgetChecksums(src);
+		forgetChecksums(dst);
+		try {
+			if(!packedFiles.covers(src) && !packedFiles.covers(dst)) return rename0(session.getHandle(), src, dst);
+
+			// Packed files are moved record by record (containers cannot be)
+			packedFiles.forgetDirectories();
+			if(packedFiles.holdsRoot(src)) throw new IOException("Cannot rename " + src + ", which holds packed files");
+			if(Path.getPathWithoutSchemeAndAuthority(src).equals(Path.getPathWithoutSchemeAndAuthority(dst))) return exists(src);
+			if(packedFiles.getFileStatus(src) != null) {
+				checkPackedRename(src, dst);
+				packedFiles.move(src, dst);
+				return true;
+			}
+			if(!rename0(session.getHandle(), src, dst)) return false;
+			if(packedFiles.getFileStatus(dst) != null) packedFiles.delete(dst, false);
+			packedFiles.move(src, dst);
+
+			return true;
+		}
+		finally {
+			forgetStatuses(src, false);
+			forgetStatuses(dst, false);
+		}
 	}
 
 	@Override
@@ -247,43 +900,404 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Delete " + f + " with recursive=" + recursive);
 
-		return delete0(f, recursive);
+		// Deleted trees may carry cached checksums and statuses
+		forgetChecksums(f);
+		try {
+			if(!packedFiles.covers(f)) return delete0(session.getHandle(), f, recursive);
+
+			// Packed files are deleted by appending records (along with any regular
+			// file they replaced), unless their containers are deleted as well
+			packedFiles.forgetDirectories();
+			if(packedFiles.holdsRoot(f)) return delete0(session.getHandle(), f, recursive);
+			if(packedFiles.getFileStatus(f) != null) {
+				packedFiles.delete(f, false);
+				try {
+					delete0(session.getHandle(), f, false);
+				}
+				catch(IOException e) {} // No regular file was replaced
+				return true;
+			}
+			packedFiles.delete(f, recursive);
+
+			return delete0(session.getHandle(), f, recursive);
+		}
+		finally {
+			forgetStatuses(f, false);
+		}
+	}
+
+	// Renames every source to its destination with a single native call. Parent
+	// directories of the destinations must exist, and no fs_stat is issued. The
+	// result maps each source to null (renamed) or to its own error.
+	public Map<Path, IOException> renameBatch(Path[] srcs, Path[] dsts) throws IOException {
+		Map<Path, IOException> results;
+		IOException[] errors;
+		Path[] absoluteSrcs, absoluteDsts;
+
+		if(srcs.length != dsts.length) throw new IllegalArgumentException("renameBatch() needs one destination per source");
+
+		// Compose absolute paths
+		absoluteSrcs = new Path[srcs.length];
+		absoluteDsts = new Path[dsts.length];
+		for(int i = 0; i < srcs.length; i++) {
+			absoluteSrcs[i] = makeAbsolute(srcs[i]);
+			absoluteDsts[i] = makeAbsolute(dsts[i]);
+		}
+
+		LOG.debug("Rename " + srcs.length + " paths");
+
+		// Renamed trees may carry cached checksums
+		for(int i = 0; i < absoluteSrcs.length; i++) {
+			forgetChecksums(absoluteSrcs[i]);
+			forgetChecksums(absoluteDsts[i]);
+		}
+
+		// Packed files are renamed one at a time
+		if(packedFiles.isEnabled()) {
+			for(int i = 0; i < absoluteSrcs.length; i++) {
+				if(packedFiles.covers(absoluteSrcs[i]) || packedFiles.covers(absoluteDsts[i])) return renameEach(absoluteSrcs, absoluteDsts);
+			}
+		}
+
+		try {
+			errors = renameBatch0(session.getHandle(), absoluteSrcs, absoluteDsts);
+		}
+		finally {
+			for(int i = 0; i < absoluteSrcs.length; i++) {
+				forgetStatuses(absoluteSrcs[i], false);
+				forgetStatuses(absoluteDsts[i], false);
+			}
+		}
+
+		// Keep results in the same order as the request
+		results = new LinkedHashMap<Path, IOException>();
+		for(int i = 0; i < absoluteSrcs.length; i++) results.put(absoluteSrcs[i], errors[i]);
+
+		return results;
+	}
+
+	// Deletes every path with a single native call. Instead of failing the whole
+	// batch, the result maps each path to null (deleted) or to its own error.
+	public Map<Path, IOException> deleteBatch(Collection<Path> paths) throws IOException {
+		return deleteBatch(paths, false);
+	}
+
+	public Map<Path, IOException> deleteBatch(Collection<Path> paths, boolean recursive) throws IOException {
+		Map<Path, IOException> results;
+		IOException[] errors;
+		Path[] absolute;
+		int i = 0;
+
+		// Compose absolute paths
+		absolute = new Path[paths.size()];
+		for(Path f : paths) absolute[i++] = makeAbsolute(f);
+
+		LOG.debug("Delete " + absolute.length + " paths with recursive=" + recursive);
+
+		// Deleted trees may carry cached checksums
+		for(Path f : absolute) forgetChecksums(f);
+
+		// Packed files are deleted one at a time
+		if(packedFiles.isEnabled()) {
+			for(Path f : absolute) {
+				if(packedFiles.covers(f)) return deleteEach(absolute, recursive);
+			}
+		}
+
+		try {
+			errors = deleteBatch0(session.getHandle(), absolute, recursive);
+		}
+		finally {
+			for(Path f : absolute) forgetStatuses(f, false);
+		}
+
+		// Keep results in the same order as the request
+		results = new LinkedHashMap<Path, IOException>();
+		for(i = 0; i < absolute.length; i++) results.put(absolute[i], errors[i]);
+
+		return results;
+	}
+
+	private Map<Path, IOException> renameEach(Path[] srcs, Path[] dsts) {
+		Map<Path, IOException> results = new LinkedHashMap<Path, IOException>();
+
+		for(int i = 0; i < srcs.length; i++) {
+			try {
+				results.put(srcs[i], rename(srcs[i], dsts[i]) ? null : new IOException("Cannot rename " + srcs[i] + " to " + dsts[i]));
+			}
+			catch(IOException e) {
+				results.put(srcs[i], e);
+			}
+		}
+
+		return results;
+	}
+
+	private Map<Path, IOException> deleteEach(Path[] paths, boolean recursive) {
+		Map<Path, IOException> results = new LinkedHashMap<Path, IOException>();
+
+		for(Path f : paths) {
+			try {
+				results.put(f, delete(f, recursive) ? null : new IOException("Cannot delete " + f));
+			}
+			catch(IOException e) {
+				results.put(f, e);
+			}
+		}
+
+		return results;
 	}
 
 	@Override
 	public FileStatus[] listStatus(Path f) throws FileNotFoundException, IOException {
-		FileStatus parentStatus;
+		List<FileStatus> fileStatuses = new ArrayList<FileStatus>();
+		GenericMetadataCache.Fetch fetch = null;
+		GenericStatusIterator it;
+		FileStatus[] cached;
 
 		// Compose absolute path
 		f = makeAbsolute(f);
 
 		LOG.debug("List status for path " + f);
 
-		// Get parent's FileStatus
-		parentStatus = getFileStatus(f);
+		// Listings under packing roots change without the backend knowing
+		if(!packedFiles.covers(f)) {
+			cached = GenericMetadataCache.get().getListing(f);
+			if(cached != null) return cached;
+			fetch = GenericMetadataCache.get().prepare(session, f);
+		}
 
-		// If file is a directory, get all entries and list their status
-		if(parentStatus.isDir()) {
-			List<Path> fileNames;
-			List<FileStatus> fileStatuses;
+		// Gather every page of the listing (files have no entries)
+		it = listing(f, false);
+		try {
+			while(it.hasNext()) fileStatuses.add(it.next());
+		}
+		finally {
+			it.close();
+		}
+		cached = fileStatuses.toArray(new FileStatus[fileStatuses.size()]);
+		GenericMetadataCache.get().putListing(fetch, f, cached);
 
-			// Get a list of paths corresponding to files in directory
-			fileNames = getDirEntries0(f);
+		return cached;
+	}
 
-			// If directory has no entries, return empty array
-			if(fileNames == null || fileNames.size() == 0) return new FileStatus[0];
-			else {
-				fileStatuses = new ArrayList<FileStatus>();
+	// Lists a directory a page at a time, without holding it whole in memory
+	@Override
+	public RemoteIterator<FileStatus> listStatusIterator(Path f) throws FileNotFoundException, IOException {
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("List status iterator for path " + f);
+
+		return cachedListing(f, false);
+	}
+
+	@Override
+	protected RemoteIterator<LocatedFileStatus> listLocatedStatus(Path f, final PathFilter filter) throws FileNotFoundException, IOException {
+		final RemoteIterator<FileStatus> it;
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("List located status for path " + f);
+
+		// Files are located by the native listing itself, a page at a time
+		it = cachedListing(f, true);
+		return new RemoteIterator<LocatedFileStatus>() {
+			private LocatedFileStatus next = null;
+
+			@Override
+			public boolean hasNext() throws IOException {
+				while(next == null && it.hasNext()) {
+					FileStatus status = it.next();
+
+					if(filter.accept(status.getPath())) next = locate(status);
+				}
+				return next != null;
+			}
+
+			@Override
+			public LocatedFileStatus next() throws IOException {
+				LocatedFileStatus res;
+
+				if(!hasNext()) throw new NoSuchElementException("No more entries");
+				res = next;
+				next = null;
+				return res;
+			}
+		};
+	}
+
+	// Lists files under a path, walking directories as they are found (at most
+	// one open listing per level of depth)
+	@Override
+	public RemoteIterator<LocatedFileStatus> listFiles(Path f, final boolean recursive) throws FileNotFoundException, IOException {
+		final Deque<RemoteIterator<FileStatus>> pending = new ArrayDeque<RemoteIterator<FileStatus>>();
+		final LocatedFileStatus first;
+		FileStatus root;
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("List files for path " + f + (recursive ? " recursively" : ""));
+
+		// A file lists itself
+		root = getFileStatus(f);
+		if(root.isDirectory()) pending.push(cachedListing(f, true));
+		first = root.isFile() ? locate(root) : null;
+
+		return new RemoteIterator<LocatedFileStatus>() {
+			private LocatedFileStatus next = first;
+
+			@Override
+			public boolean hasNext() throws IOException {
+				while(next == null && !pending.isEmpty()) {
+					RemoteIterator<FileStatus> it = pending.peek();
+					FileStatus status;
+
+					if(!it.hasNext()) {
+						pending.pop();
+						continue;
+					}
+					status = it.next();
+					if(status.isFile()) next = locate(status);
+					else if(recursive) pending.push(cachedListing(status.getPath(), true));
+				}
+				return next != null;
+			}
+
+			@Override
+			public LocatedFileStatus next() throws IOException {
+				LocatedFileStatus res;
+
+				if(!hasNext()) throw new NoSuchElementException("No more files");
+				res = next;
+				next = null;
+				return res;
+			}
+		};
+	}
+
+	// Located listings return LocatedFileStatus entries, except under packing
+	// roots (whose files are located within their containers)
+	private GenericStatusIterator listing(Path f, boolean located) throws IOException {
+		Map<String, FileStatus> packed;
+
+		// Directories under packing roots also list their packed files
+		packed = packedFiles.list(f);
+		if(packed == null) return new GenericStatusIterator(session, f, listingPageSize, threads, blockSize, located);
+		if(packedFiles.getFileStatus(f) != null) return new GenericStatusIterator(session, f, listingPageSize, threads, blockSize, Collections.<String, FileStatus>emptyMap(), null, false);
+
+		return new GenericStatusIterator(session, f, listingPageSize, threads, blockSize, packed, packedFiles.getHiddenName(f), true);
+	}
+
+	// Listing served from the metadata cache if possible, otherwise read a page
+	// at a time and cached once complete (unless it outgrew the cache)
+	private RemoteIterator<FileStatus> cachedListing(final Path f, boolean located) throws IOException {
+		final GenericMetadataCache.Fetch fetch;
+		final GenericStatusIterator it;
+		final FileStatus[] cached;
+
+		if(packedFiles.covers(f)) return listing(f, located);
+		cached = GenericMetadataCache.get().getListing(f);
+		if(cached != null) {
+			return new RemoteIterator<FileStatus>() {
+				private int i = 0;
+
+				@Override
+				public boolean hasNext() {
+					return i < cached.length;
+				}
 
-				// Loop through each file and get its status
-				for(int i = 0; i < fileNames.size(); i++) {
-					fileStatuses.add(getFileStatus(fileNames.get(i)));
+				@Override
+				public FileStatus next() {
+					if(!hasNext()) throw new NoSuchElementException("No more entries");
+					return cached[i++];
 				}
+			};
+		}
+		fetch = GenericMetadataCache.get().prepare(session, f);
+		it = listing(f, located);
+		if(fetch == null) return it;
+
+		return new RemoteIterator<FileStatus>() {
+			private List<FileStatus> seen = new ArrayList<FileStatus>();
+
+			@Override
+			public boolean hasNext() throws IOException {
+				if(it.hasNext()) return true;
+				if(seen != null) GenericMetadataCache.get().putListing(fetch, f, seen.toArray(new FileStatus[seen.size()]));
+				seen = null;
+				return false;
+			}
+
+			@Override
+			public FileStatus next() throws IOException {
+				FileStatus status = it.next();
 
-				return fileStatuses.toArray(new FileStatus[fileStatuses.size()]);
+				if(seen != null && seen.size() < GenericMetadataCache.get().getCapacity()) seen.add(status);
+				else seen = null;
+				return status;
 			}
+		};
+	}
+
+	// Statuses of located listings are already located
+	private LocatedFileStatus locate(FileStatus status) throws IOException {
+		if(status instanceof LocatedFileStatus) return (LocatedFileStatus) status;
+		return new LocatedFileStatus(status, status.isFile() ? getFileBlockLocations(status, 0, status.getLen()) : null);
+	}
+
+	@Override
+	public FileStatus[] globStatus(Path pathPattern) throws IOException {
+		return globStatus(pathPattern, ACCEPT_ALL);
+	}
+
+	// Patterns are evaluated natively: each directory is filtered while it is
+	// read, only matches are stat'ed and branches are expanded in parallel
+	@Override
+	public FileStatus[] globStatus(Path pathPattern, PathFilter filter) throws IOException {
+		FileStatus[] matches;
+		List<FileStatus> accepted;
+
+		// Compose absolute path
+		pathPattern = makeAbsolute(pathPattern);
+
+		LOG.debug("Glob status for pattern " + pathPattern);
+
+		// Packed files are only seen through listings
+		if(packedFiles.coversPattern(pathPattern)) return super.globStatus(pathPattern, filter);
+
+		// Null means a path without wildcards that does not exist
+		matches = globStatus0(session.getHandle(), pathPattern);
+		if(matches == null) return null;
+
+		// Sorted by path, as Hadoop's globber does
+		Arrays.sort(matches);
+		if(filter == ACCEPT_ALL) return matches;
+		accepted = new ArrayList<FileStatus>(matches.length);
+		for(FileStatus match : matches) {
+			if(filter.accept(match.getPath())) accepted.add(match);
 		}
-		else return new FileStatus[0];
+
+		return accepted.toArray(new FileStatus[accepted.size()]);
+	}
+
+	// Walks the subtree natively from several threads, adding up lengths and
+	// counts without creating a FileStatus per entry
+	@Override
+	public ContentSummary getContentSummary(Path f) throws IOException {
+
+		// Compose absolute path
+		f = makeAbsolute(f);
+
+		LOG.debug("Get content summary for " + f);
+
+		// Packed files are only seen through listings
+		if(packedFiles.covers(f)) return super.getContentSummary(f);
+
+		return getContentSummary0(session.getHandle(), f);
 	}
 
 	@Override
@@ -294,28 +1308,80 @@ public class GenericFileSystem extends FileSystem {
 
 		LOG.debug("Make all directories to " + f + " with permissions " + permission);
 
-		return mkdirs0(f, permission.toShort());
+		try {
+			return mkdirs0(session.getHandle(), f, permission.toShort());
+		}
+		finally {
+			forgetStatuses(f, true);
+		}
 	}
 
 	@Override
 	public FileStatus getFileStatus(Path f) throws IOException {
+		GenericMetadataCache.Fetch fetch;
+		FileStatus packed, status;
 
 		// Compose absolute path
 		f = makeAbsolute(f);
 
 		LOG.debug("Get file status for " + f);
 
-		return getFileStatus0(f);
+		// Packed files replace any regular file of the same name
+		packed = packedFiles.getFileStatus(f);
+		if(packed != null) return packed;
+		if(packedFiles.covers(f)) return getFileStatus0(session.getHandle(), f);
+
+		// Statuses are cached along with the directory watch of their parent
+		status = GenericMetadataCache.get().getStatus(f);
+		if(status != null) return status;
+		fetch = GenericMetadataCache.get().prepare(session, f.getParent() == null ? f : f.getParent());
+		status = getFileStatus0(session.getHandle(), f);
+		GenericMetadataCache.get().putStatus(fetch, f, status);
+
+		return status;
+	}
+
+	// Stats many unrelated paths (for example partitions or commit markers)
+	// with a single native call, from several threads or in one backend
+	// request if it supports it. Statuses keep the order of the request, and
+	// paths that don't exist get null instead of a FileNotFoundException.
+	public FileStatus[] getFileStatuses(Path[] paths) throws IOException {
+		FileStatus[] statuses;
+		Path[] absolutePaths;
+
+		// Compose absolute paths
+		absolutePaths = new Path[paths.length];
+		for(int i = 0; i < paths.length; i++) absolutePaths[i] = makeAbsolute(paths[i]);
+
+		LOG.debug("Get file status for " + paths.length + " paths");
+
+		statuses = getFileStatuses0(session.getHandle(), absolutePaths, threads, blockSize);
+
+		// Packed files replace any regular file of the same name
+		for(int i = 0; packedFiles.isEnabled() && i < absolutePaths.length; i++) {
+			FileStatus packed = packedFiles.getFileStatus(absolutePaths[i]);
+
+			if(packed != null) statuses[i] = packed;
+		}
+
+		return statuses;
 	}
 
-	private native synchronized void initConnector() throws IOException;
-	private native synchronized void destConnector() throws IOException;
-	private native synchronized FileStatus getFileStatus0(Path path) throws IOException;
-	private native synchronized List<Path> getDirEntries0(Path path) throws IOException;
-	private native synchronized boolean mkdirs0(Path path, short permissions) throws IOException;
-	private native synchronized boolean rename0(Path src, Path dst) throws IOException;
-	private native synchronized boolean delete0(Path path, boolean recursive) throws IOException;
-	private native synchronized void setPermission0(Path path, short permission) throws IOException;
-	private native synchronized void setOwner0(Path path, String username, String groupname) throws IOException;
-	private native synchronized BlockLocation[] getFileBlockLocations0(FileStatus file, long start, long end) throws IOException;
+	private native synchronized FileStatus getFileStatus0(long session, Path path) throws IOException;
+	private static native FileStatus[] getFileStatuses0(long session, Path[] paths, int threads, long blockSize) throws IOException;
+	private native synchronized FileStatus[] globStatus0(long session, Path pattern) throws IOException;
+	private native synchronized ContentSummary getContentSummary0(long session, Path path) throws IOException;
+	private native synchronized boolean mkdirs0(long session, Path path, short permissions) throws IOException;
+	private native synchronized boolean rename0(long session, Path src, Path dst) throws IOException;
+	private native synchronized boolean delete0(long session, Path path, boolean recursive) throws IOException;
+	private native synchronized IOException[] renameBatch0(long session, Path[] srcs, Path[] dsts) throws IOException;
+	private native synchronized IOException[] deleteBatch0(long session, Path[] paths, boolean recursive) throws IOException;
+	private native synchronized void writeFile0(long session, Path path, byte[] b, ByteBuffer direct, int off, int len, boolean create, boolean overwrite, boolean append, short permission, short dirPermission) throws IOException;
+	private native synchronized byte[] readFile0(long session, Path path, int maxLen) throws IOException;
+	private native synchronized long copyToLocal0(long session, Path src, String dst, long stripeSize) throws IOException;
+	private static native long[] getDataRanges0(long session, Path path) throws IOException;
+	private native synchronized void setPermission0(long session, Path path, short permission) throws IOException;
+	private native synchronized void setOwner0(long session, Path path, String username, String groupname) throws IOException;
+	private native synchronized BlockLocation[] getFileBlockLocations0(long session, FileStatus file, long start, long end) throws IOException;
+	private native synchronized int getFileChecksum0(long session, Path path, long length, long blockSize) throws IOException;
 }
@@ -0,0 +1,472 @@
+package org.apache.hadoop.fs.connector.generic;
+
+import java.io.IOException;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+import org.apache.hadoop.fs.FileStatus;
+import org.apache.hadoop.fs.LocatedFileStatus;
+import org.apache.hadoop.fs.Path;
+
+// JVM-wide cache of file statuses and directory listings. Entries expire after
+// a fixed time, unless the backend notifies changes (fs_watch): a thread per
+// backend session then waits for the changes of the directories entries were
+// read from, and drops exactly the entries each change affects, so entries of
+// unchanged directories stay until evicted. Statuses of directories (alone or
+// in a listing) always expire, as their modification time follows changes of
+// their own entries, which the watch of their parent does not see. If the
+// backend loses changes, the entries cached until then fall back to expiring
+// after the fixed time. Statuses are copied in and out, as they are mutable.
+public final class GenericMetadataCache {
+
+	public final static Log LOG = LogFactory.getLog(GenericMetadataCache.class);
+
+	private static final GenericMetadataCache INSTANCE = new GenericMetadataCache();
+
+	private static final String LISTING = "\u0000";	// Suffix of listing keys (sorts before children)
+	private static final int MAX_WATCHES = 4096;	// Directories watched per session
+	private static final int MAX_INVALIDATIONS = 1024;	// Recent invalidations checked by put
+	private static final int EVENT_BATCH = 256;	// Changes taken per native call
+	private static final int EVENT_TIMEOUT = 1000;	// Milliseconds a watcher waits before checking whether to stop
+
+	public static GenericMetadataCache get() {
+		return INSTANCE;
+	}
+
+	// Cached status (or listing) with what keeps it valid
+	private static final class Entry {
+		private final String key;
+		private final Object value;	// FileStatus or FileStatus[]
+		private final int weight;	// Statuses held
+		private final long expires;	// When it expires unless watched
+		private final Watch watch;	// Watch of the directory it was read from (null if none)
+		private final boolean expiring;	// Whether it expires even if watched (holds directory statuses)
+
+		private Entry(String key, Object value, int weight, long expires, Watch watch, boolean expiring) {
+			this.key = key;
+			this.value = value;
+			this.weight = weight;
+			this.expires = expires;
+			this.watch = watch;
+			this.expiring = expiring;
+		}
+
+		private boolean isValid(long now) {
+			return (!expiring && watch != null && watch.active) || now < expires;
+		}
+	}
+
+	// Subscription to the changes of a directory
+	private static final class Watch {
+		private final int id;
+		private final Path directory;
+		private volatile boolean active = true;	// Whether its changes are still being received
+
+		private Watch(int id, Path directory) {
+			this.id = id;
+			this.directory = directory;
+		}
+	}
+
+	// Status or listing being read from the backend, to be cached only if
+	// nothing it depends on changed meanwhile
+	public static final class Fetch {
+		private final long generation;
+		private final Watch watch;
+
+		private Fetch(long generation, Watch watch) {
+			this.generation = generation;
+			this.watch = watch;
+		}
+	}
+
+	// Thread receiving the changes of a backend session (fs_events is called
+	// from one thread per session)
+	private final class Watcher extends Thread {
+		private final GenericSession session;
+		private final Map<Integer, Watch> byId = new HashMap<Integer, Watch>();
+		private final LinkedHashMap<String, Watch> byPath = new LinkedHashMap<String, Watch>(16, 0.75f, true);	// Least recently used first
+		private int users = 1;	// Instances of the authority (0 once stopping)
+		private volatile boolean supported = true;	// Whether the backend takes watches
+
+		private Watcher(GenericSession session) {
+			super("generic-metadata-watcher");
+			this.session = session;
+			setDaemon(true);
+		}
+
+		// Watch of a directory, subscribing to its changes if needed (null if
+		// the backend cannot watch it)
+		private Watch watch(Path directory) {
+			String key = directory.toString();
+			List<Watch> evicted = new ArrayList<Watch>();
+			Watch watch;
+			int id;
+
+			synchronized(GenericMetadataCache.this) {
+				watch = byPath.get(key);
+				if(watch != null) return watch;
+			}
+			if(!supported) return null;
+
+			// Subscribe outside the lock (it may be a request to the backend)
+			try {
+				id = watch0(session.getHandle(), directory);
+			}
+			catch(IOException e) {
+				LOG.debug("Could not watch directory " + directory, e);
+				return null;
+			}
+			if(id < 0) {
+				LOG.debug("Backend does not notify changes, cached entries expire after " + ttl + "ms");
+				supported = false;
+				return null;
+			}
+
+			synchronized(GenericMetadataCache.this) {
+
+				// Watching a directory twice may give the same watch
+				watch = byId.get(id);
+				if(watch == null || !watch.directory.equals(directory)) {
+					if(watch != null) forget(watch);
+					watch = new Watch(id, directory);
+					byId.put(id, watch);
+				}
+				byPath.put(key, watch);
+
+				// Entries of the least recently used directories go back to expiring
+				for(Iterator<Watch> it = byPath.values().iterator(); byPath.size() > MAX_WATCHES && it.hasNext(); ) {
+					Watch eldest = it.next();
+
+					it.remove();
+					byId.remove(eldest.id);
+					eldest.active = false;
+					evicted.add(eldest);
+				}
+			}
+			unwatchAll(evicted);
+
+			return watch;
+		}
+
+		private void forget(Watch watch) {
+			watch.active = false;
+			byId.remove(watch.id);
+			byPath.remove(watch.directory.toString());
+		}
+
+		private void unwatchAll(List<Watch> watches) {
+			for(Watch watch : watches) {
+				try {
+					unwatch0(session.getHandle(), watch.id);
+				}
+				catch(IOException e) {
+					LOG.debug("Could not stop watching directory " + watch.directory, e);
+				}
+			}
+		}
+
+		@Override
+		public void run() {
+			int[] watches = new int[EVENT_BATCH];
+			String[] names = new String[EVENT_BATCH];
+			List<Watch> ended = new ArrayList<Watch>();
+			int count;
+
+			try {
+				while(true) {
+					synchronized(GenericMetadataCache.this) {
+
+						// Stopped once the last instance of the authority is closed
+						if(users == 0) {
+							watchers.remove(session.getHandle());
+							ended.addAll(byId.values());
+							for(Watch watch : ended) watch.active = false;
+							byId.clear();
+							byPath.clear();
+							break;
+						}
+					}
+
+					try {
+						count = nextEvents0(session.getHandle(), watches, names, EVENT_TIMEOUT);
+					}
+					catch(IOException e) {
+						LOG.warn("Could not receive changes from backend, cached entries expire after " + ttl + "ms", e);
+						supported = false;
+						count = -1;
+					}
+
+					synchronized(GenericMetadataCache.this) {
+
+						// Changes were lost, nothing cached so far can be trusted beyond its expiration
+						if(count < 0) {
+							LOG.debug("Backend lost changes, cached entries expire after " + ttl + "ms");
+							for(Watch watch : byId.values()) watch.active = false;
+							byId.clear();
+							byPath.clear();
+							floor = ++generation;
+							if(!supported) users = 0;
+							continue;
+						}
+
+						for(int i = 0; i < count; i++) {
+							Watch watch = byId.get(watches[i]);
+
+							if(watch == null) continue;
+							if(!names[i].isEmpty()) {
+								try {
+									invalidate(new Path(watch.directory, names[i]), true);
+								}
+								catch(IllegalArgumentException e) {
+
+									// Names Hadoop cannot parse drop the whole directory
+									invalidate(watch.directory, true);
+								}
+								continue;
+							}
+
+							// Directory itself was removed or moved, its watch is of no more use
+							invalidate(watch.directory, true);
+							forget(watch);
+							ended.add(watch);
+						}
+					}
+					unwatchAll(ended);
+					ended.clear();
+				}
+				unwatchAll(ended);
+			}
+			finally {
+				try {
+					session.release();
+				}
+				catch(IOException e) {
+					LOG.warn("Could not release backend session of metadata watcher", e);
+				}
+			}
+		}
+	}
+
+	private final TreeMap<String, Entry> sorted = new TreeMap<String, Entry>();	// Entries by key (to drop subtrees)
+	private final LinkedHashMap<String, Entry> entries = new LinkedHashMap<String, Entry>(16, 0.75f, true);	// Least recently used first
+	private final LinkedHashMap<String, Long> invalidated = new LinkedHashMap<String, Long>();	// Generation of the latest invalidation of recent paths
+	private final Map<Long, Watcher> watchers = new HashMap<Long, Watcher>();	// By native session
+	private int maxWeight = 0;	// Zero disables caching
+	private int weight = 0;	// Statuses held
+	private long ttl = 0L;	// Milliseconds an unwatched entry stays valid
+	private long generation = 0L;	// Invalidations so far
+	private long floor = 0L;	// Generation of the latest invalidation forgotten
+
+	private GenericMetadataCache() {}
+
+	public synchronized void configure(int maxEntries, long ttl) {
+		this.maxWeight = Math.max(0, maxEntries);
+		this.ttl = Math.max(0L, ttl);
+		evict();
+	}
+
+	public synchronized boolean isEnabled() {
+		return maxWeight > 0;
+	}
+
+	// Largest listing that may be cached
+	public synchronized int getCapacity() {
+		return maxWeight;
+	}
+
+	// Receives the changes of a backend session while an instance uses it
+	public void attach(GenericSession session) {
+		Watcher watcher;
+
+		synchronized(this) {
+			watcher = watchers.get(session.getHandle());
+
+			// A watcher still running is taken over, even if stopping
+			if(watcher != null) {
+				watcher.users++;
+				return;
+			}
+			watcher = new Watcher(session.retain());
+			watchers.put(session.getHandle(), watcher);
+		}
+
+		watcher.start();
+	}
+
+	public synchronized void detach(GenericSession session) {
+		Watcher watcher = watchers.get(session.getHandle());
+
+		if(watcher != null && watcher.users > 0) watcher.users--;
+	}
+
+	public synchronized FileStatus getStatus(Path path) {
+		Entry entry = lookup(path.toString());
+
+		return entry == null ? null : copy((FileStatus) entry.value);
+	}
+
+	public synchronized FileStatus[] getListing(Path path) {
+		Entry entry = lookup(path.toString() + LISTING);
+
+		return entry == null ? null : copy((FileStatus[]) entry.value);
+	}
+
+	// Starts reading something that depends on the given directory (the parent
+	// of a status, or the directory of a listing), watching it if possible
+	public Fetch prepare(GenericSession session, Path directory) {
+		Watcher watcher;
+		Watch watch;
+
+		synchronized(this) {
+			if(maxWeight == 0) return null;
+			watcher = watchers.get(session.getHandle());
+		}
+
+		// Changes are received from the moment the watch exists
+		watch = watcher == null ? null : watcher.watch(directory);
+
+		synchronized(this) {
+			return new Fetch(generation, watch);
+		}
+	}
+
+	public synchronized void putStatus(Fetch fetch, Path path, FileStatus status) {
+		put(fetch, path, path.toString(), copy(status), 1, status.isDirectory());
+	}
+
+	public synchronized void putListing(Fetch fetch, Path path, FileStatus[] statuses) {
+		boolean directories = false;
+
+		for(FileStatus status : statuses) directories |= status.isDirectory();
+		put(fetch, path, path.toString() + LISTING, copy(statuses), 1 + statuses.length, directories);
+	}
+
+	// Drops what a change of a path affects: its status and listing, those of
+	// its parent and, for a tree, everything below it
+	public synchronized void invalidate(Path path, boolean tree) {
+		String key = path.toString();
+		Path parent = path.getParent();
+
+		// Nothing is cached while disabled
+		if(maxWeight == 0) return;
+
+		generation++;
+		remember(key);
+		remove(key);
+		remove(key + LISTING);
+		if(tree) {
+			String prefix = key.endsWith("/") ? key : key + "/";
+			String end = prefix.substring(0, prefix.length() - 1) + (char) ('/' + 1);
+			List<String> below = new ArrayList<String>(sorted.subMap(prefix, end).keySet());
+
+			for(String child : below) remove(child);
+		}
+		if(parent != null) {
+			remember(parent.toString());
+			remove(parent.toString());
+			remove(parent.toString() + LISTING);
+		}
+	}
+
+	public void invalidate(Path path) {
+		invalidate(path, true);
+	}
+
+	private Entry lookup(String key) {
+		Entry entry = entries.get(key);
+
+		if(entry == null) return null;
+		if(entry.isValid(System.currentTimeMillis())) return entry;
+		remove(key);
+		return null;
+	}
+
+	private void put(Fetch fetch, Path path, String key, Object value, int weight, boolean expiring) {
+		if(fetch == null || maxWeight == 0 || weight > maxWeight) return;
+		if(fetch.watch == null || expiring ? ttl == 0 : !fetch.watch.active) return;
+
+		// Anything read before a change of the path (or of a parent) is stale
+		if(fetch.generation != generation) {
+			if(fetch.generation < floor) return;
+			for(Path p = path; p != null; p = p.getParent()) {
+				Long changed = invalidated.get(p.toString());
+
+				if(changed != null && changed > fetch.generation) return;
+			}
+		}
+
+		remove(key);
+		add(new Entry(key, value, weight, System.currentTimeMillis() + ttl, fetch.watch, expiring));
+		evict();
+	}
+
+	private void remember(String key) {
+		invalidated.remove(key);
+		invalidated.put(key, generation);
+		if(invalidated.size() > MAX_INVALIDATIONS) {
+			Iterator<Long> it = invalidated.values().iterator();
+
+			floor = Math.max(floor, it.next());
+			it.remove();
+		}
+	}
+
+	private void add(Entry entry) {
+		entries.put(entry.key, entry);
+		sorted.put(entry.key, entry);
+		weight += entry.weight;
+	}
+
+	private void remove(String key) {
+		Entry entry = entries.remove(key);
+
+		if(entry == null) return;
+		sorted.remove(key);
+		weight -= entry.weight;
+	}
+
+	private void evict() {
+		Iterator<Entry> it = entries.values().iterator();
+
+		while(weight > maxWeight && it.hasNext()) {
+			Entry entry = it.next();
+
+			it.remove();
+			sorted.remove(entry.key);
+			weight -= entry.weight;
+		}
+	}
+
+	private static FileStatus copy(FileStatus status) {
+		try {
+			if(status instanceof LocatedFileStatus) return new LocatedFileStatus(status, ((LocatedFileStatus) status).getBlockLocations());
+			return new FileStatus(status);
+		}
+		catch(IOException e) {
+
+			// Only thrown for the link target of statuses that are no links
+			throw new IllegalStateException("Could not copy status of " + status.getPath(), e);
+		}
+	}
+
+	private static FileStatus[] copy(FileStatus[] statuses) {
+		FileStatus[] res = new FileStatus[statuses.length];
+
+		for(int i = 0; i < statuses.length; i++) res[i] = copy(statuses[i]);
+		return res;
+	}
+
+	private static native int watch0(long session, Path path) throws IOException;
+	private static native void unwatch0(long session, int watch) throws IOException;
+	private static native int nextEvents0(long session, int[] watches, String[] names, int timeout) throws IOException;
+}
@@ -0,0 +1,52 @@
+package org.apache.hadoop.fs.connector.generic;
+
+import java.io.IOException;
+
+import org.apache.hadoop.fs.FSDataInputStream;
+import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.connector.generic.stream.GenericReadPolicy;
+
+// Options of a stream about to be opened, under the keys of Hadoop 3
+// openFile() so that callers can move over unchanged. Hadoop 2 has no
+// asynchronous builder, so build() opens the stream right away. Options this
+// filesystem doesn't know are ignored, as openFile() does with opt().
+public final class GenericOpenFileBuilder {
+
+	public static final String READ_POLICY = "fs.option.openfile.read.policy";
+	public static final String LENGTH = "fs.option.openfile.length";
+	public static final String SPLIT_START = "fs.option.openfile.split.start";
+	public static final String SPLIT_END = "fs.option.openfile.split.end";
+	public static final String BUFFER_SIZE = "fs.option.openfile.buffer.size";
+
+	private final GenericFileSystem fs;
+	private final Path path;
+	private int bufferSize;
+	private GenericReadPolicy policy = null;	// Filesystem default unless set
+	private long length = -1L;	// Unknown unless set (file is stat'ed)
+	private long splitStart = 0L;
+	private long splitEnd = Long.MAX_VALUE;
+
+	GenericOpenFileBuilder(GenericFileSystem fs, Path path, int bufferSize) {
+		this.fs = fs;
+		this.path = path;
+		this.bufferSize = bufferSize;
+	}
+
+	public GenericOpenFileBuilder opt(String key, String value) {
+		if(key.equals(READ_POLICY)) policy = GenericReadPolicy.fromString(value, policy);
+		else if(key.equals(LENGTH)) length = Long.parseLong(value.trim());
+		else if(key.equals(SPLIT_START)) splitStart = Long.parseLong(value.trim());
+		else if(key.equals(SPLIT_END)) splitEnd = Long.parseLong(value.trim());
+		else if(key.equals(BUFFER_SIZE)) bufferSize = Integer.parseInt(value.trim());
+
+		return this;
+	}
+
+	public GenericOpenFileBuilder opt(String key, long value) {
+		return opt(key, Long.toString(value));
+	}
+
+	public FSDataInputStream build() throws IOException {
+		return fs.open(path, bufferSize, policy, length, splitStart, splitEnd);
+	}
+}
@@ -0,0 +1,70 @@
+package org.apache.hadoop.fs.connector.generic;
+
+import java.io.IOException;
+
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+// Backend session of an authority (see fs_session_t in fs/filesystem.h). The
+// native side keeps one per authority, with the threads of its batch calls
+// and the budget of its transfer buffers, shared by every instance, stream,
+// handle and listing of that authority; the first instance to open it gives
+// its settings. Each object holds a native reference, itself counted by its
+// users, so that streams and cached handles may outlive their instance.
+public final class GenericSession {
+
+	// Names of the values of getMetrics0, in order
+	private static final String[] METRICS = {"calls", "bytesRead", "bytesWritten", "bufferWaits", "bufferBytes", "bufferBudget", "threads", "references"};
+
+	private final long handle;	// Native session
+	private int refs = 1;	// Users of this object (0 once released)
+
+	private GenericSession(long handle) {
+		this.handle = handle;
+	}
+
+	// Opens (or references) the session of an authority
+	static GenericSession open(String authority, int threads, long bufferBudget) throws IOException {
+		return new GenericSession(open0(authority, threads, bufferBudget));
+	}
+
+	public long getHandle() {
+		return handle;
+	}
+
+	// Adds a user, to be matched by a release
+	public synchronized GenericSession retain() {
+		if(refs == 0) throw new IllegalStateException("Backend session is closed");
+
+		refs++;
+		return this;
+	}
+
+	// Removes a user, and releases the native reference with the last one
+	public void release() throws IOException {
+		synchronized(this) {
+			if(refs == 0 || --refs > 0) return;
+		}
+		close0(handle);
+	}
+
+	// Optional features implemented by the backend (see FS_CAP_*)
+	public int getCapabilities() {
+		return getCapabilities0(handle);
+	}
+
+	// Counters of the native session, shared by every user of the authority
+	public Map<String, Long> getMetrics() {
+		long[] values = getMetrics0(handle);
+		Map<String, Long> metrics = new LinkedHashMap<String, Long>();
+
+		for(int i = 0; i < METRICS.length; i++) metrics.put(METRICS[i], values[i]);
+
+		return metrics;
+	}
+
+	private static native long open0(String authority, int threads, long bufferBudget) throws IOException;
+	private static native void close0(long session) throws IOException;
+	private static native int getCapabilities0(long session);
+	private static native long[] getMetrics0(long session);
+}
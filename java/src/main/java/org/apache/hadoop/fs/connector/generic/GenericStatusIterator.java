@@ -0,0 +1,247 @@
+package org.apache.hadoop.fs.connector.generic;
+
+import java.io.Closeable;
+import java.io.IOException;
+import java.io.InterruptedIOException;
+
+import java.util.Collections;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.NoSuchElementException;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+import org.apache.hadoop.fs.FileStatus;
+import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.RemoteIterator;
+
+// Listing of a directory read through a native cursor, one page of statuses at
+// a time. The cursor keeps the directory open between pages and the next page
+// is fetched in the background while the current one is consumed, so memory
+// and time to the first entry do not depend on the size of the directory. The
+// cursor is closed as soon as the listing ends, fails or is closed, and keeps
+// its own reference to the backend session until then. Located listings also
+// locate the blocks of every file along with its status, returning
+// LocatedFileStatus entries (with the hosts of a listing shared by all of them).
+public class GenericStatusIterator implements RemoteIterator<FileStatus>, Closeable {
+
+	public final static Log LOG = LogFactory.getLog(GenericStatusIterator.class);
+
+	private static final FileStatus[] EMPTY = new FileStatus[0];
+
+	// Threads fetching pages ahead, shared by every listing of the JVM
+	private static final ExecutorService PREFETCHER = Executors.newCachedThreadPool(new ThreadFactory() {
+		private final AtomicInteger created = new AtomicInteger();
+
+		@Override
+		public Thread newThread(Runnable r) {
+			Thread thread = new Thread(r, "generic-listing-" + created.incrementAndGet());
+			thread.setDaemon(true);
+			return thread;
+		}
+	});
+
+	// Fetch of one page (it does not reference the iterator, so that abandoned
+	// listings can still be collected)
+	private static final class PageFetch implements Callable<FileStatus[]> {
+		private final long cursor;
+		private final Path path;
+		private final int pageSize;
+		private final int threads;
+		private final long blockSize;
+		private final boolean located;
+
+		private PageFetch(long cursor, Path path, int pageSize, int threads, long blockSize, boolean located) {
+			this.cursor = cursor;
+			this.path = path;
+			this.pageSize = pageSize;
+			this.threads = threads;
+			this.blockSize = blockSize;
+			this.located = located;
+		}
+
+		@Override
+		public FileStatus[] call() throws IOException {
+			if(located) return nextLocatedPage0(cursor, path, pageSize, threads, blockSize);
+			return nextPage0(cursor, path, pageSize, threads, blockSize);
+		}
+	}
+
+	private final Path path;
+	private final int pageSize;
+	private final int threads;	// Native threads stat'ing a page
+	private final long blockSize;	// Logical block size unless backend provides one
+	private final boolean located;	// Whether entries are LocatedFileStatus
+	private long cursor;	// Native cursor (0 if closed or nothing to list)
+	private FileStatus[] page = EMPTY;	// Page being consumed
+	private int index = 0;	// Next entry of page
+	private Future<FileStatus[]> next = null;	// Page being fetched
+	private Map<String, FileStatus> packed = Collections.emptyMap();	// Packed files of the directory, by name
+	private Iterator<FileStatus> pending = null;	// Packed files not listed yet
+	private String hidden = null;	// Entry skipped (directory of containers)
+
+	// Lists a directory (files and missing directories behave as in listStatus:
+	// the former have no entries and the latter throw FileNotFoundException)
+	GenericStatusIterator(GenericSession session, Path path, int pageSize, int threads, long blockSize) throws IOException {
+		this(session, path, pageSize, threads, blockSize, false);
+	}
+
+	// Lists a directory, locating its files if asked to (the blocks of a file
+	// are located by the same native thread that stats it)
+	GenericStatusIterator(GenericSession session, Path path, int pageSize, int threads, long blockSize, boolean located) throws IOException {
+		this.path = path;
+		this.pageSize = Math.max(1, pageSize);
+		this.threads = threads;
+		this.blockSize = blockSize;
+		this.located = located;
+
+		LOG.debug("Open " + (located ? "located " : "") + "listing of " + path + " with pages of " + this.pageSize + " entries");
+
+		cursor = openCursor0(session.getHandle(), path);
+		if(cursor != 0) prefetch();
+	}
+
+	// Lists a directory under a packing root: its packed files follow its own
+	// entries (replacing those of the same name), and the directory holding the
+	// containers, if given, is skipped. Packed files themselves are not
+	// directories, and have no entries as any other file.
+	GenericStatusIterator(GenericSession session, Path path, int pageSize, int threads, long blockSize, Map<String, FileStatus> packed, String hidden, boolean directory) throws IOException {
+		this.path = path;
+		this.pageSize = Math.max(1, pageSize);
+		this.threads = threads;
+		this.blockSize = blockSize;
+		this.located = false;
+		this.packed = packed;
+		this.pending = packed.values().iterator();
+		this.hidden = hidden;
+
+		LOG.debug("Open listing of " + path + " with " + packed.size() + " packed files");
+
+		if(!directory) return;
+		cursor = openCursor0(session.getHandle(), path);
+		if(cursor != 0) prefetch();
+	}
+
+	private boolean isShadowed(FileStatus status) {
+		String name = status.getPath().getName();
+
+		return name.equals(hidden) || packed.containsKey(name);
+	}
+
+	private void prefetch() {
+		next = PREFETCHER.submit(new PageFetch(cursor, path, pageSize, threads, blockSize, located));
+	}
+
+	@Override
+	public synchronized boolean hasNext() throws IOException {
+		while(true) {
+			while(index < page.length && isShadowed(page[index])) page[index++] = null;
+			if(index < page.length) return true;
+
+			// Packed files come once the directory is done
+			if(next == null) return pending != null && pending.hasNext();
+
+			// Wait for the page fetched in background, and ask for the following one
+			try {
+				page = next.get();
+			}
+			catch(InterruptedException e) {
+				Thread.currentThread().interrupt();
+				close();
+				throw new InterruptedIOException("Interrupted while listing " + path);
+			}
+			catch(ExecutionException e) {
+				next = null;
+				close();
+				if(e.getCause() instanceof IOException) throw (IOException) e.getCause();
+				throw new IOException(e.getCause());
+			}
+			index = 0;
+			next = null;
+
+			// Null page means the directory has no more entries
+			if(page == null) {
+				page = EMPTY;
+				close();
+				continue;
+			}
+			prefetch();
+		}
+	}
+
+	@Override
+	public synchronized FileStatus next() throws IOException {
+		FileStatus status;
+
+		if(!hasNext()) throw new NoSuchElementException("No more entries in " + path);
+		if(index == page.length) return pending.next();
+
+		// Consumed entries are not kept alive by the page
+		status = page[index];
+		page[index++] = null;
+		return status;
+	}
+
+	// Releases the cursor, which is only needed if the listing is abandoned
+	// before its end
+	@Override
+	public synchronized void close() throws IOException {
+
+		// Cursor cannot be closed while a page is being read
+		if(next != null) {
+			boolean interrupted = false;
+
+			while(true) {
+				try {
+					next.get();
+					break;
+				}
+				catch(InterruptedException e) {
+					interrupted = true;
+				}
+				catch(ExecutionException e) {
+					break; // Listing is being discarded anyway
+				}
+			}
+			if(interrupted) Thread.currentThread().interrupt();
+			next = null;
+		}
+
+		if(cursor != 0) {
+			LOG.debug("Close listing of " + path);
+
+			try {
+				closeCursor0(cursor);
+			}
+			finally {
+				cursor = 0;
+				page = EMPTY;
+				index = 0;
+			}
+		}
+	}
+
+	// Last resort for listings abandoned without close()
+	@Override
+	protected void finalize() throws Throwable {
+		try {
+			close();
+		}
+		finally {
+			super.finalize();
+		}
+	}
+
+	private static native long openCursor0(long session, Path path) throws IOException;
+	private static native FileStatus[] nextPage0(long cursor, Path path, int size, int threads, long blockSize) throws IOException;
+	private static native FileStatus[] nextLocatedPage0(long cursor, Path path, int size, int threads, long blockSize) throws IOException;
+	private static native void closeCursor0(long cursor) throws IOException;
+}
@@ -0,0 +1,85 @@
+package org.apache.hadoop.fs.connector.generic.bench;
+
+import java.net.URI;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+import org.apache.hadoop.conf.Configuration;
+import org.apache.hadoop.conf.Configured;
+import org.apache.hadoop.fs.FileSystem;
+import org.apache.hadoop.util.Tool;
+import org.apache.hadoop.util.ToolRunner;
+
+// Measures how many FileSystem instances per second can be created and closed
+// with the FileSystem cache disabled (as done for per-user UGI access).
+//
+// Usage: InstanceBenchmark <uri> [iterations per thread] [threads]
+public class InstanceBenchmark extends Configured implements Tool {
+
+	@Override
+	public int run(String[] args) throws Exception {
+		final URI uri;
+		final Configuration conf;
+		final int iterations, threads;
+		List<Future<Long>> results;
+		ExecutorService executor;
+		long start, elapsed, worst = 0;
+		FileSystem warmup;
+
+		if(args.length < 1) {
+			System.err.println("Usage: InstanceBenchmark <uri> [iterations per thread] [threads]");
+			return 1;
+		}
+		uri = new URI(args[0]);
+		iterations = args.length > 1 ? Integer.parseInt(args[1]) : 10000;
+		threads = args.length > 2 ? Integer.parseInt(args[2]) : 1;
+
+		// Every newInstance must go through initialize and close
+		conf = new Configuration(getConf());
+		conf.setBoolean("fs." + uri.getScheme() + ".impl.disable.cache", true);
+
+		// Keep one instance alive, as a long running client would
+		warmup = FileSystem.newInstance(uri, conf);
+
+		executor = Executors.newFixedThreadPool(threads);
+		results = new ArrayList<Future<Long>>();
+		start = System.nanoTime();
+		for(int t = 0; t < threads; t++) {
+			results.add(executor.submit(new Callable<Long>() {
+				@Override
+				public Long call() throws Exception {
+					long slowest = 0;
+
+					for(int i = 0; i < iterations; i++) {
+						long begin = System.nanoTime();
+						FileSystem.newInstance(uri, conf).close();
+						slowest = Math.max(slowest, System.nanoTime() - begin);
+					}
+
+					return slowest;
+				}
+			}));
+		}
+		for(Future<Long> result : results) worst = Math.max(worst, result.get());
+		elapsed = System.nanoTime() - start;
+		executor.shutdown();
+		warmup.close();
+
+		System.out.println(String.format("instances=%d threads=%d elapsed=%.1fms throughput=%.0f instances/s mean=%.1fus max=%.1fus",
+			(long) iterations * threads, threads, elapsed / 1e6,
+			(double) iterations * threads / (elapsed / 1e9),
+			elapsed / 1e3 / iterations,
+			worst / 1e3));
+
+		return 0;
+	}
+
+	public static void main(String[] args) throws Exception {
+		System.exit(ToolRunner.run(new Configuration(), new InstanceBenchmark(), args));
+	}
+}
@@ -0,0 +1,547 @@
+package org.apache.hadoop.fs.connector.generic.bench;
+
+import java.io.IOException;
+
+import java.net.URI;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Random;
+import java.util.TreeMap;
+import java.util.concurrent.Callable;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+import org.apache.hadoop.conf.Configuration;
+import org.apache.hadoop.conf.Configured;
+import org.apache.hadoop.fs.FSDataInputStream;
+import org.apache.hadoop.fs.FSDataOutputStream;
+import org.apache.hadoop.fs.FileSystem;
+import org.apache.hadoop.fs.LocatedFileStatus;
+import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.RemoteIterator;
+import org.apache.hadoop.util.Tool;
+import org.apache.hadoop.util.ToolRunner;
+
+// Measures the connector under workloads like those of TestDFSIO and NNBench:
+// large sequential writes and reads, random positional reads, storms of small
+// files created and deleted, listings of deep trees, renames, and a mix of
+// them. Each workload runs once for every thread count, with every thread
+// issuing its operations at once, and reports throughput and latency
+// percentiles per operation, and its scaling against the first thread count.
+// Built with the standin profile, the library runs against a local stand-in
+// for remote storage (see fs/standin.c).
+//
+// Usage: WorkloadBenchmark <uri> [-workloads write,read,pread,small,list,rename,mixed]
+//        [-threads 1,2,4,8] [-files 4] [-size 67108864] [-buffer 1048576]
+//        [-reads 1000] [-record 65536] [-small 1000] [-small.size 1024]
+//        [-depth 3] [-fanout 8] [-lists 10] [-renames 1000] [-ops 1000]
+public class WorkloadBenchmark extends Configured implements Tool {
+
+	private static final String USAGE = "Usage: WorkloadBenchmark <uri> [-workloads write,read,pread,small,list,rename,mixed] [-threads 1,2,4,8] "
+		+ "[-files 4] [-size 67108864] [-buffer 1048576] [-reads 1000] [-record 65536] [-small 1000] [-small.size 1024] "
+		+ "[-depth 3] [-fanout 8] [-lists 10] [-renames 1000] [-ops 1000]";
+
+	// Latencies and bytes of one kind of operation
+	private static class Samples {
+		private long[] latencies = new long[1024];
+		private int count = 0;
+		private int errors = 0;
+		private long bytes = 0;
+
+		private void add(long latency, long bytes) {
+			if(count == latencies.length) latencies = Arrays.copyOf(latencies, count * 2);
+			latencies[count++] = latency;
+			this.bytes += bytes;
+		}
+
+		private void merge(Samples other) {
+			if(count + other.count > latencies.length) latencies = Arrays.copyOf(latencies, count + other.count);
+			System.arraycopy(other.latencies, 0, latencies, count, other.count);
+			count += other.count;
+			errors += other.errors;
+			bytes += other.bytes;
+		}
+
+		// Nearest-rank percentile (latencies must be sorted)
+		private long percentile(double p) {
+			if(count == 0) return 0;
+			return latencies[Math.max(0, Math.min(count - 1, (int) Math.ceil(p / 100 * count) - 1))];
+		}
+	}
+
+	// Samples of every operation of one thread (or of a whole run, once merged)
+	private static class Recorder {
+		private final Map<String, Samples> samples = new TreeMap<String, Samples>();
+
+		private Samples get(String operation) {
+			Samples res = samples.get(operation);
+
+			if(res == null) {
+				res = new Samples();
+				samples.put(operation, res);
+			}
+			return res;
+		}
+
+		private void add(String operation, long start, long bytes) {
+			get(operation).add(System.nanoTime() - start, bytes);
+		}
+
+		// Injected errors are counted instead of ending the run
+		private void fail(String operation) {
+			get(operation).errors++;
+		}
+
+		private void merge(Recorder other) {
+			for(Map.Entry<String, Samples> entry : other.samples.entrySet()) get(entry.getKey()).merge(entry.getValue());
+		}
+	}
+
+	// Workload with an untimed preparation, run by every thread at once
+	private abstract class Workload {
+		protected final String name;
+
+		protected Workload(String name) {
+			this.name = name;
+		}
+
+		protected void prepare(FileSystem fs, Path dir, int threads) throws IOException {
+			fs.mkdirs(dir);
+		}
+
+		protected abstract void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder);
+	}
+
+	private final Map<String, String> options = new HashMap<String, String>();
+	private byte[] payload;
+
+	private int option(String name, int fallback) {
+		return options.containsKey(name) ? Integer.parseInt(options.get(name)) : fallback;
+	}
+
+	private long option(String name, long fallback) {
+		return options.containsKey(name) ? Long.parseLong(options.get(name)) : fallback;
+	}
+
+	private String option(String name, String fallback) {
+		return options.containsKey(name) ? options.get(name) : fallback;
+	}
+
+	// Writes len bytes sequentially
+	private void write(FileSystem fs, Path file, long len) throws IOException {
+		FSDataOutputStream out = fs.create(file, true);
+
+		try {
+			for(long done = 0; done < len; done += payload.length) out.write(payload, 0, (int) Math.min(payload.length, len - done));
+		}
+		finally {
+			out.close();
+		}
+	}
+
+	// Reads a whole file sequentially
+	private long read(FileSystem fs, Path file, byte[] buffer) throws IOException {
+		FSDataInputStream in = fs.open(file);
+		long total = 0;
+		int res;
+
+		try {
+			while((res = in.read(buffer, 0, buffer.length)) > 0) total += res;
+		}
+		finally {
+			in.close();
+		}
+		return total;
+	}
+
+	// Creates a tree of depth levels of fanout directories, with a file in each leaf
+	private void tree(FileSystem fs, Path dir, int depth, int fanout) throws IOException {
+		if(depth == 0) {
+			write(fs, new Path(dir, "leaf"), 0);
+			return;
+		}
+		for(int i = 0; i < fanout; i++) tree(fs, new Path(dir, "d" + i), depth - 1, fanout);
+	}
+
+	private Workload[] workloads() {
+		final int files = option("files", 4);
+		final long size = option("size", 64L * 1024 * 1024);
+		final int reads = option("reads", 1000);
+		final int record = option("record", 64 * 1024);
+		final int small = option("small", 1000);
+		final int smallSize = option("small.size", 1024);
+		final int depth = option("depth", 3);
+		final int fanout = option("fanout", 8);
+		final int lists = option("lists", 10);
+		final int renames = option("renames", 1000);
+		final int ops = option("ops", 1000);
+
+		return new Workload[] {
+
+			// Large sequential writes, one file after another
+			new Workload("write") {
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					for(int i = 0; i < files; i++) {
+						long start = System.nanoTime();
+						try {
+							write(fs, new Path(dir, "large-" + thread + "-" + i), size);
+							recorder.add("write", start, size);
+						}
+						catch(IOException e) {
+							recorder.fail("write");
+						}
+					}
+				}
+			},
+
+			// Large sequential reads, one file after another
+			new Workload("read") {
+				@Override
+				protected void prepare(FileSystem fs, Path dir, int threads) throws IOException {
+					super.prepare(fs, dir, threads);
+					for(int t = 0; t < threads; t++) {
+						for(int i = 0; i < files; i++) write(fs, new Path(dir, "large-" + t + "-" + i), size);
+					}
+				}
+
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					byte[] buffer = new byte[payload.length];
+
+					for(int i = 0; i < files; i++) {
+						long start = System.nanoTime();
+						try {
+							recorder.add("read", start, read(fs, new Path(dir, "large-" + thread + "-" + i), buffer));
+						}
+						catch(IOException e) {
+							recorder.fail("read");
+						}
+					}
+				}
+			},
+
+			// Random positional reads of records of a file shared by every thread
+			new Workload("pread") {
+				@Override
+				protected void prepare(FileSystem fs, Path dir, int threads) throws IOException {
+					super.prepare(fs, dir, threads);
+					write(fs, new Path(dir, "shared"), size);
+				}
+
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					byte[] buffer = new byte[record];
+					FSDataInputStream in;
+
+					try {
+						in = fs.open(new Path(dir, "shared"));
+					}
+					catch(IOException e) {
+						recorder.fail("pread");
+						return;
+					}
+					try {
+						for(int i = 0; i < reads; i++) {
+							long position = (long) (random.nextDouble() * Math.max(1, size - record)), start = System.nanoTime();
+							try {
+								in.readFully(position, buffer, 0, (int) Math.min(record, size));
+								recorder.add("pread", start, Math.min(record, size));
+							}
+							catch(IOException e) {
+								recorder.fail("pread");
+							}
+						}
+					}
+					finally {
+						try {
+							in.close();
+						}
+						catch(IOException e) {
+							recorder.fail("close");
+						}
+					}
+				}
+			},
+
+			// Storm of small files, created and then deleted
+			new Workload("small") {
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					Path parent = new Path(dir, "t" + thread);
+
+					for(int i = 0; i < small; i++) {
+						long start = System.nanoTime();
+						try {
+							write(fs, new Path(parent, "small-" + i), smallSize);
+							recorder.add("create", start, smallSize);
+						}
+						catch(IOException e) {
+							recorder.fail("create");
+						}
+					}
+					for(int i = 0; i < small; i++) {
+						long start = System.nanoTime();
+						try {
+							fs.delete(new Path(parent, "small-" + i), false);
+							recorder.add("delete", start, 0);
+						}
+						catch(IOException e) {
+							recorder.fail("delete");
+						}
+					}
+				}
+			},
+
+			// Recursive listings of a deep tree shared by every thread
+			new Workload("list") {
+				@Override
+				protected void prepare(FileSystem fs, Path dir, int threads) throws IOException {
+					super.prepare(fs, dir, threads);
+					tree(fs, dir, depth, fanout);
+				}
+
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					for(int i = 0; i < lists; i++) {
+						long start = System.nanoTime();
+						try {
+							RemoteIterator<LocatedFileStatus> it = fs.listFiles(dir, true);
+							while(it.hasNext()) it.next();
+							recorder.add("listFiles", start, 0);
+						}
+						catch(IOException e) {
+							recorder.fail("listFiles");
+						}
+					}
+				}
+			},
+
+			// Renames of a file back and forth
+			new Workload("rename") {
+				@Override
+				protected void prepare(FileSystem fs, Path dir, int threads) throws IOException {
+					super.prepare(fs, dir, threads);
+					for(int t = 0; t < threads; t++) write(fs, new Path(dir, "a-" + t), 0);
+				}
+
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					Path a = new Path(dir, "a-" + thread), b = new Path(dir, "b-" + thread);
+					boolean renamed = false;
+
+					// Renames returning false failed too (the file stays where it was)
+					for(int i = 0; i < renames; i++) {
+						long start = System.nanoTime();
+						try {
+							if(fs.rename(renamed ? b : a, renamed ? a : b)) {
+								renamed = !renamed;
+								recorder.add("rename", start, 0);
+							}
+							else recorder.fail("rename");
+						}
+						catch(IOException e) {
+							recorder.fail("rename");
+						}
+					}
+				}
+			},
+
+			// Mix of the above on a shared namespace, as seen by a busy cluster:
+			// positional reads (50%), stats (20%), small files (10%), listings
+			// (10%) and renames (10%)
+			new Workload("mixed") {
+				@Override
+				protected void prepare(FileSystem fs, Path dir, int threads) throws IOException {
+					super.prepare(fs, dir, threads);
+					write(fs, new Path(dir, "shared"), size);
+					for(int t = 0; t < threads; t++) write(fs, new Path(dir, "a-" + t), 0);
+				}
+
+				@Override
+				protected void run(FileSystem fs, Path dir, int thread, Random random, Recorder recorder) {
+					byte[] buffer = new byte[record];
+					Path shared = new Path(dir, "shared"), a = new Path(dir, "a-" + thread), b = new Path(dir, "b-" + thread), file;
+					FSDataInputStream in;
+					boolean renamed = false;
+
+					try {
+						in = fs.open(shared);
+					}
+					catch(IOException e) {
+						recorder.fail("pread");
+						return;
+					}
+					try {
+						for(int i = 0; i < ops; i++) {
+							int dice = random.nextInt(10);
+							long start = System.nanoTime();
+							String operation = dice < 5 ? "pread" : dice < 7 ? "stat" : dice < 8 ? "small" : dice < 9 ? "listStatus" : "rename";
+							try {
+								switch(dice) {
+									case 0: case 1: case 2: case 3: case 4:
+										in.readFully((long) (random.nextDouble() * Math.max(1, size - record)), buffer, 0, (int) Math.min(record, size));
+										recorder.add(operation, start, Math.min(record, size));
+										break;
+									case 5: case 6:
+										fs.getFileStatus(shared);
+										recorder.add(operation, start, 0);
+										break;
+									case 7:
+										file = new Path(dir, "small-" + thread + "-" + i);
+										write(fs, file, smallSize);
+										fs.delete(file, false);
+										recorder.add(operation, start, smallSize);
+										break;
+									case 8:
+										fs.listStatus(dir);
+										recorder.add(operation, start, 0);
+										break;
+									default:
+										if(fs.rename(renamed ? b : a, renamed ? a : b)) {
+											renamed = !renamed;
+											recorder.add(operation, start, 0);
+										}
+										else recorder.fail(operation);
+								}
+							}
+							catch(IOException e) {
+								recorder.fail(operation);
+							}
+						}
+					}
+					finally {
+						try {
+							in.close();
+						}
+						catch(IOException e) {
+							recorder.fail("close");
+						}
+					}
+				}
+			}
+		};
+	}
+
+	// Runs a workload from several threads, started at once
+	private Recorder run(final FileSystem fs, final Workload workload, final Path dir, int threads, long[] elapsed) throws Exception {
+		final CountDownLatch ready = new CountDownLatch(threads), go = new CountDownLatch(1);
+		List<Future<Recorder>> results = new ArrayList<Future<Recorder>>();
+		ExecutorService executor = Executors.newFixedThreadPool(threads);
+		Recorder total = new Recorder();
+		long start;
+
+		for(int t = 0; t < threads; t++) {
+			final int thread = t;
+			results.add(executor.submit(new Callable<Recorder>() {
+				@Override
+				public Recorder call() throws Exception {
+					Recorder recorder = new Recorder();
+					Random random = new Random(31L * thread + workload.name.hashCode());
+
+					ready.countDown();
+					go.await();
+					workload.run(fs, dir, thread, random, recorder);
+					return recorder;
+				}
+			}));
+		}
+		ready.await();
+		start = System.nanoTime();
+		go.countDown();
+		for(Future<Recorder> result : results) total.merge(result.get());
+		elapsed[0] = System.nanoTime() - start;
+		executor.shutdown();
+
+		return total;
+	}
+
+	@Override
+	public int run(String[] args) throws Exception {
+		Map<String, Double> baseline = new HashMap<String, Double>();
+		List<Integer> counts = new ArrayList<Integer>();
+		List<String> selected;
+		Configuration conf;
+		Path base, dir;
+		FileSystem fs;
+		Recorder recorder;
+		long[] elapsed = new long[1];
+		URI uri;
+
+		if(args.length < 1 || args.length % 2 == 0) {
+			System.err.println(USAGE);
+			return 1;
+		}
+		uri = new URI(args[0]);
+		for(int i = 1; i < args.length; i += 2) {
+			if(!args[i].startsWith("-")) {
+				System.err.println(USAGE);
+				return 1;
+			}
+			options.put(args[i].substring(1), args[i + 1]);
+		}
+		selected = Arrays.asList(option("workloads", "write,read,pread,small,list,rename,mixed").split(","));
+		for(String count : option("threads", "1,2,4,8").split(",")) counts.add(Integer.parseInt(count.trim()));
+		payload = new byte[option("buffer", 1024 * 1024)];
+		new Random(0).nextBytes(payload);
+
+		// Statistics and caches of one run must not leak into the next
+		conf = new Configuration(getConf());
+		conf.setBoolean("fs." + uri.getScheme() + ".impl.disable.cache", true);
+		base = new Path(uri.resolve("/").toString(), "workload-benchmark-" + System.currentTimeMillis());
+
+		for(Workload workload : workloads()) {
+			if(!selected.contains(workload.name)) continue;
+
+			for(int threads : counts) {
+				fs = FileSystem.newInstance(uri, conf);
+				try {
+					dir = new Path(base, workload.name + "-" + threads);
+					workload.prepare(fs, dir, threads);
+					recorder = run(fs, workload, dir, threads, elapsed);
+					fs.delete(dir, true);
+				}
+				finally {
+					fs.close();
+				}
+
+				// One line per operation, scaling relative to the first thread count
+				for(Map.Entry<String, Samples> entry : recorder.samples.entrySet()) {
+					String key = workload.name + "/" + entry.getKey();
+					Samples samples = entry.getValue();
+					double throughput = samples.count / (elapsed[0] / 1e9);
+
+					Arrays.sort(samples.latencies, 0, samples.count);
+					if(!baseline.containsKey(key)) baseline.put(key, throughput);
+					System.out.println(String.format("workload=%s op=%s threads=%d ops=%d errors=%d elapsed=%.1fms throughput=%.1f ops/s bandwidth=%.1f MB/s "
+						+ "p50=%.1fus p90=%.1fus p99=%.1fus p999=%.1fus max=%.1fus scaling=%.2fx",
+						workload.name, entry.getKey(), threads, samples.count, samples.errors, elapsed[0] / 1e6,
+						throughput, samples.bytes / 1048576.0 / (elapsed[0] / 1e9),
+						samples.percentile(50) / 1e3, samples.percentile(90) / 1e3, samples.percentile(99) / 1e3,
+						samples.percentile(99.9) / 1e3, samples.percentile(100) / 1e3,
+						baseline.get(key) > 0 ? throughput / baseline.get(key) : 0));
+				}
+			}
+		}
+
+		fs = FileSystem.newInstance(uri, conf);
+		try {
+			fs.delete(base, true);
+		}
+		finally {
+			fs.close();
+		}
+
+		return 0;
+	}
+
+	public static void main(String[] args) throws Exception {
+		System.exit(ToolRunner.run(new Configuration(), new WorkloadBenchmark(), args));
+	}
+}
@@ -0,0 +1,236 @@
+package org.apache.hadoop.fs.connector.generic.commit;
+
+import java.io.BufferedReader;
+import java.io.BufferedWriter;
+import java.io.IOException;
+import java.io.InputStreamReader;
+import java.io.OutputStreamWriter;
+
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeSet;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+import org.apache.hadoop.classification.InterfaceAudience;
+import org.apache.hadoop.classification.InterfaceStability;
+import org.apache.hadoop.conf.Configuration;
+import org.apache.hadoop.fs.FileStatus;
+import org.apache.hadoop.fs.FileSystem;
+import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.connector.generic.GenericFileSystem;
+import org.apache.hadoop.mapreduce.JobContext;
+import org.apache.hadoop.mapreduce.TaskAttemptContext;
+import org.apache.hadoop.mapreduce.lib.output.FileOutputCommitter;
+
+// Output committer for the generic file system. Tasks do not move any data on
+// commit: they only record the files they produced in a manifest. The job
+// commit then renames every file to its final location in native batches, so
+// its duration depends on the number of cores rather than on the file count.
+@InterfaceAudience.Public
+@InterfaceStability.Evolving
+public class GenericOutputCommitter extends FileOutputCommitter {
+
+	public final static Log LOG = LogFactory.getLog(GenericOutputCommitter.class);
+
+	public static final String MANIFESTS_DIR_NAME = "_manifests";
+	private static final String MANIFEST_TMP_SUFFIX = ".tmp";
+	private static final int RENAME_BATCH_SIZE = 10000;
+
+	private final Path outputPath;
+
+	public GenericOutputCommitter(Path outputPath, TaskAttemptContext context) throws IOException {
+		super(outputPath, context);
+		this.outputPath = outputPath;
+	}
+
+	public GenericOutputCommitter(Path outputPath, JobContext context) throws IOException {
+		super(outputPath, context);
+		this.outputPath = outputPath;
+	}
+
+	private Path getManifestsPath(JobContext context) {
+		return new Path(getJobAttemptPath(context), MANIFESTS_DIR_NAME);
+	}
+
+	// Collects every file below dir (directories themselves are not recorded)
+	private static void collectFiles(FileSystem fs, Path dir, List<FileStatus> files) throws IOException {
+		for(FileStatus status : fs.listStatus(dir)) {
+			if(status.isDirectory()) collectFiles(fs, status.getPath(), files);
+			else files.add(status);
+		}
+	}
+
+	@Override
+	public void commitTask(TaskAttemptContext context) throws IOException {
+		Path taskAttemptPath, manifest, tmp;
+		List<FileStatus> files;
+		BufferedWriter writer;
+		FileSystem fs;
+		String root;
+
+		// No output path means nothing to commit
+		if(outputPath == null) return;
+
+		taskAttemptPath = getTaskAttemptPath(context);
+		fs = taskAttemptPath.getFileSystem(context.getConfiguration());
+
+		if(!fs.exists(taskAttemptPath)) {
+			LOG.warn("No output found for " + context.getTaskAttemptID());
+			return;
+		}
+
+		// Record every produced file relative to the task attempt directory
+		files = new ArrayList<FileStatus>();
+		collectFiles(fs, taskAttemptPath, files);
+		root = taskAttemptPath.toUri().getPath() + Path.SEPARATOR;
+
+		// Write manifest aside and publish it with a rename, so that a failed
+		// attempt never leaves a partial manifest behind
+		manifest = new Path(getManifestsPath(context), context.getTaskAttemptID().getTaskID().toString());
+		tmp = new Path(getManifestsPath(context), context.getTaskAttemptID().toString() + MANIFEST_TMP_SUFFIX);
+		writer = new BufferedWriter(new OutputStreamWriter(fs.create(tmp, true), "UTF-8"));
+		try {
+			writer.write(taskAttemptPath.toString());
+			writer.newLine();
+			for(FileStatus file : files) {
+				writer.write(file.getPath().toUri().getPath().substring(root.length()));
+				writer.newLine();
+			}
+		}
+		finally {
+			writer.close();
+		}
+		fs.delete(manifest, false);
+		if(!fs.rename(tmp, manifest)) throw new IOException("Could not publish manifest " + manifest);
+
+		LOG.info("Saved manifest of " + files.size() + " files for " + context.getTaskAttemptID());
+	}
+
+	@Override
+	public boolean isRecoverySupported() {
+
+		// Manifests belong to a single application attempt
+		return false;
+	}
+
+	// Reads one manifest, adding a source and a destination for each file
+	private void readManifest(FileSystem fs, Path manifest, List<Path> srcs, List<Path> dsts) throws IOException {
+		BufferedReader reader;
+		Path taskAttemptPath;
+		String line;
+
+		reader = new BufferedReader(new InputStreamReader(fs.open(manifest), "UTF-8"));
+		try {
+			line = reader.readLine();
+			if(line == null) throw new IOException("Empty manifest " + manifest);
+			taskAttemptPath = new Path(line);
+			while((line = reader.readLine()) != null) {
+				if(line.isEmpty()) continue;
+				srcs.add(new Path(taskAttemptPath, line));
+				dsts.add(new Path(outputPath, line));
+			}
+		}
+		finally {
+			reader.close();
+		}
+	}
+
+	// Renames through native batches when possible, one by one otherwise
+	private int renameAll(FileSystem fs, List<Path> srcs, List<Path> dsts, List<IOException> failures) throws IOException {
+		int batches = 0;
+
+		if(fs instanceof GenericFileSystem) {
+			for(int from = 0; from < srcs.size(); from += RENAME_BATCH_SIZE) {
+				int to = Math.min(from + RENAME_BATCH_SIZE, srcs.size());
+				Map<Path, IOException> results;
+
+				results = ((GenericFileSystem) fs).renameBatch(srcs.subList(from, to).toArray(new Path[to - from]), dsts.subList(from, to).toArray(new Path[to - from]));
+				for(Map.Entry<Path, IOException> result : results.entrySet()) {
+					if(result.getValue() != null) failures.add(new IOException("Could not commit " + result.getKey(), result.getValue()));
+				}
+				batches++;
+			}
+		}
+		else {
+			for(int i = 0; i < srcs.size(); i++) {
+
+				// Replace previous output as FileOutputCommitter does
+				if(!fs.rename(srcs.get(i), dsts.get(i)) && (!fs.delete(dsts.get(i), false) || !fs.rename(srcs.get(i), dsts.get(i)))) {
+					failures.add(new IOException("Could not commit " + srcs.get(i)));
+				}
+			}
+		}
+
+		return batches;
+	}
+
+	@Override
+	@SuppressWarnings("deprecation")
+	public void commitJob(JobContext context) throws IOException {
+		long start, loaded, created, renamed, cleaned;
+		List<Path> srcs, dsts;
+		List<IOException> failures;
+		TreeSet<String> dirs;
+		Configuration conf;
+		Path manifestsPath;
+		FileSystem fs;
+		String previous = null;
+		int manifests = 0, batches;
+
+		// No output path means nothing to commit
+		if(outputPath == null) return;
+
+		conf = context.getConfiguration();
+		fs = outputPath.getFileSystem(conf);
+		manifestsPath = getManifestsPath(context);
+
+		// Phase 1: load every task manifest
+		start = System.currentTimeMillis();
+		srcs = new ArrayList<Path>();
+		dsts = new ArrayList<Path>();
+		if(fs.exists(manifestsPath)) {
+			for(FileStatus manifest : fs.listStatus(manifestsPath)) {
+				if(manifest.getPath().getName().endsWith(MANIFEST_TMP_SUFFIX)) continue;
+				readManifest(fs, manifest.getPath(), srcs, dsts);
+				manifests++;
+			}
+		}
+		loaded = System.currentTimeMillis();
+
+		// Phase 2: create destination directories (deepest ones only, as mkdirs
+		// creates their parents)
+		dirs = new TreeSet<String>();
+		dirs.add(outputPath.toString());
+		for(Path dst : dsts) dirs.add(dst.getParent().toString());
+		for(Iterator<String> it = dirs.descendingIterator(); it.hasNext();) {
+			String dir = it.next();
+			if(previous != null && previous.startsWith(dir + Path.SEPARATOR)) continue;
+			fs.mkdirs(new Path(dir));
+			previous = dir;
+		}
+		created = System.currentTimeMillis();
+
+		// Phase 3: move every file to its final location
+		failures = new ArrayList<IOException>();
+		batches = renameAll(fs, srcs, dsts, failures);
+		if(!failures.isEmpty()) {
+			for(IOException failure : failures) LOG.error(failure.getMessage(), failure.getCause());
+			throw new IOException("Job commit failed for " + failures.size() + " of " + srcs.size() + " files", failures.get(0));
+		}
+		renamed = System.currentTimeMillis();
+
+		// Phase 4: remove temporary data and mark success
+		cleanupJob(context);
+		if(conf.getBoolean(SUCCESSFUL_JOB_OUTPUT_DIR_MARKER, true)) {
+			fs.create(new Path(outputPath, SUCCEEDED_FILE_NAME), true).close();
+		}
+		cleaned = System.currentTimeMillis();
+
+		LOG.info("Committed " + srcs.size() + " files from " + manifests + " manifests in " + batches + " native batches: "
+			+ "load=" + (loaded - start) + "ms, mkdirs=" + (created - loaded) + "ms, rename=" + (renamed - created) + "ms, cleanup=" + (cleaned - renamed) + "ms");
+	}
+}
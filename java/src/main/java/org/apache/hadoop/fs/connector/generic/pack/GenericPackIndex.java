@@ -0,0 +1,317 @@
+package org.apache.hadoop.fs.connector.generic.pack;
+
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.IOException;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+
+// Index of the packed files of one container. A container is a sequence of
+// records, each one a packed file (or the deletion of one) with its name
+// relative to the packing root:
+//
+//   int magic, byte type, long mtime, UTF name, int length, byte[length] data
+//
+// Containers still being written are indexed by scanning their records. Once
+// sealed, an index file is written next to them, sorted by name with fixed
+// width slots, so that lookups are binary searches over its bytes as read (or
+// mapped) from the backend, without building any per-entry object:
+//
+//   int magic, int count, count * (long offset, long mtime, int length,
+//   int nameOffset, int nameLength, int type), names (UTF-8)
+public abstract class GenericPackIndex {
+
+	static final int RECORD_MAGIC = 0x47504b31;	// "GPK1"
+	static final int INDEX_MAGIC = 0x47504931;	// "GPI1"
+	static final byte TYPE_FILE = 0;
+	static final byte TYPE_DELETED = 1;
+
+	private static final int HEADER = 8;	// Index header
+	private static final int SLOT = 32;	// Index entry
+	private static final Charset UTF8 = Charset.forName("UTF-8");
+
+	// Packed file (or deletion) as found in one container
+	public static final class Entry {
+		private final GenericPackIndex index;
+		private final String name;
+		private final long offset;	// Of the data in the container
+		private final int length;
+		private final long modificationTime;
+		private final boolean deleted;
+
+		Entry(GenericPackIndex index, String name, long offset, int length, long modificationTime, boolean deleted) {
+			this.index = index;
+			this.name = name;
+			this.offset = offset;
+			this.length = length;
+			this.modificationTime = modificationTime;
+			this.deleted = deleted;
+		}
+
+		GenericPackIndex getIndex() {
+			return index;
+		}
+
+		public String getName() {
+			return name;
+		}
+
+		long getOffset() {
+			return offset;
+		}
+
+		public int getLength() {
+			return length;
+		}
+
+		public long getModificationTime() {
+			return modificationTime;
+		}
+
+		public boolean isDeleted() {
+			return deleted;
+		}
+
+		// Whether this entry supersedes another one of the same name (newer, or
+		// as new but in a later container)
+		boolean supersedes(Entry other) {
+			if(other == null) return true;
+			if(modificationTime != other.modificationTime) return modificationTime > other.modificationTime;
+
+			return index.getContainer().compareTo(other.index.getContainer()) >= 0;
+		}
+
+		// Same record of the same container
+		boolean isSame(Entry other) {
+			return other != null && index == other.index && offset == other.offset;
+		}
+	}
+
+	private final String container;	// Name of the container file
+
+	GenericPackIndex(String container) {
+		this.container = container;
+	}
+
+	String getContainer() {
+		return container;
+	}
+
+	// Latest entry of a name in this container (null if none)
+	abstract Entry find(String name);
+
+	// Latest entries of every name starting with prefix
+	abstract void collect(String prefix, Collection<Entry> into);
+
+	abstract int size();
+
+	// Latest entries of every name
+	void collectAll(Collection<Entry> into) {
+		collect("", into);
+	}
+
+	// Appends the record of a packed file (or of its deletion, if data is null)
+	// and gives the offset of its data within the record
+	static int writeRecord(DataOutputStream out, String name, long modificationTime, byte[] data, int len) throws IOException {
+		int start = out.size();
+
+		out.writeInt(RECORD_MAGIC);
+		out.writeByte(data == null ? TYPE_DELETED : TYPE_FILE);
+		out.writeLong(modificationTime);
+		out.writeUTF(name);
+		out.writeInt(data == null ? 0 : len);
+		if(data != null) out.write(data, 0, len);
+
+		return out.size() - start - (data == null ? 0 : len);
+	}
+
+	// Index of a container being written, built from its records
+	static final class Scanned extends GenericPackIndex {
+		private final TreeMap<String, Entry> entries = new TreeMap<String, Entry>();
+		private long length = 0L;	// Bytes of complete records
+
+		Scanned(String container) {
+			super(container);
+		}
+
+		long getLength() {
+			return length;
+		}
+
+		// Adds a record written at the given offset (data offset within it)
+		void add(String name, long recordOffset, int dataOffset, int len, long modificationTime, boolean deleted, int recordLength) {
+			entries.put(name, new Entry(this, name, recordOffset + dataOffset, len, modificationTime, deleted));
+			length = Math.max(length, recordOffset + recordLength);
+		}
+
+		// Reads records from the given stream (positioned at the end of the last
+		// complete one), up to the first incomplete or damaged record
+		void scan(DataInputStream in) throws IOException {
+			String name;
+			long modificationTime;
+			byte type;
+			int len, header;
+
+			while(true) {
+				try {
+					if(in.readInt() != RECORD_MAGIC) return;
+					type = in.readByte();
+					modificationTime = in.readLong();
+					name = in.readUTF();
+					len = in.readInt();
+					if(len < 0) return;
+					header = 4 + 1 + 8 + utfLength(name) + 4;
+					if(in.skipBytes(len) != len) return;
+				}
+				catch(EOFException e) {
+					return;
+				}
+				add(name, length, header, len, modificationTime, type == TYPE_DELETED, header + len);
+			}
+		}
+
+		@Override
+		Entry find(String name) {
+			return entries.get(name);
+		}
+
+		@Override
+		void collect(String prefix, Collection<Entry> into) {
+			for(Map.Entry<String, Entry> entry : entries.tailMap(prefix, true).entrySet()) {
+				if(!entry.getKey().startsWith(prefix)) break;
+				into.add(entry.getValue());
+			}
+		}
+
+		@Override
+		int size() {
+			return entries.size();
+		}
+
+		// Sorted index of every entry, to be written once the container is sealed
+		byte[] toBytes() throws IOException {
+			ByteArrayOutputStream bytes = new ByteArrayOutputStream();
+			DataOutputStream out = new DataOutputStream(bytes);
+			List<byte[]> names = new ArrayList<byte[]>(entries.size());
+			int nameOffset = 0;
+
+			out.writeInt(INDEX_MAGIC);
+			out.writeInt(entries.size());
+			for(Entry entry : entries.values()) {
+				byte[] name = entry.getName().getBytes(UTF8);
+
+				out.writeLong(entry.getOffset());
+				out.writeLong(entry.getModificationTime());
+				out.writeInt(entry.getLength());
+				out.writeInt(nameOffset);
+				out.writeInt(name.length);
+				out.writeInt(entry.isDeleted() ? TYPE_DELETED : TYPE_FILE);
+				names.add(name);
+				nameOffset += name.length;
+			}
+			for(byte[] name : names) out.write(name);
+			out.flush();
+
+			return bytes.toByteArray();
+		}
+	}
+
+	// Index of a sealed container, searched in place
+	static final class Sealed extends GenericPackIndex {
+		private final ByteBuffer buffer;
+		private final int count;
+		private final int names;	// Start of the names
+
+		Sealed(String container, ByteBuffer buffer) throws IOException {
+			super(container);
+			this.buffer = buffer;
+			if(buffer.limit() < HEADER || buffer.getInt(0) != INDEX_MAGIC) throw new IOException("Corrupt index of container " + container);
+			this.count = buffer.getInt(4);
+			this.names = HEADER + count * SLOT;
+			if(count < 0 || names > buffer.limit()) throw new IOException("Corrupt index of container " + container);
+		}
+
+		private String nameAt(int slot) {
+			byte[] name = new byte[buffer.getInt(HEADER + slot * SLOT + 24)];
+			ByteBuffer view = buffer.duplicate();
+
+			view.position(names + buffer.getInt(HEADER + slot * SLOT + 20));
+			view.get(name);
+			return new String(name, UTF8);
+		}
+
+		private Entry entryAt(int slot, String name) {
+			int base = HEADER + slot * SLOT;
+
+			return new Entry(this, name, buffer.getLong(base), buffer.getInt(base + 16), buffer.getLong(base + 8), buffer.getInt(base + 28) == TYPE_DELETED);
+		}
+
+		// First slot whose name is not lower than the given one
+		private int search(String name) {
+			int low = 0, high = count;
+
+			while(low < high) {
+				int mid = (low + high) >>> 1;
+
+				if(nameAt(mid).compareTo(name) < 0) low = mid + 1;
+				else high = mid;
+			}
+
+			return low;
+		}
+
+		@Override
+		Entry find(String name) {
+			int slot = search(name);
+
+			if(slot == count || !nameAt(slot).equals(name)) return null;
+			return entryAt(slot, name);
+		}
+
+		@Override
+		void collect(String prefix, Collection<Entry> into) {
+			for(int slot = search(prefix); slot < count; slot++) {
+				String name = nameAt(slot);
+
+				if(!name.startsWith(prefix)) break;
+				into.add(entryAt(slot, name));
+			}
+		}
+
+		@Override
+		int size() {
+			return count;
+		}
+	}
+
+	// Bytes taken by a name written with writeUTF (modified UTF-8 and its length)
+	private static int utfLength(String name) {
+		int len = 2;
+
+		for(int i = 0; i < name.length(); i++) {
+			char c = name.charAt(i);
+
+			if(c >= 0x0001 && c <= 0x007f) len += 1;
+			else if(c <= 0x07ff) len += 2;
+			else len += 3;
+		}
+
+		return len;
+	}
+
+	// Keeps, of several entries of the same names, the ones superseding the rest
+	static void merge(Collection<Entry> entries, Map<String, Entry> into) {
+		for(Entry entry : entries) {
+			if(entry.supersedes(into.get(entry.getName()))) into.put(entry.getName(), entry);
+		}
+	}
+}
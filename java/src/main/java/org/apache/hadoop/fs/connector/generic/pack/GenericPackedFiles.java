@@ -0,0 +1,686 @@
+package org.apache.hadoop.fs.connector.generic.pack;
+
+import java.io.BufferedInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.FileNotFoundException;
+import java.io.IOException;
+
+import java.nio.ByteBuffer;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.EnumSet;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+import java.util.UUID;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ScheduledThreadPoolExecutor;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.TimeUnit;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+import org.apache.hadoop.fs.BlockLocation;
+import org.apache.hadoop.fs.CreateFlag;
+import org.apache.hadoop.fs.FSDataInputStream;
+import org.apache.hadoop.fs.FileStatus;
+import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.permission.FsPermission;
+import org.apache.hadoop.fs.connector.generic.GenericFileSystem;
+
+// Small files of one filesystem instance, packed into large containers. Under
+// every packing root, small files are appended as records to a container in
+// the hidden directory .packed (one container per writer, so appends need no
+// coordination and their offsets are known), instead of each one taking its
+// own open, write, close and namespace entry. They are looked up in memory,
+// through the indexes of the containers, and read with a positional read.
+// Deletions append a record too, and a background compactor rewrites
+// containers that are mostly dead. Directories are not packed: the parents of
+// packed files are created as usual.
+//
+// Containers of other instances (or processes) are discovered by listing
+// .packed again once the refresh interval has passed. The view of the files
+// they write is therefore as stale as that interval, and the latest record of
+// a name (by modification time) wins.
+public final class GenericPackedFiles {
+
+	public final static Log LOG = LogFactory.getLog(GenericPackedFiles.class);
+
+	public static final String PACK_DIR_NAME = ".packed";
+	private static final String CONTAINER_SUFFIX = ".pack";
+	private static final String INDEX_SUFFIX = ".idx";
+	private static final int KNOWN_DIRECTORIES = 1024;
+
+	private final GenericFileSystem fs;
+	private final List<Root> roots = new ArrayList<Root>();
+	private final int threshold;	// Largest file packed
+	private final long containerSize;	// Size containers are sealed at
+	private final long refreshInterval;	// Milliseconds between listings of other writers' containers
+	private final float compactRatio;	// Live fraction below which sealed containers are compacted
+	private final long blockSize;
+	private final ScheduledExecutorService compactor;	// Null if compaction is disabled
+	private final Map<Path, Boolean> directories = new LinkedHashMap<Path, Boolean>(16, 0.75f, true) {
+		@Override
+		protected boolean removeEldestEntry(Map.Entry<Path, Boolean> eldest) {
+			return size() > KNOWN_DIRECTORIES;
+		}
+	};
+
+	// Packed file (or deletion) about to be appended
+	private static final class Record {
+		private final String name;
+		private final byte[] data;	// Null for deletions
+		private final int len;
+		private final long modificationTime;
+
+		private Record(String name, byte[] data, int len, long modificationTime) {
+			this.name = name;
+			this.data = data;
+			this.len = len;
+			this.modificationTime = modificationTime;
+		}
+	}
+
+	public GenericPackedFiles(GenericFileSystem fs, Collection<String> roots, int threshold, long containerSize, long refreshInterval, long compactInterval, float compactRatio, long blockSize) {
+		this.fs = fs;
+		this.threshold = Math.max(0, threshold);
+		this.containerSize = Math.max(1L, containerSize);
+		this.refreshInterval = Math.max(0L, refreshInterval);
+		this.compactRatio = compactRatio;
+		this.blockSize = blockSize;
+		for(String root : roots) {
+			if(!root.trim().isEmpty()) this.roots.add(new Root(pathOf(new Path(root.trim()))));
+		}
+
+		if(compactInterval > 0 && !this.roots.isEmpty()) {
+			this.compactor = new ScheduledThreadPoolExecutor(1, new ThreadFactory() {
+				@Override
+				public Thread newThread(Runnable r) {
+					Thread thread = new Thread(r, "generic-pack-compactor");
+					thread.setDaemon(true);
+					return thread;
+				}
+			});
+			this.compactor.scheduleWithFixedDelay(new Runnable() {
+				@Override
+				public void run() {
+					compact();
+				}
+			}, compactInterval, compactInterval, TimeUnit.MILLISECONDS);
+		}
+		else this.compactor = null;
+	}
+
+	public boolean isEnabled() {
+		return !roots.isEmpty();
+	}
+
+	public int getThreshold() {
+		return threshold;
+	}
+
+	private static String pathOf(Path f) {
+		String path = Path.getPathWithoutSchemeAndAuthority(f).toUri().getPath();
+
+		return path.length() > 1 && path.endsWith("/") ? path.substring(0, path.length() - 1) : path;
+	}
+
+	// Root a path may be packed under (null if none)
+	private Root rootOf(Path f) {
+		String path = pathOf(f);
+
+		for(Root root : roots) {
+			if(root.relative(path) != null) return root;
+		}
+
+		return null;
+	}
+
+	// Whether a file created at this path would be packed
+	public boolean isPacked(Path f) {
+		Root root = rootOf(f);
+
+		return root != null && !root.relative(pathOf(f)).isEmpty();
+	}
+
+	// Whether a tree rooted at this path may hold packed files (it is below a
+	// packing root or holds one)
+	public boolean covers(Path f) {
+		return rootOf(f) != null || holdsRoot(f);
+	}
+
+	// Whether this path is a packing root or one of its parents (so that its
+	// tree holds containers)
+	public boolean holdsRoot(Path f) {
+		String path = pathOf(f);
+
+		for(Root root : roots) {
+			if(root.path.equals(path) || root.path.startsWith(path.equals("/") ? path : path + "/")) return true;
+		}
+
+		return false;
+	}
+
+	// Same as covers, for the literal part of a glob pattern
+	public boolean coversPattern(Path pattern) {
+		String path = pathOf(pattern);
+		int i;
+
+		for(i = 0; i < path.length() && "*?[{\\".indexOf(path.charAt(i)) < 0; i++);
+		if(i == path.length()) return covers(pattern);
+		path = path.substring(0, i);
+
+		for(Root root : roots) {
+			if(root.path.startsWith(path) || path.startsWith(root.prefix)) return true;
+		}
+
+		return false;
+	}
+
+	// Status of a packed file (null if there is none at this path)
+	public FileStatus getFileStatus(Path f) throws IOException {
+		Root root = rootOf(f);
+		GenericPackIndex.Entry entry;
+
+		if(root == null) return null;
+		entry = root.find(root.relative(pathOf(f)));
+		if(entry == null || entry.isDeleted()) return null;
+
+		return root.status(entry, f);
+	}
+
+	// Contents of a packed file (null if there is none at this path)
+	public byte[] read(Path f) throws IOException {
+		Root root = rootOf(f);
+		GenericPackIndex.Entry entry;
+		String name;
+
+		if(root == null) return null;
+		name = root.relative(pathOf(f));
+		entry = root.find(name);
+		if(entry == null || entry.isDeleted()) return null;
+
+		// Containers compacted by other instances are gone before this view is
+		// refreshed, but their live records are in a newer container already
+		try {
+			return root.read(entry);
+		}
+		catch(FileNotFoundException e) {
+			LOG.debug("Container of " + f + " is gone, looking it up again");
+
+			entry = root.reload(name);
+			if(entry == null || entry.isDeleted()) return null;
+			return root.read(entry);
+		}
+	}
+
+	// Packs a file (replacing any packed file at this path)
+	public void write(Path f, byte[] data, int len) throws IOException {
+		Root root = rootOf(f);
+		List<Record> records = new ArrayList<Record>(1);
+
+		LOG.debug("Pack file " + f + " with " + len + "B");
+
+		records.add(new Record(root.relative(pathOf(f)), data, len, System.currentTimeMillis()));
+		root.append(records);
+	}
+
+	// Deletes the packed file at this path, or every packed file below it if
+	// recursive. Directories holding packed files are not empty.
+	public boolean delete(Path f, boolean recursive) throws IOException {
+		Root root = rootOf(f);
+		List<GenericPackIndex.Entry> entries;
+		List<Record> records;
+		String name;
+		long now;
+
+		if(root == null) return false;
+		name = root.relative(pathOf(f));
+		entries = root.live(name);
+		if(entries.isEmpty()) return false;
+		if(!recursive && (entries.size() > 1 || !entries.get(0).getName().equals(name))) throw new IOException("Directory " + f + " is not empty");
+
+		LOG.debug("Delete " + entries.size() + " packed files under " + f);
+
+		now = System.currentTimeMillis();
+		records = new ArrayList<Record>(entries.size());
+		for(GenericPackIndex.Entry entry : entries) records.add(new Record(entry.getName(), null, 0, now));
+		root.append(records);
+
+		return true;
+	}
+
+	// Packed files below (or at) this path
+	public boolean hasEntries(Path f) throws IOException {
+		Root root = rootOf(f);
+
+		return root != null && !root.live(root.relative(pathOf(f))).isEmpty();
+	}
+
+	// Moves the packed file at src, or every packed file below it, to dst. Those
+	// landing outside packing roots are written as regular files.
+	public void move(Path src, Path dst) throws IOException {
+		Root root = rootOf(src), target;
+		Map<Root, List<Record>> moved = new HashMap<Root, List<Record>>();
+		List<GenericPackIndex.Entry> entries;
+		List<Record> deleted;
+		String name;
+		Path path;
+		byte[] data;
+		long now;
+
+		// Deletion records would win over records moved onto the same name
+		if(root == null || pathOf(src).equals(pathOf(dst))) return;
+		name = root.relative(pathOf(src));
+		entries = root.live(name);
+		if(entries.isEmpty()) return;
+
+		LOG.debug("Move " + entries.size() + " packed files from " + src + " to " + dst);
+
+		now = System.currentTimeMillis();
+		deleted = new ArrayList<Record>(entries.size());
+		for(GenericPackIndex.Entry entry : entries) {
+			path = entry.getName().equals(name) ? dst : new Path(dst, entry.getName().substring(name.isEmpty() ? 0 : name.length() + 1));
+			data = root.read(entry);
+			target = rootOf(path);
+			if(target != null && !target.relative(pathOf(path)).isEmpty()) {
+				if(!moved.containsKey(target)) moved.put(target, new ArrayList<Record>());
+				moved.get(target).add(new Record(target.relative(pathOf(path)), data, data.length, now));
+			}
+			else fs.writeFile(path, data, EnumSet.of(CreateFlag.CREATE, CreateFlag.OVERWRITE));
+			deleted.add(new Record(entry.getName(), null, 0, now));
+		}
+		for(Map.Entry<Root, List<Record>> batch : moved.entrySet()) batch.getKey().append(batch.getValue());
+		root.append(deleted);
+	}
+
+	// Packed files directly in a directory, by name (null if it is not under a
+	// packing root)
+	public Map<String, FileStatus> list(Path dir) throws IOException {
+		Root root = rootOf(dir);
+		Map<String, FileStatus> res;
+		String name;
+
+		if(root == null) return null;
+		name = root.relative(pathOf(dir));
+		res = new LinkedHashMap<String, FileStatus>();
+		for(GenericPackIndex.Entry entry : root.live(name)) {
+			String child;
+
+			if(entry.getName().equals(name)) continue;
+			child = entry.getName().substring(name.isEmpty() ? 0 : name.length() + 1);
+			if(child.indexOf('/') >= 0) continue;
+			res.put(child, root.status(entry, new Path(dir, child)));
+		}
+
+		return res;
+	}
+
+	// Name of the entry a listing of this directory shall skip (null if none)
+	public String getHiddenName(Path dir) {
+		Root root = rootOf(dir);
+
+		return root != null && root.relative(pathOf(dir)).isEmpty() ? PACK_DIR_NAME : null;
+	}
+
+	// Locations of the part of the container holding a packed file
+	public BlockLocation[] getFileBlockLocations(FileStatus file, long start, long len) throws IOException {
+		Root root = rootOf(file.getPath());
+		GenericPackIndex.Entry entry;
+		BlockLocation[] locations;
+		Path container;
+
+		entry = root == null ? null : root.find(root.relative(pathOf(file.getPath())));
+		if(entry == null || entry.isDeleted()) throw new FileNotFoundException("File " + file.getPath() + " does not exist");
+
+		container = root.containerPath(entry.getIndex().getContainer());
+		locations = fs.getFileBlockLocations(new FileStatus(entry.getOffset() + entry.getLength(), false, 1, blockSize, 0L, container), entry.getOffset() + start, Math.min(len, entry.getLength() - start));
+		if(locations == null || locations.length == 0) return locations;
+
+		return new BlockLocation[] { new BlockLocation(locations[0].getNames(), locations[0].getHosts(), start, Math.min(len, entry.getLength() - start)) };
+	}
+
+	// Directories recently created (or found) as parents of packed files, so
+	// that packing does not cost a namespace operation for them
+	public boolean isKnownDirectory(Path dir) {
+		synchronized(directories) {
+			return directories.containsKey(dir);
+		}
+	}
+
+	public void addKnownDirectory(Path dir) {
+		synchronized(directories) {
+			directories.put(dir, Boolean.TRUE);
+		}
+	}
+
+	public void forgetDirectories() {
+		synchronized(directories) {
+			directories.clear();
+		}
+	}
+
+	// Rewrites the sealed containers of every root that are mostly dead
+	void compact() {
+		for(Root root : roots) {
+			try {
+				root.compact();
+			}
+			catch(IOException e) {
+				LOG.warn("Could not compact packed files under " + root.path, e);
+			}
+		}
+	}
+
+	// Stops compacting and seals the containers of this instance
+	public void shutdown() {
+		if(compactor != null) compactor.shutdownNow();
+		for(Root root : roots) {
+			try {
+				root.seal();
+			}
+			catch(IOException e) {
+				LOG.warn("Could not seal packed files under " + root.path, e);
+			}
+		}
+	}
+
+	// Packed files under one root
+	private final class Root {
+		private final String path;
+		private final String prefix;	// Path of children (with trailing slash)
+		private final Path packDir;
+		private final TreeMap<String, GenericPackIndex> indexes = new TreeMap<String, GenericPackIndex>();	// By container, oldest first
+		private final Map<String, Long> lengths = new HashMap<String, Long>();	// Container lengths as last listed
+		private final Set<String> own = new HashSet<String>();	// Containers written by this instance
+		private GenericPackIndex.Scanned active = null;	// Container being written
+		private long lastRefresh = 0L;
+		private String owner = "";
+		private String group = "";
+
+		private Root(String path) {
+			this.path = path;
+			this.prefix = path.equals("/") ? path : path + "/";
+			this.packDir = new Path(prefix + PACK_DIR_NAME);
+		}
+
+		// Name of a path relative to this root ("" for the root itself, null if it
+		// is not below it or is part of the containers)
+		private String relative(String f) {
+			String name;
+
+			if(f.equals(path)) return "";
+			if(!f.startsWith(prefix)) return null;
+			name = f.substring(prefix.length());
+			if(name.equals(PACK_DIR_NAME) || name.startsWith(PACK_DIR_NAME + "/")) return null;
+
+			return name;
+		}
+
+		private Path containerPath(String container) {
+			return new Path(packDir, container);
+		}
+
+		private FileStatus status(GenericPackIndex.Entry entry, Path f) {
+			return new FileStatus(entry.getLength(), false, 1, blockSize, entry.getModificationTime(), entry.getModificationTime(), FsPermission.getFileDefault(), owner, group, f);
+		}
+
+		// Latest entry of a name across containers
+		private synchronized GenericPackIndex.Entry find(String name) throws IOException {
+			GenericPackIndex.Entry best = null, entry;
+
+			refresh();
+			for(GenericPackIndex index : indexes.values()) {
+				entry = index.find(name);
+				if(entry != null && entry.supersedes(best)) best = entry;
+			}
+
+			return best;
+		}
+
+		// Latest entry of a name once containers are listed again, whatever the
+		// refresh interval
+		private synchronized GenericPackIndex.Entry reload(String name) throws IOException {
+			lastRefresh = 0L;
+			return find(name);
+		}
+
+		// Live packed files at (or below) a name
+		private synchronized List<GenericPackIndex.Entry> live(String name) throws IOException {
+			Map<String, GenericPackIndex.Entry> latest = new TreeMap<String, GenericPackIndex.Entry>();
+			List<GenericPackIndex.Entry> found = new ArrayList<GenericPackIndex.Entry>();
+			List<GenericPackIndex.Entry> res = new ArrayList<GenericPackIndex.Entry>();
+
+			refresh();
+			for(GenericPackIndex index : indexes.values()) {
+				found.clear();
+				index.collect(name, found);
+				GenericPackIndex.merge(found, latest);
+			}
+			for(GenericPackIndex.Entry entry : latest.values()) {
+				if(entry.isDeleted()) continue;
+				if(name.isEmpty() || entry.getName().equals(name) || entry.getName().startsWith(name + "/")) res.add(entry);
+			}
+
+			return res;
+		}
+
+		private byte[] read(GenericPackIndex.Entry entry) throws IOException {
+			byte[] data = new byte[entry.getLength()];
+			FSDataInputStream in;
+
+			in = fs.open(containerPath(entry.getIndex().getContainer()), 4096);
+			try {
+				in.readFully(entry.getOffset(), data);
+			}
+			finally {
+				in.close();
+			}
+
+			return data;
+		}
+
+		// Appends records to the container of this instance with a single write
+		private synchronized void append(List<Record> records) throws IOException {
+			ByteArrayOutputStream bytes = new ByteArrayOutputStream();
+			DataOutputStream out = new DataOutputStream(bytes);
+			int[] starts = new int[records.size()];
+			int[] offsets = new int[records.size()];
+			long base;
+
+			if(active == null) {
+				String container = String.format("%013d-%s%s", System.currentTimeMillis(), UUID.randomUUID(), CONTAINER_SUFFIX);
+
+				active = new GenericPackIndex.Scanned(container);
+				indexes.put(container, active);
+				own.add(container);
+			}
+
+			for(int i = 0; i < records.size(); i++) {
+				starts[i] = out.size();
+				offsets[i] = GenericPackIndex.writeRecord(out, records.get(i).name, records.get(i).modificationTime, records.get(i).data, records.get(i).len);
+			}
+			out.flush();
+
+			// A failed append may leave part of a record behind, which scans stop at
+			try {
+				fs.writeFile(containerPath(active.getContainer()), bytes.toByteArray(), EnumSet.of(CreateFlag.CREATE, CreateFlag.APPEND));
+			}
+			catch(IOException e) {
+				try {
+					seal();
+				}
+				catch(IOException f) {
+					LOG.debug("Could not seal container after a failed append", f);
+				}
+				throw e;
+			}
+
+			base = active.getLength();
+			for(int i = 0; i < records.size(); i++) {
+				Record record = records.get(i);
+				int end = i + 1 < records.size() ? starts[i + 1] : bytes.size();
+
+				active.add(record.name, base + starts[i], offsets[i], record.data == null ? 0 : record.len, record.modificationTime, record.data == null, end - starts[i]);
+			}
+			if(active.getLength() >= containerSize) seal();
+		}
+
+		// Writes the sorted index of the container of this instance, which is
+		// not written anymore
+		private synchronized void seal() throws IOException {
+			GenericPackIndex.Scanned sealed = active;
+			byte[] index;
+
+			if(sealed == null) return;
+			active = null;
+			if(sealed.size() == 0) {
+				indexes.remove(sealed.getContainer());
+				return;
+			}
+
+			LOG.debug("Seal container " + sealed.getContainer() + " with " + sealed.size() + " entries");
+
+			// Other instances keep scanning the container if the index is missing
+			index = sealed.toBytes();
+			fs.writeFile(containerPath(sealed.getContainer() + INDEX_SUFFIX), index, EnumSet.of(CreateFlag.CREATE, CreateFlag.OVERWRITE));
+			indexes.put(sealed.getContainer(), new GenericPackIndex.Sealed(sealed.getContainer(), ByteBuffer.wrap(index)));
+		}
+
+		// Picks up containers written (or removed) by other instances
+		private void refresh() throws IOException {
+			Set<String> listed = new HashSet<String>();
+			Map<String, Long> sealed = new HashMap<String, Long>();	// Index lengths
+			FileStatus[] statuses;
+			long now = System.currentTimeMillis();
+
+			if(now - lastRefresh < refreshInterval) return;
+			lastRefresh = now;
+
+			try {
+				statuses = fs.listStatus(packDir);
+			}
+			catch(FileNotFoundException e) {
+				statuses = new FileStatus[0];
+			}
+			lengths.clear();
+			for(FileStatus status : statuses) {
+				String name = status.getPath().getName();
+
+				if(name.endsWith(INDEX_SUFFIX)) sealed.put(name.substring(0, name.length() - INDEX_SUFFIX.length()), status.getLen());
+				else if(name.endsWith(CONTAINER_SUFFIX)) {
+					listed.add(name);
+					lengths.put(name, status.getLen());
+					owner = status.getOwner();
+					group = status.getGroup();
+				}
+			}
+
+			// Containers compacted away by other instances
+			for(String container : new ArrayList<String>(indexes.keySet())) {
+				if(!listed.contains(container) && (active == null || !container.equals(active.getContainer()))) indexes.remove(container);
+			}
+
+			for(String container : listed) {
+				GenericPackIndex index = indexes.get(container);
+
+				if(index instanceof GenericPackIndex.Sealed || (active != null && container.equals(active.getContainer()))) continue;
+
+				// Sealed containers are searched through their index
+				if(sealed.containsKey(container)) {
+					byte[] bytes = fs.readFile(containerPath(container + INDEX_SUFFIX), (int) Math.min(sealed.get(container), Integer.MAX_VALUE - 1));
+
+					indexes.put(container, new GenericPackIndex.Sealed(container, ByteBuffer.wrap(bytes)));
+					continue;
+				}
+
+				// Containers being written are scanned from where the last scan stopped
+				if(index == null) {
+					index = new GenericPackIndex.Scanned(container);
+					indexes.put(container, index);
+				}
+				if(lengths.get(container) > ((GenericPackIndex.Scanned) index).getLength()) scan((GenericPackIndex.Scanned) index);
+			}
+		}
+
+		private void scan(GenericPackIndex.Scanned index) throws IOException {
+			FSDataInputStream in;
+
+			LOG.debug("Scan container " + index.getContainer() + " from offset " + index.getLength());
+
+			in = fs.open(containerPath(index.getContainer()), 65536);
+			try {
+				in.seek(index.getLength());
+				index.scan(new DataInputStream(new BufferedInputStream(in, 65536)));
+			}
+			finally {
+				in.close();
+			}
+		}
+
+		// Copies the live entries of mostly dead sealed containers to the
+		// container of this instance, and removes them
+		private synchronized void compact() throws IOException {
+			List<GenericPackIndex.Entry> entries = new ArrayList<GenericPackIndex.Entry>();
+			List<GenericPackIndex.Entry> kept = new ArrayList<GenericPackIndex.Entry>();
+			List<Record> records = new ArrayList<Record>();
+			long liveBytes;
+
+			refresh();
+			for(GenericPackIndex index : new ArrayList<GenericPackIndex>(indexes.values())) {
+				if(!(index instanceof GenericPackIndex.Sealed) || !lengths.containsKey(index.getContainer())) continue;
+
+				entries.clear();
+				kept.clear();
+				liveBytes = 0L;
+				index.collectAll(entries);
+				for(GenericPackIndex.Entry entry : entries) {
+					if(!entry.isSame(find(entry.getName()))) continue;
+
+					// Deletions are kept while older records of the name remain elsewhere
+					if(!entry.isDeleted()) liveBytes += entry.getLength();
+					else if(!elsewhere(entry)) continue;
+					kept.add(entry);
+				}
+				if(liveBytes >= compactRatio * lengths.get(index.getContainer())) continue;
+
+				LOG.debug("Compact container " + index.getContainer() + " with " + liveBytes + "B live out of " + lengths.get(index.getContainer()) + "B");
+
+				// Live entries keep their modification time, and thus their precedence
+				records.clear();
+				for(GenericPackIndex.Entry entry : kept) {
+					byte[] data = entry.isDeleted() ? null : read(entry);
+
+					records.add(new Record(entry.getName(), data, data == null ? 0 : data.length, entry.getModificationTime()));
+				}
+				if(!records.isEmpty()) append(records);
+				indexes.remove(index.getContainer());
+				lengths.remove(index.getContainer());
+				try {
+					fs.delete(containerPath(index.getContainer() + INDEX_SUFFIX), false);
+					fs.delete(containerPath(index.getContainer()), false);
+				}
+				catch(IOException e) {
+					LOG.debug("Could not remove compacted container " + index.getContainer(), e);
+				}
+			}
+		}
+
+		// Whether another container holds a record of the same name
+		private boolean elsewhere(GenericPackIndex.Entry entry) {
+			for(GenericPackIndex index : indexes.values()) {
+				if(index != entry.getIndex() && index.find(entry.getName()) != null) return true;
+			}
+
+			return false;
+		}
+	}
+}
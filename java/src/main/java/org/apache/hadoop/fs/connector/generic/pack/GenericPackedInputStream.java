@@ -0,0 +1,80 @@
+package org.apache.hadoop.fs.connector.generic.pack;
+
+import java.io.EOFException;
+import java.io.IOException;
+
+import org.apache.hadoop.fs.FSInputStream;
+import org.apache.hadoop.fs.FileSystem.Statistics;
+
+// Packed file, read whole from its container when opened (it is small)
+public class GenericPackedInputStream extends FSInputStream {
+
+	private final byte[] data;
+	private final Statistics statistics;
+	private int offset = 0;
+
+	public GenericPackedInputStream(byte[] data, Statistics statistics) {
+		super();
+		this.data = data;
+		this.statistics = statistics;
+		statistics.incrementReadOps(1);
+	}
+
+	@Override
+	public synchronized int read() throws IOException {
+		if(offset == data.length) return -1;
+
+		statistics.incrementBytesRead(1);
+		return data[offset++] & 0xff;
+	}
+
+	@Override
+	public synchronized int read(byte b[], int off, int len) throws IOException {
+		if(b == null) throw new NullPointerException();
+		if(off < 0 || len < 0 || len > b.length - off) throw new IndexOutOfBoundsException();
+		if(len == 0) return 0;
+		if(offset == data.length) return -1;
+
+		len = Math.min(len, data.length - offset);
+		System.arraycopy(data, offset, b, off, len);
+		offset += len;
+
+		statistics.incrementBytesRead(len);
+		return len;
+	}
+
+	@Override
+	public int read(long position, byte[] b, int off, int len) throws IOException {
+		if(position < 0 || position > data.length) throw new EOFException("Cannot read at position " + position + " of a file of " + data.length + "B");
+		if(position == data.length) return len == 0 ? 0 : -1;
+
+		len = Math.min(len, data.length - (int) position);
+		System.arraycopy(data, (int) position, b, off, len);
+
+		statistics.incrementBytesRead(len);
+		return len;
+	}
+
+	@Override
+	public synchronized long getPos() throws IOException {
+		return offset;
+	}
+
+	@Override
+	public synchronized void seek(long pos) throws IOException {
+		if(pos < 0) throw new EOFException("Cannot seek to a negative offset");
+		if(pos > data.length) throw new EOFException("Cannot seek after EOF: pos=" + pos + ", fileLength=" + data.length);
+
+		offset = (int) pos;
+	}
+
+	@Override
+	public synchronized int available() throws IOException {
+		return data.length - offset;
+	}
+
+	@Override
+	public boolean seekToNewSource(long targetPos) throws IOException {
+		return false;
+	}
+}
@@ -0,0 +1,103 @@
+package org.apache.hadoop.fs.connector.generic.pack;
+
+import java.io.IOException;
+import java.io.OutputStream;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+import org.apache.hadoop.fs.FileSystem.Statistics;
+import org.apache.hadoop.fs.Path;
+
+// File created under a packing root. Its contents are kept in memory and
+// packed on close, unless they outgrow the threshold: the file is then
+// created as a regular one (through spill) and written on from there. Like
+// striped files, packed files are only visible once closed.
+public abstract class GenericPackedOutputStream extends OutputStream {
+
+	public final static Log LOG = LogFactory.getLog(GenericPackedOutputStream.class);
+
+	private final GenericPackedFiles packed;
+	private final Path path;
+	private final Statistics statistics;
+	private byte[] buffer = new byte[4096];
+	private int count = 0;	// Valid bytes of buffer
+	private OutputStream spilled = null;	// Regular file (once too large to pack)
+	private boolean closed = false;
+
+	public GenericPackedOutputStream(GenericPackedFiles packed, Path path, Statistics statistics) {
+		super();
+		this.packed = packed;
+		this.path = path;
+		this.statistics = statistics;
+	}
+
+	// Creates the regular file this one turns into
+	protected abstract OutputStream spill() throws IOException;
+
+	@Override
+	public synchronized void write(int b) throws IOException {
+		if(spilled == null && count == packed.getThreshold()) spillBuffer();
+		if(spilled != null) {
+			spilled.write(b);
+			return;
+		}
+		if(count == buffer.length) grow(count + 1);
+		buffer[count++] = (byte) b;
+	}
+
+	@Override
+	public synchronized void write(byte[] b, int off, int len) throws IOException {
+		if(b == null) throw new NullPointerException();
+		if(off < 0 || off > b.length || len < 0 || len > b.length - off) throw new IndexOutOfBoundsException();
+
+		if(spilled == null && len > packed.getThreshold() - count) spillBuffer();
+		if(spilled != null) {
+			spilled.write(b, off, len);
+			return;
+		}
+		if(len > buffer.length - count) grow(count + len);
+		System.arraycopy(b, off, buffer, count, len);
+		count += len;
+	}
+
+	private void grow(int size) {
+		byte[] grown = new byte[Math.min(packed.getThreshold(), Math.max(size, 2 * buffer.length))];
+
+		System.arraycopy(buffer, 0, grown, 0, count);
+		buffer = grown;
+	}
+
+	private void spillBuffer() throws IOException {
+		if(closed) throw new IOException("Stream of file " + path + " is closed");
+
+		LOG.debug("File " + path + " is too large to be packed, writing it as a regular file");
+
+		spilled = spill();
+		spilled.write(buffer, 0, count);
+		buffer = null;
+		count = 0;
+	}
+
+	// Packed files are only written when closed, as a whole
+	@Override
+	public synchronized void flush() throws IOException {
+		if(spilled != null) spilled.flush();
+	}
+
+	@Override
+	public synchronized void close() throws IOException {
+		if(closed) return;
+		closed = true;
+
+		if(spilled != null) {
+			spilled.close();
+			return;
+		}
+		packed.write(path, buffer, count);
+		buffer = null;
+
+		statistics.incrementBytesWritten(count);
+		statistics.incrementWriteOps(1);
+	}
+}
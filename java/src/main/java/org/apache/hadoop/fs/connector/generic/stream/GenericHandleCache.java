@@ -0,0 +1,242 @@
+package org.apache.hadoop.fs.connector.generic.stream;
+
+import java.io.IOException;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.TimeUnit;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+import org.apache.hadoop.fs.FileStatus;
+import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.connector.generic.GenericSession;
+
+// JVM-wide cache of backend file handles opened for reading. Streams reading
+// the same unmodified file share one handle through positional reads, and
+// handles stay open for a while after the last stream is closed, so repeated
+// opens of a file skip fs_open and fs_close. Each handle keeps the backend
+// session it was opened in until it is closed, and is only shared within it.
+public final class GenericHandleCache {
+
+	public final static Log LOG = LogFactory.getLog(GenericHandleCache.class);
+
+	private static final GenericHandleCache INSTANCE = new GenericHandleCache();
+
+	public static GenericHandleCache get() {
+		return INSTANCE;
+	}
+
+	// Backend descriptor for one version (modification time and length) of a file
+	public static final class Handle {
+		private final String key;
+		private final GenericSession session;
+		private final int fd;
+		private final long modificationTime;
+		private final long length;
+		private int refs = 0;	// Streams using this handle
+		private long idleSince = 0L;	// When refs dropped to zero
+		private boolean detached = false;	// Not reachable from the cache anymore
+
+		private Handle(String key, GenericSession session, int fd, long modificationTime, long length) {
+			this.key = key;
+			this.session = session;
+			this.fd = fd;
+			this.modificationTime = modificationTime;
+			this.length = length;
+		}
+
+		public int getFd() {
+			return fd;
+		}
+
+		public long getLength() {
+			return length;
+		}
+
+		public long getModificationTime() {
+			return modificationTime;
+		}
+	}
+
+	private final Map<String, Handle> handles = new HashMap<String, Handle>();	// Cached handles by path
+	private final LinkedHashMap<String, Handle> idle = new LinkedHashMap<String, Handle>();	// Unused handles, oldest first
+	private int maxIdle = 0;	// Zero disables caching
+	private long ttl = 0L;	// Milliseconds an unused handle stays open
+	private ScheduledExecutorService expirer = null;
+
+	private GenericHandleCache() {}
+
+	// Instances configure the cache they share, which keeps the largest size and
+	// TTL any of them asked for (a TTL of zero keeps handles until evicted)
+	public synchronized void configure(int maxIdle, long ttl) {
+		if(this.maxIdle == 0) this.ttl = Math.max(0L, ttl);
+		else if(this.ttl > 0) this.ttl = ttl <= 0 ? 0L : Math.max(this.ttl, ttl);
+		this.maxIdle = Math.max(this.maxIdle, maxIdle);
+
+		// Close expired handles even if no stream is opened for a while
+		if(this.maxIdle > 0 && this.ttl > 0 && expirer == null) {
+			expirer = Executors.newSingleThreadScheduledExecutor(new ThreadFactory() {
+				@Override
+				public Thread newThread(Runnable r) {
+					Thread thread = new Thread(r, "generic-handle-cache");
+					thread.setDaemon(true);
+					return thread;
+				}
+			});
+			expirer.scheduleWithFixedDelay(new Runnable() {
+				@Override
+				public void run() {
+					List<Handle> expired;
+
+					synchronized(GenericHandleCache.this) {
+						expired = expire(System.currentTimeMillis());
+					}
+					closeAll(expired);
+				}
+			}, this.ttl, Math.max(1L, this.ttl / 2), TimeUnit.MILLISECONDS);
+		}
+	}
+
+	public synchronized boolean isEnabled() {
+		return maxIdle > 0;
+	}
+
+	// Returns a handle for the given version of the file, opening it if needed
+	// (a file opened meanwhile gets a handle for the version actually opened)
+	public Handle acquire(GenericSession session, Path path, FileStatus status) throws IOException {
+		return acquire(session, path, status.getModificationTime(), status.getLen(), false);
+	}
+
+	// Returns the handle a stream gave back on unbuffer while it is still open,
+	// or a new one provided the file is still the same version
+	public Handle reacquire(GenericSession session, Path path, Handle released) throws IOException {
+		synchronized(this) {
+
+			// Handles are only closed once unused and out of the cache
+			if(!released.detached || released.refs > 0) {
+				if(released.refs++ == 0) idle.remove(released.key);
+				return released;
+			}
+		}
+
+		return acquire(session, path, released.modificationTime, released.length, true);
+	}
+
+	private Handle acquire(GenericSession session, Path path, long modificationTime, long length, boolean exact) throws IOException {
+		String key = session.getHandle() + ":" + path;
+		List<Handle> stale = new ArrayList<Handle>();
+		long[] version = new long[2];
+		Handle handle;
+		int fd;
+
+		synchronized(this) {
+			stale.addAll(expire(System.currentTimeMillis()));
+
+			// Reuse handle if file has not changed since it was opened
+			handle = handles.get(key);
+			if(handle != null && handle.modificationTime == modificationTime && handle.length == length) {
+				handle.refs++;
+				idle.remove(key);
+			}
+
+			// File changed, forget old handle (closed once its streams are done)
+			else if(handle != null) {
+				handles.remove(key);
+				handle.detached = true;
+				if(handle.refs == 0) {
+					idle.remove(key);
+					stale.add(handle);
+				}
+				handle = null;
+			}
+		}
+		closeAll(stale);
+		if(handle != null) return handle;
+
+		// Open file outside the lock, and learn which version it is
+		fd = open0(session.getHandle(), path, version);
+		if(exact && (version[0] != modificationTime || version[1] != length)) {
+			close0(session.getHandle(), fd);
+			throw new IOException("File " + path + " changed while its stream was unbuffered");
+		}
+		handle = new Handle(key, session.retain(), fd, version[0], version[1]);
+		handle.refs = 1;
+
+		synchronized(this) {
+
+			// Another stream may have opened the same file meanwhile
+			if(maxIdle > 0 && !handles.containsKey(key)) handles.put(key, handle);
+			else handle.detached = true;
+		}
+
+		return handle;
+	}
+
+	// Gives back a handle acquired by a stream
+	public void release(Handle handle) throws IOException {
+		List<Handle> expired = new ArrayList<Handle>();
+
+		synchronized(this) {
+			if(--handle.refs > 0) return;
+
+			// Detached handles are closed as soon as they are unused
+			if(handle.detached) expired.add(handle);
+			else {
+				handle.idleSince = System.currentTimeMillis();
+				idle.put(handle.key, handle);
+				expired.addAll(expire(handle.idleSince));
+			}
+		}
+
+		closeAll(expired);
+	}
+
+	// Removes idle handles beyond the size bound or older than the TTL
+	private List<Handle> expire(long now) {
+		List<Handle> expired = new ArrayList<Handle>();
+		Iterator<Handle> it = idle.values().iterator();
+
+		while(it.hasNext()) {
+			Handle handle = it.next();
+
+			if(idle.size() <= maxIdle && (ttl == 0 || now - handle.idleSince < ttl)) break;
+			it.remove();
+			handles.remove(handle.key);
+			handle.detached = true;
+			expired.add(handle);
+		}
+
+		return expired;
+	}
+
+	private static void closeAll(List<Handle> handles) {
+		for(Handle handle : handles) {
+			try {
+				close0(handle.session.getHandle(), handle.fd);
+			}
+			catch(IOException e) {
+				LOG.warn("Could not close cached handle for " + handle.key, e);
+			}
+			finally {
+				try {
+					handle.session.release();
+				}
+				catch(IOException e) {
+					LOG.warn("Could not release backend session of " + handle.key, e);
+				}
+			}
+		}
+	}
+
+	private static native int open0(long session, Path path, long[] version) throws IOException;
+	private static native void close0(long session, int fd) throws IOException;
+}
@@ -0,0 +1,110 @@
+package org.apache.hadoop.fs.connector.generic.stream;
+
+import java.util.Arrays;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.RejectedExecutionHandler;
+import java.util.concurrent.SynchronousQueue;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+// Policy and threads for hedged reads of one filesystem instance. Latencies of
+// positional reads are sampled and, once enough of them are known, a read that
+// takes longer than the configured percentile (and never less than the minimum
+// threshold) is also sent to another replica. The first response wins.
+public final class GenericHedgedReads {
+
+	public final static Log LOG = LogFactory.getLog(GenericHedgedReads.class);
+
+	private static final int SAMPLES = 1024;	// Latencies kept, newest replace oldest
+	private static final int SAMPLES_MIN = 64;	// Latencies needed before hedging
+	private static final int REFRESH = 64;	// New latencies between threshold updates
+
+	private final ThreadPoolExecutor executor;
+	private final double percentile;
+	private final long minThreshold;	// Milliseconds
+	private final long[] samples = new long[SAMPLES];	// Microseconds
+	private int count = 0;	// Valid samples
+	private int next = 0;	// Sample to be replaced next
+	private int fresh = 0;	// Samples since last threshold update
+	private volatile long threshold = -1L;	// Milliseconds, -1 until enough samples
+	private final AtomicLong hedges = new AtomicLong();
+	private final AtomicLong wins = new AtomicLong();
+
+	public GenericHedgedReads(int threads, double percentile, long minThreshold) {
+		final AtomicInteger created = new AtomicInteger();
+
+		this.percentile = Math.min(100.0, Math.max(0.0, percentile));
+		this.minThreshold = Math.max(1L, minThreshold);
+
+		// Threads are created on demand; if all of them are busy (or the pool is
+		// already shut down) reads run in the calling thread, as plain reads
+		this.executor = new ThreadPoolExecutor(0, Math.max(1, threads), 60L, TimeUnit.SECONDS, new SynchronousQueue<Runnable>(), new ThreadFactory() {
+			@Override
+			public Thread newThread(Runnable r) {
+				Thread thread = new Thread(r, "generic-hedged-read-" + created.incrementAndGet());
+				thread.setDaemon(true);
+				return thread;
+			}
+		}, new RejectedExecutionHandler() {
+			@Override
+			public void rejectedExecution(Runnable r, ThreadPoolExecutor executor) {
+				r.run();
+			}
+		});
+	}
+
+	ExecutorService getExecutor() {
+		return executor;
+	}
+
+	// Milliseconds a read may take before it is hedged (-1 if not known yet)
+	long getThreshold() {
+		return threshold;
+	}
+
+	synchronized void record(long nanos) {
+		long[] sorted;
+		int index;
+
+		samples[next] = nanos / 1000;
+		next = (next + 1) % SAMPLES;
+		if(count < SAMPLES) count++;
+
+		// Recompute percentile every now and then, not on every read
+		if(++fresh < REFRESH || count < SAMPLES_MIN) return;
+		fresh = 0;
+		sorted = Arrays.copyOf(samples, count);
+		Arrays.sort(sorted);
+		index = Math.max(0, Math.min(count - 1, (int) Math.ceil(percentile / 100.0 * count) - 1));
+		threshold = Math.max(minThreshold, sorted[index] / 1000);
+	}
+
+	void hedged() {
+		hedges.incrementAndGet();
+	}
+
+	void won() {
+		wins.incrementAndGet();
+	}
+
+	// Reads sent to a second replica, and how many of them answered first
+	public long getHedges() {
+		return hedges.get();
+	}
+
+	public long getWins() {
+		return wins.get();
+	}
+
+	public void shutdown() {
+		LOG.debug("Hedged reads: " + hedges.get() + " launched, " + wins.get() + " won, threshold=" + threshold + "ms");
+
+		executor.shutdown();
+	}
+}
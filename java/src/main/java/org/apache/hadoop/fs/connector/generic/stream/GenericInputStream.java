@@ -4,44 +4,238 @@ import java.io.FileDescriptor;
 import java.io.IOException;
 import java.io.FileNotFoundException;
 import java.io.EOFException;
+import java.io.InterruptedIOException;
+
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.Callable;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorCompletionService;
+import java.util.concurrent.Future;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.TimeUnit;
 
 import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
 
+import org.apache.hadoop.fs.CanUnbuffer;
 import org.apache.hadoop.fs.FSInputStream;
 import org.apache.hadoop.fs.FileSystem.Statistics;
 import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.connector.generic.GenericSession;
 
-public class GenericInputStream extends FSInputStream {
+public class GenericInputStream extends FSInputStream implements CanUnbuffer {
 
 	public final static Log LOG = LogFactory.getLog(GenericInputStream.class);
 
+	private final GenericSession session;	// Backend session (kept until close, even if handle is released)
+	private boolean closed = false;
 	private int fd = -1;
+	private int preads = 0;	// Positional reads running outside the stream lock (the descriptor stays open)
+	private GenericHandleCache.Handle handle = null;	// Shared handle (positional reads only)
 	private Path path = null;
 	private long fileLength = 0L;
 	private long offset = 0L;
+	private long pointer = 0L;	// Position of the file pointer (sequential reads only)
+	private byte[] buffer = null;	// Data read ahead (allocated on first use)
+	private long bufferStart = 0L;	// Position of the first byte of buffer
+	private int bufferCount = 0;	// Valid bytes of buffer
+	private int bufferSize = 4096;	// Bytes read ahead by the next refill
+	private int minBufferSize = 4096;	// Refill size of random reads
+	private int maxBufferSize = 4096;	// Refill size sequential reads grow up to
+	private GenericReadPolicy policy = GenericReadPolicy.ADAPTIVE;	// Expected access pattern
+	private boolean random = false;	// Whether reads are treated as random (so far, if adaptive)
+	private boolean reading = false;	// Whether anything was read yet (earlier seeks only position the stream)
+	private long runStart = 0L;	// Where the current run of contiguous reads started (last seek elsewhere)
+	private long splitStart = 0L;	// Range the caller is going to read (if known)
+	private long splitEnd = Long.MAX_VALUE;
 	private Statistics statistics = null;
+	private volatile boolean positional = false;	// Reads do not use the file pointer
+	private boolean replicaReads = false;	// Backend can read from a chosen replica
+	private GenericHedgedReads hedged = null;	// Hedging policy (if enabled)
+	private volatile int replicas = 0;	// Replicas of the file (0 until needed)
+	private volatile int source = -1;	// Preferred replica (-1 lets the backend choose)
+	private final List<Future<?>> stragglers = new ArrayList<Future<?>>();	// Background reads still running
+	private GenericStripedReads striped = null;	// Striped read policy (if enabled)
+	private final ArrayDeque<Stripe> stripes = new ArrayDeque<Stripe>();	// Stripes being fetched, in order
+	private final ArrayDeque<byte[]> spareStripes = new ArrayDeque<byte[]>();	// Buffers of consumed stripes, to reuse
+	private Stripe stripe = null;	// Stripe being consumed
+	private long scheduled = 0L;	// End of the last stripe being fetched
+	private long fetched = -1L;	// End of the last native read not striped (-1 if none)
+	private int contiguous = 0;	// Native reads in a row that went on from the previous one
+	private boolean releaseOnUnbuffer = true;	// Whether unbuffer gives back the backend handle
+	private volatile boolean released = false;	// Handle given back by unbuffer, to reacquire on read
+	private GenericHandleCache.Handle releasedHandle = null;	// Shared handle given back (version to reacquire)
+	private final long[] releasedVersion = new long[2];	// Modification time and length of a private descriptor given back
+
+	// Range of the file fetched ahead by a striped read
+	private final class Stripe implements Callable<Stripe> {
+		private final long start;
+		private final int len;
+		private final byte[] data;	// At least len bytes (reused from stripes consumed before)
+		private int count = 0;	// Bytes actually read (less than len at EOF)
+		private Future<Stripe> future = null;	// Fetch in flight
+		private volatile boolean cancelled = false;	// Stops the fetch between positional reads
+
+		private Stripe(long start, int len, byte[] data) {
+			this.start = start;
+			this.len = len;
+			this.data = data;
+		}
+
+		@Override
+		public Stripe call() throws IOException {
+			int res;
+
+			// Fill the whole stripe (positional reads may return less)
+			while(count < len && !cancelled) {
+				res = readAt(start + count, data, count, len - count);
+				if(res <= 0) break; // EOF
+				count += res;
+			}
+			return this;
+		}
+	}
+
+	// Positional read of a chosen source into a buffer of its own
+	private final class ReplicaRead implements Callable<Integer> {
+		private final int fd;
+		private final int source;
+		private final long position;
+		private final byte[] buffer;
+		private final boolean hedge;
 
-	public GenericInputStream(Path path, long fileLength, Statistics statistics) throws IOException {
+		private ReplicaRead(int fd, int source, long position, int len, boolean hedge) {
+			this.fd = fd;
+			this.source = source;
+			this.position = position;
+			this.buffer = new byte[len];
+			this.hedge = hedge;
+		}
+
+		@Override
+		public Integer call() throws IOException {
+			return readSource(fd, source, position, buffer, 0, buffer.length);
+		}
+	}
+
+	public GenericInputStream(GenericSession session, Path path, long fileLength, Statistics statistics) throws IOException {
 		super();
 		this.path = path;
 		this.fileLength = fileLength;
 		this.statistics = statistics;
-		open0(path);
+		open0(session.getHandle(), path);
+		this.session = session.retain();
+	}
+
+	public GenericInputStream(GenericSession session, Path path, Statistics statistics) throws IOException {
+		super();
+		this.path = path;
+		this.statistics = statistics;
+
+		// Open and learn file length in a single native call
+		openWithStatus0(session.getHandle(), path);
+		this.session = session.retain();
+	}
+
+	public GenericInputStream(GenericSession session, Path path, GenericHandleCache.Handle handle, Statistics statistics) throws IOException {
+		super();
+		this.session = session.retain();
+		this.path = path;
+		this.handle = handle;
+		this.fd = handle.getFd();
+		this.fileLength = handle.getLength();
+		this.statistics = statistics;
+		this.positional = true;
+	}
+
+	// Lets reads fail over to other replicas after an error and, if a hedging
+	// policy is given, race slow reads against another replica. Hedged streams
+	// only use positional reads, as they may run from several threads.
+	public synchronized void enableReplicaReads(GenericHedgedReads hedged) {
+		this.replicaReads = true;
+		this.hedged = hedged;
+		if(hedged != null) this.positional = true;
+	}
+
+	// Sizes the read-ahead buffer. Refills start at bufferSize and double while
+	// reads are sequential, up to maxBufferSize; random reads go back to the
+	// smaller size. Reads of at least a whole buffer bypass it.
+	public synchronized void setBufferSize(int bufferSize, int maxBufferSize) {
+		this.minBufferSize = Math.max(1, bufferSize);
+		this.maxBufferSize = Math.max(this.minBufferSize, maxBufferSize);
+		this.bufferSize = this.minBufferSize;
+	}
+
+	// Sets the expected access pattern and, if known, the range of the file the
+	// caller is going to read. Sequential streams read ahead as much as they
+	// can from the first read, random ones only fill their smallest buffer and
+	// never fetch stripes, and adaptive ones start sequential and turn random
+	// after a backward seek or a forward one longer than the largest buffer
+	// (seeks before the first read, or to the start of the range, position the
+	// stream and do not count), and sequential again once they have read twice
+	// the largest buffer contiguously. Reads ahead stop at the end of the range,
+	// and the backend is advised too.
+	public synchronized void setReadPolicy(GenericReadPolicy policy, long splitStart, long splitEnd) {
+		this.policy = policy;
+		this.random = policy == GenericReadPolicy.RANDOM;
+		this.splitStart = Math.max(0L, splitStart);
+		this.splitEnd = splitEnd > this.splitStart ? splitEnd : Long.MAX_VALUE;
+		this.bufferSize = policy == GenericReadPolicy.SEQUENTIAL ? maxBufferSize : minBufferSize;
+		advise();
+	}
+
+	// Passes the policy on to the backend (private descriptors only, as shared
+	// ones are read by streams with policies of their own)
+	private void advise() {
+		if(handle != null || fd == -1) return;
+
+		try {
+			fadvise0(session.getHandle(), fd, splitStart, splitEnd == Long.MAX_VALUE ? 0L : splitEnd - splitStart, random ? GenericReadPolicy.RANDOM.getCode() : policy.getCode());
+		}
+		catch(IOException e) {
+			LOG.debug("Could not advise backend on file " + path, e);
+		}
+	}
+
+	// Reads ahead go up to the end of the range being read (or of the file, once
+	// beyond it, as records may cross the end of a split)
+	private long readLimit() {
+		return offset < splitEnd ? Math.min(fileLength, splitEnd) : fileLength;
+	}
+
+	// Chooses whether unbuffer also gives back the backend handle (streams
+	// unbuffered often but read again right away may rather keep it)
+	public synchronized void setReleaseOnUnbuffer(boolean releaseOnUnbuffer) {
+		this.releaseOnUnbuffer = releaseOnUnbuffer;
+	}
+
+	// Lets large files read sequentially be fetched ahead in concurrent stripes
+	// (requires concurrent positional reads on a descriptor, FS_CAP_PREAD)
+	public synchronized void enableStripedReads(GenericStripedReads striped) {
+		this.striped = striped;
+		spareStripes.clear();
 	}
 
 	@Override
 	public synchronized int read() throws IOException {
+		byte[] one;
 		int res;
 
-		LOG.debug("Read 1B from file " + path + " of size " + fileLength + "B on offset=" + offset);
+		// Single bytes are served from the buffer without crossing JNI
+		if(offset >= bufferStart && offset < bufferStart + bufferCount) {
+			res = buffer[(int) (offset - bufferStart)] & 0xff;
+			offset += 1;
+			statistics.incrementBytesRead(1);
+			return res;
+		}
 
-		res = read0();
-		if(res == -1) return -1; // EOF
-		offset += 1;
-		statistics.incrementBytesRead(1);
-		statistics.incrementReadOps(1);
-		return res;
+		one = new byte[1];
+		return read(one, 0, 1) == 1 ? one[0] & 0xff : -1;
 	}
 
 	@Override
@@ -55,11 +249,41 @@ public class GenericInputStream extends FSInputStream {
 		if(off < 0 || off > b.length || len < 0 || len > b.length - off) throw new IndexOutOfBoundsException();
 		if(len > fileLength - offset) altLen = (int) (fileLength - offset);
 		else altLen = len;
-		res = readBytes(b, off, altLen);
-		if(res == 0) return -1; // EOF
+		if(altLen <= 0) return -1; // EOF
+
+		// Buffered data first, then stripes, then a single native call that
+		// either fills the caller's array or refills the buffer. Stripes are
+		// only fetched once native reads went on from each other twice, unless
+		// the stream is sequential by policy.
+		if(offset >= bufferStart && offset < bufferStart + bufferCount) res = readBuffered(b, off, altLen);
+		else {
+			if(released) reacquire();
+			if(striped != null && !random && (stripe != null || ((policy == GenericReadPolicy.SEQUENTIAL || contiguous >= 2) && readLimit() - offset > striped.getStripeSize()))) res = readStriped(b, off, altLen);
+			else {
+				contiguous = offset == fetched ? contiguous + 1 : 0;
+				if(altLen >= bufferSize) {
+					res = readDirect(offset, b, off, altLen);
+					fetched = offset + res;
+				}
+				else {
+					res = refill() ? readBuffered(b, off, altLen) : -1;
+					fetched = bufferStart + bufferCount;
+				}
+			}
+		}
+		if(res <= 0) return -1; // EOF
 		offset += res;
+		reading = true;
 		statistics.incrementBytesRead(res);
 		statistics.incrementReadOps(1);
+
+		// Adaptive streams turn sequential again after a long enough run
+		if(random && policy == GenericReadPolicy.ADAPTIVE && offset - runStart >= 2L * maxBufferSize) {
+			LOG.debug("Read file " + path + " contiguously from " + runStart + " to " + offset + ", switching to sequential reads");
+
+			random = false;
+			advise();
+		}
 		return res;
 	}
 
@@ -74,26 +298,492 @@ public class GenericInputStream extends FSInputStream {
 
 		if(pos > fileLength) throw new EOFException("Cannot seek after EOF: pos=" + pos + ", fileLength=" + fileLength);
 		else {
-			seek0(pos);
+
+			// Adaptive streams turn random once they jump around the buffer (split
+			// readers first seek to their split, which is not random)
+			if(policy == GenericReadPolicy.ADAPTIVE && !random && reading && pos != splitStart && (pos < bufferStart || pos > bufferStart + bufferCount + maxBufferSize)) {
+				LOG.debug("Seek on file " + path + " from offset=" + offset + " to position " + pos + ", switching to random reads");
+
+				random = true;
+				bufferSize = minBufferSize;
+				if(!stripes.isEmpty() || stripe != null) cancelStripes(pos);
+				advise();
+			}
+
+			// File pointer is only moved by the next native read that needs it
+			if(pos != offset) runStart = pos;
 			offset = pos;
 		}
 	}
 
+	@Override
+	public int read(long position, byte[] b, int off, int len) throws IOException {
+		int res;
+
+		// Without positional reads, fall back to seek and read
+		if(!positional) return super.read(position, b, off, len);
+
+		LOG.debug("Read " + len + "B from file " + path + " of size " + fileLength + "B on position=" + position);
+
+		if(b == null) throw new NullPointerException();
+		if(off < 0 || len < 0 || len > b.length - off) throw new IndexOutOfBoundsException();
+		if(len == 0) return 0;
+		if(position >= fileLength) return -1; // EOF
+
+		// Streams shared by several threads read concurrently, but the handle
+		// is neither given back nor closed meanwhile
+		synchronized(this) {
+			if(released) reacquire();
+			preads++;
+		}
+		try {
+
+			// Positional reads neither use nor move the stream offset
+			res = readAt(position, b, off, (int) Math.min(len, fileLength - position));
+		}
+		finally {
+			synchronized(this) {
+				if(--preads == 0) notifyAll();
+			}
+		}
+		if(res <= 0) return -1; // EOF
+		statistics.incrementBytesRead(res);
+		statistics.incrementReadOps(1);
+		return res;
+	}
+
 	@Override
 	public synchronized boolean seekToNewSource(long targetPos) throws IOException {
-		return false;
+		int[] others;
+
+		if(!replicaReads) return false;
+		others = otherSources();
+		if(others.length == 0) return false;
+
+		LOG.debug("Seek on file " + path + " to position " + targetPos + " on replica " + others[0]);
+
+		// Later reads go to the next replica (positionally, it has no file pointer)
+		source = others[0];
+		positional = true;
+		seek(targetPos);
+		return true;
+	}
+
+	private int readBuffered(byte[] b, int off, int len) {
+		int res = (int) Math.min(len, bufferStart + bufferCount - offset);
+
+		System.arraycopy(buffer, (int) (offset - bufferStart), b, off, res);
+		return res;
+	}
+
+	// Reads ahead into the buffer from the current offset, in a single native
+	// call whose size grows while reads are sequential
+	// RETURNS Whether any byte was read
+	private boolean refill() throws IOException {
+		int res;
+
+		if(random) bufferSize = minBufferSize;
+		else if(policy == GenericReadPolicy.SEQUENTIAL) bufferSize = maxBufferSize;
+		else if(bufferCount > 0 && offset == bufferStart + bufferCount) bufferSize = (int) Math.min(maxBufferSize, 2L * bufferSize);
+		else bufferSize = minBufferSize;
+		if(buffer == null || buffer.length < bufferSize) buffer = new byte[bufferSize];
+
+		bufferCount = 0;
+		bufferStart = offset;
+		res = readDirect(offset, buffer, 0, (int) Math.min(bufferSize, Math.max(minBufferSize, readLimit() - offset)));
+		if(res <= 0) return false; // EOF
+		bufferCount = res;
+		return true;
+	}
+
+	// Native read at position, through the file pointer unless reads are
+	// positional (the pointer is moved first if needed)
+	private int readDirect(long position, byte[] b, int off, int len) throws IOException {
+		int res;
+
+		if(positional) return readAt(position, b, off, len);
+		try {
+			if(pointer != position) {
+				seek0(session.getHandle(), position);
+				pointer = position;
+			}
+			res = readBytes(session.getHandle(), b, off, len);
+			if(res > 0) pointer += res;
+			return res;
+		}
+		catch(IOException e) {
+			if(!replicaReads) throw e;
+
+			// File pointer is unknown now, go on with positional reads
+			LOG.debug("Read from file " + path + " failed on offset=" + position + ", failing over", e);
+			positional = true;
+			return readFailover(position, b, off, len);
+		}
+	}
+
+	// Sequential read served from the stripes fetched ahead. Stripes are
+	// consumed in order, and the pipeline starts over after a seek.
+	private int readStriped(byte[] b, int off, int len) throws IOException {
+		int res;
+
+		// Move on to the next stripe (reusing the buffer of this one), or restart
+		// pipeline if offset is elsewhere
+		if(stripe == null || offset < stripe.start || offset >= stripe.start + stripe.count) {
+			if(stripe != null && offset == stripe.start + stripe.count && stripe.count < stripe.len) return -1; // EOF
+			if(stripe == null || offset != stripe.start + stripe.count) cancelStripes(offset);
+			else {
+				spareStripes.add(stripe.data);
+				stripe = null;
+			}
+			try {
+				scheduleStripes();
+
+				// Nothing left to fetch ahead within the range
+				if(stripes.isEmpty()) {
+					stripe = null;
+					return readDirect(offset, b, off, len);
+				}
+				stripe = awaitStripe(stripes.poll());
+				scheduleStripes();
+			}
+			catch(RejectedExecutionException e) {
+
+				// Filesystem is closed, read on without stripes
+				cancelStripes(offset);
+				striped = null;
+				return readAt(offset, b, off, len);
+			}
+			if(stripe.count == 0) return -1; // EOF
+		}
+
+		res = (int) Math.min(len, stripe.start + stripe.count - offset);
+		System.arraycopy(stripe.data, (int) (offset - stripe.start), b, off, res);
+		return res;
+	}
+
+	// Keeps as many stripes in flight as the policy allows
+	private void scheduleStripes() {
+		Stripe next;
+
+		while(stripes.size() < striped.getDepth() && scheduled < readLimit()) {
+			next = new Stripe(scheduled, (int) Math.min(striped.getStripeSize(), fileLength - scheduled), spareStripes.isEmpty() ? new byte[striped.getStripeSize()] : spareStripes.poll());
+			next.future = striped.getExecutor().submit(next);
+			stripes.add(next);
+			scheduled += next.len;
+		}
+	}
+
+	private Stripe awaitStripe(Stripe next) throws IOException {
+		try {
+			return next.future.get();
+		}
+		catch(InterruptedException e) {
+			Thread.currentThread().interrupt();
+			next.cancelled = true;
+			next.future.cancel(false);
+			synchronized(stragglers) {
+				stragglers.add(next.future);
+			}
+			cancelStripes(offset);
+			throw new InterruptedIOException("Interrupted while reading from file " + path);
+		}
+		catch(ExecutionException e) {
+			cancelStripes(offset);
+			if(e.getCause() instanceof IOException) throw (IOException) e.getCause();
+			throw new IOException(e.getCause());
+		}
+	}
+
+	// Drops every stripe, the next one will start at position. Stripes being
+	// fetched stop after their current positional read.
+	private void cancelStripes(long position) {
+		synchronized(stragglers) {
+			for(Stripe next : stripes) {
+				next.cancelled = true;
+				next.future.cancel(false);
+				stragglers.add(next.future);
+			}
+		}
+		stripes.clear();
+		if(stripe != null) spareStripes.add(stripe.data);
+		stripe = null;
+		scheduled = position;
+
+		// Striped reads are positional, the file pointer is not used anymore
+		positional = true;
+	}
+
+	// Positional read, failing over to other replicas and hedging as enabled
+	private int readAt(long position, byte[] b, int off, int len) throws IOException {
+		if(!replicaReads) return readSource(fd, -1, position, b, off, len);
+		if(hedged != null && hedged.getThreshold() >= 0 && getReplicas() > 1) return readHedged(position, b, off, len);
+		return readFailover(position, b, off, len);
+	}
+
+	private int readSource(int fd, int source, long position, byte[] b, int off, int len) throws IOException {
+		long start = System.nanoTime();
+		int res;
+
+		res = source < 0 ? pread0(session.getHandle(), fd, position, b, off, len) : preadReplica0(session.getHandle(), fd, source, position, b, off, len);
+
+		// Hedging threshold follows the latencies observed by this filesystem
+		if(hedged != null) hedged.record(System.nanoTime() - start);
+		return res;
+	}
+
+	// Reads from the preferred source and, on error, from every other replica
+	// in turn. The first one that works becomes the preferred source.
+	private int readFailover(long position, byte[] b, int off, int len) throws IOException {
+		IOException error;
+		int res;
+
+		try {
+			return readSource(fd, source, position, b, off, len);
+		}
+		catch(IOException e) {
+			error = e;
+		}
+
+		for(int other : otherSources()) {
+			LOG.debug("Read from file " + path + " failed on position=" + position + ", failing over to replica " + other);
+
+			try {
+				res = readSource(fd, other, position, b, off, len);
+				source = other;
+				return res;
+			}
+			catch(IOException e) {
+				error = e;
+			}
+		}
+
+		throw error;
+	}
+
+	// Reads from the preferred source and, every time the threshold elapses
+	// without a response, from another replica as well. Errors fail over to the
+	// next replica right away. The first successful response is returned, and
+	// the replica that gave it becomes the preferred source.
+	private int readHedged(long position, byte[] b, int off, int len) throws IOException {
+		ExecutorCompletionService<Integer> service = new ExecutorCompletionService<Integer>(hedged.getExecutor());
+		Map<Future<Integer>, ReplicaRead> running = new HashMap<Future<Integer>, ReplicaRead>();
+		int[] others = otherSources();
+		int launched = 0;	// Replicas of others already in use
+		IOException error = null;
+		Future<Integer> done;
+		ReplicaRead read;
+		int res;
+
+		read = new ReplicaRead(fd, source, position, len, false);
+		running.put(service.submit(read), read);
+		try {
+			while(!running.isEmpty()) {
+
+				// Wait up to the threshold while there are replicas left to hedge on
+				if(launched < others.length) done = service.poll(hedged.getThreshold(), TimeUnit.MILLISECONDS);
+				else done = service.take();
+				if(done == null) {
+					LOG.debug("Read from file " + path + " on position=" + position + " is slow, hedging to replica " + others[launched]);
+
+					read = new ReplicaRead(fd, others[launched++], position, len, true);
+					running.put(service.submit(read), read);
+					hedged.hedged();
+					continue;
+				}
+
+				read = running.remove(done);
+				try {
+					res = done.get();
+				}
+				catch(ExecutionException e) {
+					error = e.getCause() instanceof IOException ? (IOException) e.getCause() : new IOException(e.getCause());
+
+					// Fail over to the next replica without waiting for the threshold
+					if(launched < others.length) {
+						LOG.debug("Read from file " + path + " failed on position=" + position + ", failing over to replica " + others[launched]);
+
+						read = new ReplicaRead(fd, others[launched++], position, len, false);
+						running.put(service.submit(read), read);
+					}
+					continue;
+				}
+
+				if(res > 0) System.arraycopy(read.buffer, 0, b, off, res);
+				if(read.hedge) hedged.won();
+				source = read.source;
+				return res;
+			}
+		}
+		catch(InterruptedException e) {
+			Thread.currentThread().interrupt();
+			throw new InterruptedIOException("Interrupted while reading from file " + path);
+		}
+		finally {
+
+			// Losers that did not start are dropped, the rest are waited for on close
+			synchronized(stragglers) {
+				for(Future<Integer> future : running.keySet()) {
+					future.cancel(false);
+					stragglers.add(future);
+				}
+				for(int i = stragglers.size() - 1; i >= 0; i--) if(stragglers.get(i).isDone()) stragglers.remove(i);
+			}
+		}
+
+		throw error;
+	}
+
+	// Replicas to try after the preferred source, next one first
+	private int[] otherSources() throws IOException {
+		int count = getReplicas(), first = source < 0 ? 0 : source + 1;
+		int[] others = new int[source < 0 ? count : count - 1];
+
+		for(int i = 0; i < others.length; i++) others[i] = (first + i) % count;
+		return others;
+	}
+
+	private int getReplicas() throws IOException {
+		if(replicas == 0) replicas = Math.max(1, replicas0(session.getHandle(), path));
+		return replicas;
+	}
+
+	// Drops the stripes fetched ahead and, unless disabled or positional reads
+	// of other threads are running, gives back the backend handle. The position
+	// is kept, and the next read reacquires the handle, so idle streams hold
+	// neither memory nor descriptors.
+	@Override
+	public synchronized void unbuffer() {
+		LOG.debug("Unbuffer file " + path + " on offset=" + offset);
+
+		if(!stripes.isEmpty() || stripe != null) cancelStripes(offset);
+		awaitStragglers();
+		spareStripes.clear();
+		buffer = null;
+		bufferCount = 0;
+		bufferSize = policy == GenericReadPolicy.SEQUENTIAL && !random ? maxBufferSize : minBufferSize;
+		if(!releaseOnUnbuffer || released || fd == -1 || preads > 0) return;
+
+		try {
+			if(handle == null) version0(session.getHandle(), fd, path, releasedVersion);
+			releaseHandle();
+			released = true;
+		}
+		catch(IOException e) {
+
+			// Handle is kept, unbuffer is only a hint
+			LOG.debug("Could not release handle of file " + path, e);
+		}
+	}
+
+	// Opens the file again after unbuffer, failing if it is not the same
+	// version anymore (the shared handle is taken back if it is still open)
+	private synchronized void reacquire() throws IOException {
+		long[] version = new long[2];
+
+		if(!released) return;
+
+		LOG.debug("Reacquire handle of file " + path + " on offset=" + offset);
+
+		if(releasedHandle != null) {
+			handle = GenericHandleCache.get().reacquire(session, path, releasedHandle);
+			fd = handle.getFd();
+			releasedHandle = null;
+		}
+		else {
+			open0(session.getHandle(), path);
+			pointer = 0L;
+			version0(session.getHandle(), fd, path, version);
+			if(version[0] != releasedVersion[0] || version[1] != releasedVersion[1]) {
+				close0(session.getHandle());
+				throw new IOException("File " + path + " changed while its stream was unbuffered");
+			}
+		}
+		released = false;
+		advise();
+	}
+
+	private void releaseHandle() throws IOException {
+		if(handle != null) {
+
+			// Shared handles are closed by the cache
+			GenericHandleCache.get().release(handle);
+			releasedHandle = handle;
+			handle = null;
+			fd = -1;
+		}
+		else if(fd != -1) close0(session.getHandle());
+	}
+
+	// Positional reads of other threads may still be using the descriptor
+	// (they take little, so interrupts are kept for later)
+	private synchronized void awaitPreads() {
+		boolean interrupted = false;
+
+		while(preads > 0) {
+			try {
+				wait();
+			}
+			catch(InterruptedException e) {
+				interrupted = true;
+			}
+		}
+		if(interrupted) Thread.currentThread().interrupt();
+	}
+
+	// Hedged and striped reads may still be using the descriptor
+	private void awaitStragglers() {
+		List<Future<?>> pending;
+
+		synchronized(stragglers) {
+			pending = new ArrayList<Future<?>>(stragglers);
+			stragglers.clear();
+		}
+
+		for(Future<?> future : pending) {
+			try {
+				future.get();
+			}
+			catch(ExecutionException | CancellationException e) {
+				// Result was not needed anyway
+			}
+			catch(InterruptedException e) {
+				Thread.currentThread().interrupt();
+				return;
+			}
+		}
 	}
 
 	@Override
 	public synchronized void close() throws IOException {
 		LOG.debug("Close file " + path);
 
-		close0();
+		if(!stripes.isEmpty()) cancelStripes(offset);
+		awaitStragglers();
+		awaitPreads();
+		spareStripes.clear();
+		released = false;
+		releasedHandle = null;
+		try {
+			releaseHandle();
+		}
+		finally {
+
+			// Session is given back once, after the handle
+			if(!closed) {
+				closed = true;
+				session.release();
+			}
+		}
 	}
 
-	private native synchronized void open0(Path path) throws FileNotFoundException;
-	private native synchronized int read0() throws IOException;
-	private native synchronized int readBytes(byte b[], int off, int len) throws IOException;
-	private native synchronized void seek0(long pos) throws IOException;
-	private native synchronized void close0() throws IOException;
+	private native synchronized void open0(long session, Path path) throws FileNotFoundException;
+	private native synchronized void openWithStatus0(long session, Path path) throws IOException;
+	private native synchronized int readBytes(long session, byte b[], int off, int len) throws IOException;
+	private static native int pread0(long session, int fd, long position, byte b[], int off, int len) throws IOException;
+	private static native int preadReplica0(long session, int fd, int replica, long position, byte b[], int off, int len) throws IOException;
+	private static native int replicas0(long session, Path path) throws IOException;
+	private static native void version0(long session, int fd, Path path, long[] version) throws IOException;
+	private static native void fadvise0(long session, int fd, long offset, long len, int policy) throws IOException;
+	private native synchronized void seek0(long session, long pos) throws IOException;
+	private native synchronized void close0(long session) throws IOException;
 }
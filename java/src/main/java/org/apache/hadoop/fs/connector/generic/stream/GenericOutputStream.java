@@ -3,8 +3,18 @@ package org.apache.hadoop.fs.connector.generic.stream;
 import java.io.FileDescriptor;
 import java.io.IOException;
 import java.io.FileNotFoundException;
+import java.io.InterruptedIOException;
 import java.io.OutputStream;
 
+import java.util.ArrayDeque;
+import java.util.Arrays;
+import java.util.UUID;
+import java.util.concurrent.Callable;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.RejectedExecutionException;
+
 import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
 
@@ -12,72 +22,466 @@ import org.apache.hadoop.fs.FileAlreadyExistsException;
 import org.apache.hadoop.fs.permission.FsPermission;
 import org.apache.hadoop.fs.FileSystem.Statistics;
 import org.apache.hadoop.fs.Path;
+import org.apache.hadoop.fs.connector.generic.GenericSession;
 
 public class GenericOutputStream extends OutputStream {
 
 	public final static Log LOG = LogFactory.getLog(GenericOutputStream.class);
 
+	private static final int HOLE_SIZE = 4096;	// Smallest run of zeros left as a hole
+	private static final byte[] EMPTY = new byte[0];
+	private static final long MIN_PREALLOCATION = 1024 * 1024;	// First chunk reserved ahead
+
+	private final GenericSession session;	// Backend session (kept until close)
+	private boolean closed = false;
 	private int fd = -1;
 	private Path path = null;
 	private short permission = 0;
 	private boolean overwrite = false;
 	private boolean append = false;
 	private Statistics statistics = null;
+	private byte[] buffer = new byte[4096];	// Data not yet written to the backend
+	private int count = 0;	// Valid bytes of buffer
+	private int maxBufferSize = 4096;	// Size the buffer may grow up to
+	private GenericStripedWrites striped = null;	// Striped write policy (if enabled)
+	private Path target = null;	// Final path of a striped file (path is temporary)
+	private boolean claimed = false;	// Whether target was created empty to keep it exclusive
+	private long position = 0L;	// Position of buffer in a striped file
+	private final ArrayDeque<Future<byte[]>> stripes = new ArrayDeque<Future<byte[]>>();	// Stripes being written, in order
+	private final ArrayDeque<byte[]> spare = new ArrayDeque<byte[]>();	// Buffers of stripes already written
+	private IOException failure = null;	// First failed stripe (the file is discarded)
+	private boolean sparse = false;	// Whether runs of zeros are left as holes
+	private long hole = 0L;	// Zeros skipped and not yet followed by data
+	private boolean tailHole = false;	// Whether the last stripe ends in a hole
+	private long preallocation = 0L;	// Largest chunk reserved ahead of writes (0 if disabled)
+	private long chunk = 0L;	// Next chunk reserved ahead (doubles up to preallocation)
+	private long allocated = 0L;	// End of the storage reserved so far
+	private long offset = 0L;	// Bytes written so far, holes included (unless striped)
+
+	// Positional write of a stripe, giving back its buffer
+	private static final class StripeWrite implements Callable<byte[]> {
+		private final long session;
+		private final int fd;
+		private final long start;
+		private final byte[] data;
+		private final int len;
+		private final boolean sparse;
+
+		private StripeWrite(long session, int fd, long start, byte[] data, int len, boolean sparse) {
+			this.session = session;
+			this.fd = fd;
+			this.start = start;
+			this.data = data;
+			this.len = len;
+			this.sparse = sparse;
+		}
+
+		@Override
+		public byte[] call() throws IOException {
+			int from = 0;
+
+			// Blocks of zeros are not written, positional writes leave them as holes
+			if(sparse) {
+				for(int block = 0; block + HOLE_SIZE <= len; block += HOLE_SIZE) {
+					if(!isZero(data, block, HOLE_SIZE)) continue;
+					if(block > from) pwrite0(session, fd, start + from, data, from, block - from);
+					from = block + HOLE_SIZE;
+				}
+			}
+			if(len > from) pwrite0(session, fd, start + from, data, from, len - from);
+			return data;
+		}
+	}
+
+	public GenericOutputStream(GenericSession session, Path path, FsPermission permission, boolean overwrite, Statistics statistics) throws IOException {
+		this(session, path, permission, overwrite, null, statistics);
+	}
 
-	public GenericOutputStream(Path path, FsPermission permission, boolean overwrite, Statistics statistics) throws IOException {
+	// Creates a file whose stripes are written concurrently (if a policy is
+	// given). Like a multipart upload, the file is written under a temporary
+	// name and only takes its place on close, once every stripe is written.
+	// Without overwrite, the final name is created empty right away (and thus
+	// fails if it exists), so that no other writer can take it meanwhile.
+	public GenericOutputStream(GenericSession session, Path path, FsPermission permission, boolean overwrite, GenericStripedWrites striped, Statistics statistics) throws IOException {
 		super();
 		this.path = path;
 		this.permission = permission.toShort();
 		this.overwrite = overwrite;
 		this.statistics = statistics;
-		open0(path);
+		if(striped != null) {
+			this.striped = striped;
+			this.target = path;
+			this.path = new Path(path.getParent(), "." + path.getName() + ".striped-" + UUID.randomUUID());
+			if(!overwrite) {
+				claim0(session.getHandle(), target, this.permission);
+				claimed = true;
+			}
+		}
+		try {
+			open0(session.getHandle(), this.path);
+		}
+		catch(IOException e) {
+			unclaim(session);
+			throw e;
+		}
+		this.session = session.retain();
 	}
 
-	public GenericOutputStream(Path path, Statistics statistics) throws IOException {
+	public GenericOutputStream(GenericSession session, Path path, Statistics statistics) throws IOException {
 		super();
 		this.path = path;
 		this.append = true;
 		this.statistics = statistics;
-		open0(path);
+		open0(session.getHandle(), path);
+		this.session = session.retain();
 	}
 
-	@Override
-	public void write(int b) throws IOException {
-		LOG.debug("Write 1B to file " + path);
+	// Sizes the write buffer. It starts at bufferSize and doubles every time
+	// it fills up, up to maxBufferSize. Writes of at least a whole buffer
+	// bypass it. Striped streams take buffers of a whole stripe instead, once
+	// the first one fills up (so that small files never allocate a stripe).
+	public synchronized void setBufferSize(int bufferSize, int maxBufferSize) throws IOException {
+		flushBuffer();
+		this.buffer = new byte[Math.max(1, striped != null ? Math.min(bufferSize, striped.getStripeSize()) : bufferSize)];
+		this.maxBufferSize = Math.max(this.buffer.length, maxBufferSize);
+	}
+
+	// Leaves every whole block of zeros (HOLE_SIZE bytes) written as a hole,
+	// seeking over it instead of writing it. Appended files cannot seek.
+	public synchronized void setSparse(boolean sparse) {
+		this.sparse = sparse && !append;
+		if(this.sparse) preallocation = 0L;
+	}
+
+	// Reserves storage ahead of writes, in chunks growing from a small one up to
+	// the given size (so that small files reserve little), and thus lays the
+	// file out in few extents. Only created files know where they start, and
+	// sparse ones cannot know which ranges will be holes, so neither reserves.
+	public synchronized void setPreallocation(long chunk) {
+		this.preallocation = append || sparse ? 0L : Math.max(0L, chunk);
+		this.chunk = Math.min(this.preallocation, MIN_PREALLOCATION);
+	}
+
+	// Reserves the whole file at once, once its final length is known
+	public synchronized void setExpectedLength(long length) throws IOException {
+		if(preallocation > 0 && length > allocated) reserve(allocated, length);
+	}
+
+	// Makes sure storage is reserved before writing from start to end, a chunk
+	// at a time
+	private void preallocate(long start, long end) throws IOException {
+		if(preallocation == 0 || end <= allocated) return;
 
-		write0(b);
+		start = Math.max(start, allocated);
+		reserve(start, Math.max(end, start + chunk));
+		chunk = Math.min(preallocation, 2 * chunk);
+	}
+
+	// Preallocation is only a hint: backends without it, or without space for
+	// it, are not asked again and the writes go on
+	private void reserve(long start, long end) throws IOException {
+		if(!fallocate0(session.getHandle(), start, end - start)) {
+			LOG.debug("Could not preallocate file " + path + ", writing without it");
+			preallocation = 0L;
+			return;
+		}
+		allocated = end;
+	}
+
+	// Length to trim the file to on close (-1 if nothing is reserved beyond it)
+	private long trim(long length) {
+		return allocated > length ? length : -1L;
+	}
+
+	private static boolean isZero(byte[] b, int off, int len) {
+		for(int i = off; i < off + len; i++) {
+			if(b[i] != 0) return false;
+		}
+
+		return true;
+	}
+
+	// Makes room in a full buffer: striped streams move to a buffer of a whole
+	// stripe if theirs is smaller, and write it out otherwise
+	private void makeRoom() throws IOException {
+		if(count < buffer.length) return;
+
+		if(striped == null || buffer.length == striped.getStripeSize()) flushBuffer();
+		else if(count == 0 && !spare.isEmpty()) buffer = spare.poll();
+		else buffer = Arrays.copyOf(buffer, striped.getStripeSize());
+	}
+
+	@Override
+	public synchronized void write(int b) throws IOException {
+		makeRoom();
+		buffer[count++] = (byte) b;
 
 		statistics.incrementBytesWritten(1);
-		statistics.incrementWriteOps(1);
 	}
 
 	@Override
-	public void write(byte[] b, int off, int len) throws IOException {
+	public synchronized void write(byte[] b, int off, int len) throws IOException {
+		int chunk;
+
 		LOG.debug("Write " + len + "B to file " + path);
 
 		if(b == null) throw new NullPointerException();
 		if(off < 0 || off > b.length || len < 0 || len > b.length - off) throw new IndexOutOfBoundsException();
-		writeBytes(b, off, len);
+
+		// Striped streams cut everything into stripes
+		if(striped != null) {
+			for(int done = 0; done < len; done += chunk) {
+				makeRoom();
+				chunk = Math.min(len - done, buffer.length - count);
+				System.arraycopy(b, off + done, buffer, count, chunk);
+				count += chunk;
+			}
+		}
+
+		// Large writes go straight to the backend, small ones are gathered
+		else if(len >= buffer.length) {
+			flushBuffer();
+			writeData(b, off, len);
+			statistics.incrementWriteOps(1);
+		}
+		else {
+			if(len > buffer.length - count) flushBuffer();
+			System.arraycopy(b, off, buffer, count, len);
+			count += len;
+		}
 
 		statistics.incrementBytesWritten(len);
+	}
+
+	// Writes the buffer in a single native call, and grows it if it was full
+	private void flushBuffer() throws IOException {
+		if(count == 0) return;
+
+		if(striped != null) {
+			writeStripe();
+			return;
+		}
+		writeData(buffer, 0, count);
+		statistics.incrementWriteOps(1);
+		if(count == buffer.length && buffer.length < maxBufferSize) buffer = new byte[(int) Math.min(maxBufferSize, 2L * buffer.length)];
+		count = 0;
+	}
+
+	// Writes bytes to the backend. Sparse streams skip blocks of zeros, and only
+	// seek over them once data follows (or the stream is flushed or closed), so
+	// that a long run of zeros takes a single seek.
+	private void writeData(byte[] b, int off, int len) throws IOException {
+		int from = off, end = off + len;
+
+		if(sparse) {
+			for(int block = off; block + HOLE_SIZE <= end; block += HOLE_SIZE) {
+				if(!isZero(b, block, HOLE_SIZE)) continue;
+				if(block > from) writeAfterHole(b, from, block - from);
+				hole += HOLE_SIZE;
+				from = block + HOLE_SIZE;
+			}
+		}
+		if(end > from) writeAfterHole(b, from, end - from);
+	}
+
+	private void writeAfterHole(byte[] b, int off, int len) throws IOException {
+		if(hole > 0) {
+			skip0(session.getHandle(), hole);
+			offset += hole;
+			hole = 0L;
+		}
+		preallocate(offset, offset + len);
+		writeBytes(session.getHandle(), b, off, len);
+		offset += len;
+	}
+
+	// Gives the file the length of a trailing hole, writing its last zero
+	private void endHole() throws IOException {
+		if(hole == 0) return;
+
+		skip0(session.getHandle(), hole - 1);
+		writeBytes(session.getHandle(), new byte[1], 0, 1);
+		offset += hole;
+		hole = 0L;
+	}
+
+	// Hands the buffer over to a writing thread, once a stripe in flight is done
+	// if they are all taken (so that memory stays bounded and the writer is held
+	// back to the pace of the backend)
+	private void writeStripe() throws IOException {
+		StripeWrite write;
+
+		if(failure != null) throw new IOException("Cannot write to file " + target + " after a failed stripe", failure);
+		while(stripes.size() >= striped.getDepth() || (!stripes.isEmpty() && stripes.peek().isDone())) awaitStripe();
+
+		preallocate(position, position + count);
+		write = new StripeWrite(session.getHandle(), fd, position, buffer, count, sparse);
+		try {
+			stripes.add(striped.getExecutor().submit(write));
+		}
+		catch(RejectedExecutionException e) {
+
+			// Filesystem is closed, write from this thread
+			spare.add(write.call());
+		}
 		statistics.incrementWriteOps(1);
+
+		position += count;
+		tailHole = sparse && count % HOLE_SIZE == 0 && isZero(buffer, count - HOLE_SIZE, HOLE_SIZE);
+		count = 0;
+		buffer = spare.isEmpty() ? EMPTY : spare.poll();
 	}
 
+	// Waits for the oldest stripe (failed ones are left for discardStripes)
+	private void awaitStripe() throws IOException {
+		try {
+			spare.add(stripes.peek().get());
+			stripes.poll();
+		}
+		catch(InterruptedException e) {
+			Thread.currentThread().interrupt();
+			failure = new InterruptedIOException("Interrupted while writing to file " + target);
+			throw failure;
+		}
+		catch(ExecutionException e) {
+			failure = e.getCause() instanceof IOException ? (IOException) e.getCause() : new IOException(e.getCause());
+			throw failure;
+		}
+	}
+
+	// Drops every stripe and the temporary file
+	private void discardStripes() {
+		LOG.debug("Discard striped file " + path);
+
+		// Stripes that did not start are dropped, the rest still use the descriptor
+		for(Future<byte[]> stripe : stripes) stripe.cancel(false);
+		for(Future<byte[]> stripe : stripes) {
+			boolean interrupted = false;
+
+			while(true) {
+				try {
+					stripe.get();
+					break;
+				}
+				catch(ExecutionException | CancellationException e) {
+					break; // Failure already known
+				}
+				catch(InterruptedException e) {
+					interrupted = true;
+				}
+			}
+			if(interrupted) Thread.currentThread().interrupt();
+		}
+		stripes.clear();
+		spare.clear();
+
+		try {
+			close0(session.getHandle(), -1L);
+		}
+		catch(IOException e) {
+			LOG.debug("Could not close striped file " + path, e);
+		}
+		fd = -1;
+		count = 0;
+		try {
+			discard0(session.getHandle(), path);
+		}
+		catch(IOException e) {
+			LOG.warn("Could not remove temporary file " + path, e);
+		}
+		unclaim(session);
+	}
+
+	// Removes the empty file holding the final name of a discarded striped file
+	private void unclaim(GenericSession session) {
+		if(!claimed) return;
+
+		claimed = false;
+		try {
+			discard0(session.getHandle(), target);
+		}
+		catch(IOException e) {
+			LOG.warn("Could not remove file " + target + " created for a discarded striped file", e);
+		}
+	}
+
+	// Striped files are only written when closed, as a whole
 	@Override
-	public void flush() throws IOException {
-		return;
+	public synchronized void flush() throws IOException {
+		if(striped != null) return;
+
+		flushBuffer();
+		endHole();
 	}
 
 	@Override
-	public void close() throws IOException {
+	public synchronized void close() throws IOException {
 		LOG.debug("Close file " + path);
 
-		close0();
+		if(fd == -1) return;
+		try {
+			closeFile();
+		}
+		finally {
+
+			// Session is given back once, after the file
+			if(!closed) {
+				closed = true;
+				session.release();
+			}
+		}
+	}
+
+	private void closeFile() throws IOException {
+		if(striped == null) {
+			try {
+				flushBuffer();
+				endHole();
+			}
+			finally {
+				close0(session.getHandle(), trim(offset));
+			}
+			return;
+		}
+
+		// File takes its final name only if every stripe was written
+		try {
+			flushBuffer();
+			while(!stripes.isEmpty()) awaitStripe();
+
+			// Trailing hole needs its last zero for the file to get its length
+			if(tailHole) pwrite0(session.getHandle(), fd, position - 1, new byte[1], 0, 1);
+			close0(session.getHandle(), trim(position));
+		}
+		catch(IOException e) {
+			discardStripes();
+			throw e;
+		}
+		finally {
+			buffer = null;
+		}
+
+		LOG.debug("Commit striped file " + path + " as " + target);
+
+		try {
+			commit0(session.getHandle(), path, target);
+			claimed = false;
+		}
+		catch(IOException e) {
+			discard0(session.getHandle(), path);
+			unclaim(session);
+			throw e;
+		}
 	}
 
-	private native synchronized void open0(Path path) throws FileNotFoundException;
-	private native synchronized void write0(int b) throws IOException;
-	private native synchronized void writeBytes(byte b[], int off, int len) throws IOException;
-	private native synchronized void close0() throws IOException;
+	private native synchronized void open0(long session, Path path) throws FileNotFoundException;
+	private native synchronized void writeBytes(long session, byte b[], int off, int len) throws IOException;
+	private native synchronized void skip0(long session, long len) throws IOException;
+	private static native void pwrite0(long session, int fd, long position, byte b[], int off, int len) throws IOException;
+	private static native void commit0(long session, Path src, Path dst) throws IOException;
+	private static native void claim0(long session, Path path, short permission) throws IOException;
+	private static native void discard0(long session, Path path) throws IOException;
+	private native synchronized boolean fallocate0(long session, long offset, long len) throws IOException;
+	private native synchronized void close0(long session, long length) throws IOException;
 	private native synchronized void flush0() throws IOException;
 }
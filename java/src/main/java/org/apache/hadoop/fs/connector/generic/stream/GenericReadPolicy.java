@@ -0,0 +1,40 @@
+package org.apache.hadoop.fs.connector.generic.stream;
+
+// How a stream is expected to be read. The code of each policy is what the
+// native side maps to POSIX_FADV_* advice for fs_fadvise.
+public enum GenericReadPolicy {
+
+	// Reads start out sequential and turn random after a backward or long seek
+	ADAPTIVE(0),
+
+	// Whole-file scans: large reads ahead from the first one
+	SEQUENTIAL(1),
+
+	// Point lookups: no read-ahead beyond the requested bytes and the buffer
+	RANDOM(2);
+
+	private final int code;
+
+	private GenericReadPolicy(int code) {
+		this.code = code;
+	}
+
+	int getCode() {
+		return code;
+	}
+
+	// Parses a policy name, accepting those of Hadoop 3 openFile() options
+	// (the first known one of a comma-separated list wins)
+	public static GenericReadPolicy fromString(String names, GenericReadPolicy fallback) {
+		if(names == null) return fallback;
+
+		for(String name : names.split(",")) {
+			name = name.trim().toLowerCase();
+			if(name.equals("adaptive") || name.equals("default") || name.equals("normal")) return ADAPTIVE;
+			if(name.equals("sequential") || name.equals("whole-file")) return SEQUENTIAL;
+			if(name.equals("random") || name.equals("vector")) return RANDOM;
+		}
+
+		return fallback;
+	}
+}
@@ -0,0 +1,55 @@
+package org.apache.hadoop.fs.connector.generic.stream;
+
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+// Policy and threads for striped reads of one filesystem instance. Streams
+// reading a large file sequentially split what lies ahead into stripes that
+// are fetched concurrently through positional reads, and consume them in
+// order. Each stream keeps as many stripes in flight as there are threads.
+public final class GenericStripedReads {
+
+	private final ThreadPoolExecutor executor;
+	private final int threads;
+	private final int stripeSize;
+
+	public GenericStripedReads(int threads, int stripeSize) {
+		final AtomicInteger created = new AtomicInteger();
+
+		this.threads = Math.max(1, threads);
+		this.stripeSize = Math.max(1, stripeSize);
+
+		// Stripes of every stream queue up for the same threads
+		this.executor = new ThreadPoolExecutor(this.threads, this.threads, 60L, TimeUnit.SECONDS, new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+			@Override
+			public Thread newThread(Runnable r) {
+				Thread thread = new Thread(r, "generic-striped-read-" + created.incrementAndGet());
+				thread.setDaemon(true);
+				return thread;
+			}
+		});
+		this.executor.allowCoreThreadTimeOut(true);
+	}
+
+	ExecutorService getExecutor() {
+		return executor;
+	}
+
+	// Stripes each stream keeps in flight
+	int getDepth() {
+		return threads;
+	}
+
+	int getStripeSize() {
+		return stripeSize;
+	}
+
+	// Streams still open go on with plain reads once their stripes are done
+	public void shutdown() {
+		executor.shutdown();
+	}
+}
@@ -0,0 +1,56 @@
+package org.apache.hadoop.fs.connector.generic.stream;
+
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+// Policy and threads for striped writes of one filesystem instance. Streams
+// creating a file cut what they are given into stripes that are written
+// concurrently through positional writes. Each stream keeps as many stripes in
+// flight as there are threads, and its writer waits once they are all taken.
+public final class GenericStripedWrites {
+
+	private final ThreadPoolExecutor executor;
+	private final int threads;
+	private final int stripeSize;
+
+	public GenericStripedWrites(int threads, int stripeSize) {
+		final AtomicInteger created = new AtomicInteger();
+
+		this.threads = Math.max(1, threads);
+		this.stripeSize = Math.max(1, stripeSize);
+
+		// Stripes of every stream queue up for the same threads (each stream
+		// bounds its own, so the queue is bounded too)
+		this.executor = new ThreadPoolExecutor(this.threads, this.threads, 60L, TimeUnit.SECONDS, new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+			@Override
+			public Thread newThread(Runnable r) {
+				Thread thread = new Thread(r, "generic-striped-write-" + created.incrementAndGet());
+				thread.setDaemon(true);
+				return thread;
+			}
+		});
+		this.executor.allowCoreThreadTimeOut(true);
+	}
+
+	ExecutorService getExecutor() {
+		return executor;
+	}
+
+	// Stripes each stream keeps in flight
+	int getDepth() {
+		return threads;
+	}
+
+	int getStripeSize() {
+		return stripeSize;
+	}
+
+	// Streams still open fail their next stripe
+	public void shutdown() {
+		executor.shutdown();
+	}
+}
@@ -1,92 +1,180 @@
+#include <errno.h>
+#include <stdlib.h>
+
 #include "filesystem.h"
 
-// Initialization
+// Capabilities
 
-int fs_init() {
+int fs_capabilities(fs_session_t *session) {
 	return 0;
 }
 
-int fs_destroy() {
+// Initialization
+
+struct fs_session {
+	int unused;
+};
+
+fs_session_t *fs_init(const char *authority) {
+	return calloc(1, sizeof(struct fs_session));
+}
+
+int fs_destroy(fs_session_t *session) {
+	free(session);
 	return 0;
 }
 
 // Paths
-int fs_translate(const char *authority, const char *path, char *fspath) {
+int fs_translate(fs_session_t *session, const char *path, char *fspath) {
 	return 0;
 }
 
 // Directories
 
-DIR *fs_opendir(const char *path) {
+DIR *fs_opendir(fs_session_t *session, const char *path) {
 	return 0;
 }
 
-struct dirent *fs_readdir(DIR *dirp) {
+struct dirent *fs_readdir(fs_session_t *session, DIR *dirp) {
 	return 0;
 }
 
-int fs_closedir(DIR *dirp) {
+int fs_closedir(fs_session_t *session, DIR *dirp) {
 	return 0;
 }
 
-int fs_mkdir(const char *path, mode_t mode) {
+int fs_mkdir(fs_session_t *session, const char *path, mode_t mode) {
 	return 0;
 }
 
-int fs_rmdir(const char *path) {
+int fs_rmdir(fs_session_t *session, const char *path) {
 	return 0;
 }
 
 // Files
 
-int fs_open(const char *path, int oflag, ...) {
+int fs_open(fs_session_t *session, const char *path, int oflag, ...) {
 	return 0;
 }
 
-int fs_close(int fildes) {
+int fs_close(fs_session_t *session, int fildes) {
 	return 0;
 }
 
-int fs_unlink(const char *path) {
+int fs_unlink(fs_session_t *session, const char *path) {
 	return 0;
 }
 
-ssize_t fs_read(int fildes, void *buf, size_t nbyte) {
+int fs_unlink_batch(fs_session_t *session, const char **paths, int count, int *errors) {
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t fs_read(fs_session_t *session, int fildes, void *buf, size_t nbyte) {
 	return 0;
 }
 
-ssize_t fs_write(int fildes, const void *buf, size_t nbyte) {
+ssize_t fs_write(fs_session_t *session, int fildes, const void *buf, size_t nbyte) {
 	return 0;
 }
 
-int fs_stat(const char *path, struct stat *buf) {
+ssize_t fs_pread(fs_session_t *session, int fildes, void *buf, size_t nbyte, off_t offset) {
 	return 0;
 }
 
-off_t fs_lseek(int fildes, off_t offset, int whence) {
+ssize_t fs_pread_replica(fs_session_t *session, int fildes, int replica, void *buf, size_t nbyte, off_t offset) {
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t fs_pwrite(fs_session_t *session, int fildes, const void *buf, size_t nbyte, off_t offset) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_put(fs_session_t *session, const char *path, const void *buf, size_t nbyte, int oflag, mode_t mode) {
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t fs_get(fs_session_t *session, const char *path, void *buf, size_t nbyte) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_fadvise(fs_session_t *session, int fildes, off_t offset, off_t len, int advice) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_fallocate(fs_session_t *session, int fildes, off_t offset, off_t len) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_ftruncate(fs_session_t *session, int fildes, off_t length) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_stat(fs_session_t *session, const char *path, struct stat *buf) {
+	return 0;
+}
+
+int fs_stat_batch(fs_session_t *session, const char **paths, int count, struct stat *bufs, int *errors) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_fstat(fs_session_t *session, int fildes, struct stat *buf) {
+	return 0;
+}
+
+off_t fs_lseek(fs_session_t *session, int fildes, off_t offset, int whence) {
 	return 0;
 }
 
 // Distribution
 
-int fs_replication(const char *path) {
+int fs_replication(fs_session_t *session, const char *path) {
 	return 0;
 }
 
-int fs_locate(const char *path, char ***urls) {
+off_t fs_blocksize(fs_session_t *session, const char *path) {
 	return 0;
 }
 
-int fs_rename(const char *src, const char *dst) {
+int fs_locate(fs_session_t *session, const char *path, off_t blksize, char ***urls) {
+	return 0;
+}
+
+int fs_rename(fs_session_t *session, const char *src, const char *dst) {
 	return 0;
 }
 
 // Change properties
 
-int fs_chmod(const char *path, mode_t permission) {
+int fs_chmod(fs_session_t *session, const char *path, mode_t permission) {
 	return 0;
 }
 
-int fs_chown(const char *path, uid_t uid, gid_t gid) {
+int fs_chown(fs_session_t *session, const char *path, uid_t uid, gid_t gid) {
 	return 0;
 }
+
+// Change notification
+
+int fs_watch(fs_session_t *session, const char *path) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_unwatch(fs_session_t *session, int watch) {
+	errno = ENOSYS;
+	return -1;
+}
+
+int fs_events(fs_session_t *session, struct fs_event *events, int count, int timeout) {
+	errno = ENOSYS;
+	return -1;
+}
@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/dir.h>
@@ -12,58 +13,229 @@
 //
 // ATTENTION
 //
-// fs_translate, fs_replication and fs_locate are custom definitions that do not
-// follow the standard. Refer to them for more information about parameters and
-// returned values.
+// fs_translate, fs_replication, fs_blocksize and fs_locate are custom
+// definitions that do not follow the standard. Refer to them for more
+// information about parameters and returned values.
 //
+// Every call but fs_init takes the session of an authority as returned by
+// fs_init, so that a backend can keep separate state (connections, caches,
+// throttling...) for each of them. Calls on different sessions may overlap.
+//
+
+// Backend state for an authority, defined by each filesystem
+typedef struct fs_session fs_session_t;
+
+// Capabilities
+
+// fs_pread may be called concurrently on a single descriptor
+#define FS_CAP_PREAD 0x1
+
+// fs_pread_replica reads from a chosen replica
+#define FS_CAP_REPLICA 0x2
+
+// fs_pwrite may be called concurrently on a single descriptor
+#define FS_CAP_PWRITE 0x4
+
+// fs_lseek accepts SEEK_DATA and SEEK_HOLE, and seeking past the end of a file
+// being written leaves a hole that takes no storage
+#define FS_CAP_SEEK_HOLE 0x8
+
+// Whence values of fs_lseek for sparse files (as in Linux and Solaris)
+#ifndef SEEK_DATA
+#define SEEK_DATA 3
+#endif
+#ifndef SEEK_HOLE
+#define SEEK_HOLE 4
+#endif
+
+/*
+ * This function reports which optional features the filesystem implements, so
+ * that the connector can choose its strategy up front (for example, sharing a
+ * descriptor between streams requires FS_CAP_PREAD).
+ * RETURNS A bitwise OR of FS_CAP_* flags
+ */
+int fs_capabilities(fs_session_t *session);
 
 // Initialization
 
-int fs_init();
+/*
+ * These functions open and close the session of an authority. The connector
+ * reference-counts sessions: fs_init is called when the first Hadoop
+ * FileSystem instance for the authority is initialized, and fs_destroy when
+ * the last one is closed (no call on the session is running by then). Calls
+ * for different authorities may overlap.
+ * PARAM authority A string of form name[:port] as specified in the URI (empty
+ *                 if the URI has no authority)
+ * RETURNS NULL if error (errno set) or the session (fs_init), -1 if error or 0
+ *         if no error (fs_destroy)
+ */
+fs_session_t *fs_init(const char *authority);
 
-int fs_destroy();
+int fs_destroy(fs_session_t *session);
 
 // Paths
 
 /*
- * This function gives the path string expected by the filesystem for an
- * authority and a path. In Expand, for example, xpn://partition1/tmp must be
- * translated to /partition1/tmp. In other filesystems, fs://host:port/path
+ * This function gives the path string expected by the filesystem for a path of
+ * the authority of a session. In Expand, for example, xpn://partition1/tmp must
+ * be translated to /partition1/tmp. In other filesystems, fs://host:port/path
  * could be translated to /port//host:path, for example. Every filesystem must
  * implement this function even if they don't use authority information at all.
- * PARAM authority A string of form name[:port] as specified in the URI
+ * PARAM session Session of the authority, as returned by fs_init
  * PARAM path A string represeting the path for that authority
  * RETURNS -1 if error, 0 if no error
  */
-int fs_translate(const char *authority, const char *path, char *fspath);
+int fs_translate(fs_session_t *session, const char *path, char *fspath);
 
 // Directories
 
-DIR *fs_opendir(const char *path);
+DIR *fs_opendir(fs_session_t *session, const char *path);
 
-struct dirent *fs_readdir(DIR *dirp);
+struct dirent *fs_readdir(fs_session_t *session, DIR *dirp);
 
-int fs_closedir(DIR *dirp);
+int fs_closedir(fs_session_t *session, DIR *dirp);
 
-int fs_mkdir(const char *path, mode_t mode);
+int fs_mkdir(fs_session_t *session, const char *path, mode_t mode);
 
-int fs_rmdir(const char *path);
+int fs_rmdir(fs_session_t *session, const char *path);
 
 // Files
 
-int fs_open(const char *path, int oflag, ...);
+int fs_open(fs_session_t *session, const char *path, int oflag, ...);
+
+int fs_close(fs_session_t *session, int fildes);
+
+int fs_unlink(fs_session_t *session, const char *path);
+
+/*
+ * This function removes several files at once. It is optional: backends
+ * without a bulk operation return -1 and set errno to ENOSYS, and then the
+ * connector calls fs_unlink for every path from several threads. Directories
+ * shall be reported with EISDIR (or EPERM), as fs_unlink does.
+ * PARAM paths Paths of the files to be removed (NULL entries shall be skipped)
+ *       count Number of paths
+ *       errors Array receiving, for each path, 0 if removed or its errno
+ * RETURNS -1 if error, 0 if no error (individual failures go to errors)
+ */
+int fs_unlink_batch(fs_session_t *session, const char **paths, int count, int *errors);
+
+ssize_t fs_read(fs_session_t *session, int fildes, void *buf, size_t nbyte);
+
+ssize_t fs_write(fs_session_t *session, int fildes, const void *buf, size_t nbyte);
+
+ssize_t fs_pread(fs_session_t *session, int fildes, void *buf, size_t nbyte, off_t offset);
+
+/*
+ * This function reads like fs_pread, but the data must come from one replica.
+ * It lets the connector move away from a slow or failing storage node: reads
+ * are sent to another replica after an error, or hedged on another replica
+ * when they take too long. It is optional and only used if fs_capabilities
+ * reports FS_CAP_REPLICA; otherwise it returns -1 and sets errno to ENOSYS. It
+ * may be called concurrently with fs_pread and with itself on a descriptor.
+ * PARAM fildes Descriptor returned by fs_open
+ *       replica Replica to read from, between 0 and fs_replication - 1, in the
+ *               order fs_locate reports the hosts of the block holding offset
+ *       buf Buffer receiving the contents
+ *       nbyte Bytes to be read
+ *       offset Position of the file to read from
+ * RETURNS -1 if error or the number of bytes read if no error (0 on EOF)
+ */
+ssize_t fs_pread_replica(fs_session_t *session, int fildes, int replica, void *buf, size_t nbyte, off_t offset);
+
+/*
+ * This function writes like fs_write, but at a given position and without
+ * moving the file pointer. It lets the connector write the stripes of a large
+ * file concurrently, as in a multipart upload: the file is written under a
+ * temporary name and renamed once every stripe has been written. It is
+ * optional and only used if fs_capabilities reports FS_CAP_PWRITE; otherwise
+ * it returns -1 and sets errno to ENOSYS. Stripes never overlap, and the ones
+ * after a gap may be written before the gap is filled.
+ * PARAM fildes Descriptor returned by fs_open
+ *       buf Contents to be written
+ *       nbyte Bytes to be written
+ *       offset Position of the file to write to
+ * RETURNS -1 if error or the number of bytes written if no error
+ */
+ssize_t fs_pwrite(fs_session_t *session, int fildes, const void *buf, size_t nbyte, off_t offset);
+
+/*
+ * These functions write or read a whole file in a single round trip, which is
+ * what small files benefit from the most. They are optional: backends without
+ * them return -1 and set errno to ENOSYS, and then the connector falls back to
+ * fs_open, fs_write or fs_read, and fs_close.
+ * PARAM path Path of the file to be written or read
+ *       buf Contents to be written, or buffer receiving the contents
+ *       nbyte Bytes to be written, or size of the receiving buffer
+ *       oflag Flags as in fs_open (O_CREAT with O_TRUNC or O_EXCL, or O_APPEND)
+ *       mode Permission for new files
+ * RETURNS -1 if error, 0 (fs_put) or the number of bytes read (fs_get) if no
+ *         error. fs_get returns at most nbyte bytes, even if the file is larger
+ */
+int fs_put(fs_session_t *session, const char *path, const void *buf, size_t nbyte, int oflag, mode_t mode);
+
+ssize_t fs_get(fs_session_t *session, const char *path, void *buf, size_t nbyte);
 
-int fs_close(int fildes);
+/*
+ * This function tells the filesystem how a descriptor is going to be read, so
+ * that it can size its own read-ahead and caching: whole-file scans benefit
+ * from large speculative reads, while point lookups only pay for them. It is
+ * called after fs_open and again whenever the connector changes its mind. It
+ * is optional: backends without it return -1 and set errno to ENOSYS.
+ * PARAM fildes Descriptor returned by fs_open
+ *       offset Start of the range the advice applies to
+ *       len Length of the range (0 means up to the end of the file)
+ *       advice POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL or POSIX_FADV_RANDOM,
+ *              as defined in fcntl.h
+ * RETURNS -1 if error, 0 if no error
+ */
+int fs_fadvise(fs_session_t *session, int fildes, off_t offset, off_t len, int advice);
 
-int fs_unlink(const char *path);
+/*
+ * This function reserves storage for a range of a file being written, without
+ * changing its length (as fallocate with FALLOC_FL_KEEP_SIZE), so that large
+ * sequential writes are laid out in few contiguous extents instead of growing
+ * the file one write at a time. The connector reserves ahead of its writes in
+ * chunks, or the whole file at once when its length is known, and trims what
+ * was not written with fs_ftruncate before fs_close. It is optional: backends
+ * without it return -1 and set errno to ENOSYS (or EOPNOTSUPP).
+ * PARAM fildes Descriptor returned by fs_open
+ *       offset Start of the range to be reserved
+ *       len Length of the range
+ * RETURNS -1 if error, 0 if no error
+ */
+int fs_fallocate(fs_session_t *session, int fildes, off_t offset, off_t len);
 
-ssize_t fs_read(int fildes, void *buf, size_t nbyte);
+/*
+ * This function works as ftruncate, and releases the storage reserved with
+ * fs_fallocate beyond the given length. It is optional: backends without it
+ * return -1 and set errno to ENOSYS (or EOPNOTSUPP).
+ */
+int fs_ftruncate(fs_session_t *session, int fildes, off_t length);
 
-ssize_t fs_write(int fildes, const void *buf, size_t nbyte);
+int fs_stat(fs_session_t *session, const char *path, struct stat *buf);
 
-int fs_stat(const char *path, struct stat *buf);
+/*
+ * This function stats several unrelated paths at once. It is optional:
+ * backends without a bulk operation return -1 and set errno to ENOSYS, and
+ * then the connector calls fs_stat for every path from several threads.
+ * PARAM paths Paths to be stat'ed (NULL entries shall be skipped)
+ *       count Number of paths
+ *       bufs Array receiving, for each path, its status
+ *       errors Array receiving, for each path, 0 if stat'ed or its errno
+ * RETURNS -1 if error, 0 if no error (individual failures go to errors)
+ */
+int fs_stat_batch(fs_session_t *session, const char **paths, int count, struct stat *bufs, int *errors);
 
-off_t fs_lseek(int fildes, off_t offset, int whence);
+int fs_fstat(fs_session_t *session, int fildes, struct stat *buf);
+
+/*
+ * This function works as lseek, and only accepts SEEK_DATA and SEEK_HOLE as
+ * whence if fs_capabilities reports FS_CAP_SEEK_HOLE: they move to the start
+ * of the next data (ENXIO if only holes follow) or hole (the end of the file
+ * counts as one) at or after offset, so that sparse files are copied without
+ * reading their holes.
+ */
+off_t fs_lseek(fs_session_t *session, int fildes, off_t offset, int whence);
 
 // Distribution
 
@@ -74,22 +246,68 @@ off_t fs_lseek(int fildes, off_t offset, int whence);
  * PARAM path Path of the file for which the replication wants to be retrieved
  * RETURNS -1 if error or the number of replicas for the file if no error
  */
-int fs_replication(const char *path);
+int fs_replication(fs_session_t *session, const char *path);
+
+/*
+ * This function retrieves the block size Hadoop shall use for a file. Backends
+ * without a meaningful block layout return 0, and the connector falls back to
+ * the logical block size configured for the scheme (fs.generic.block.size).
+ * PARAM path Path of the file for which the block size wants to be retrieved
+ * RETURNS -1 if error, 0 if no preference or the block size of the file
+ */
+off_t fs_blocksize(fs_session_t *session, const char *path);
 
 /*
  * This function retrieves, for each block and its corresponding replicas, the
  * hostname that stores them. In this version, memory allocation is not needed,
  * but in the future it should be provided.
  * PARAM path Path of the file which blocks are to be located
- *       urls Array containing hostname storing block i and replica j
+ *       blksize Block size used by Hadoop for the file (see fs_blocksize)
+ *       urls Array containing hostname storing block i and replica j, with
+ *            one entry for every block of the file and one for every replica
  * RETURNS -1 if error, 0 if no error
  */
-int fs_locate(const char *path, char ***urls);
+int fs_locate(fs_session_t *session, const char *path, off_t blksize, char ***urls);
 
-int fs_rename(const char *src, const char *dst);
+int fs_rename(fs_session_t *session, const char *src, const char *dst);
 
 // Change properties
 
-int fs_chmod(const char *path, mode_t permission);
+int fs_chmod(fs_session_t *session, const char *path, mode_t permission);
+
+int fs_chown(fs_session_t *session, const char *path, uid_t uid, gid_t gid);
+
+// Change notification
+
+// Change of a watched directory, as reported by fs_events
+struct fs_event {
+	int watch;	// Watch returned by fs_watch
+	char name[NAME_MAX + 1];	// Entry that changed (empty if the directory itself did)
+};
+
+/*
+ * These functions let the connector keep statuses and listings cached for as
+ * long as they do not change, instead of for a fixed time. fs_watch subscribes
+ * to the changes of a directory: entries created, removed, renamed, written or
+ * with new properties, and the removal or renaming of the directory itself
+ * (after which the watch may end on its own). Watching a directory twice may
+ * return the same watch. fs_events waits for the changes of every watch of the
+ * session, and is only called from one thread at a time. Events may arrive
+ * late but must not be lost silently: if the backend had to drop some (a full
+ * queue, a broken event stream), fs_events fails once with EOVERFLOW, and the
+ * connector then expires what it cached after a fixed time, as if unwatched.
+ * Watches stay valid after an overflow. These functions are optional:
+ * backends without them return -1 and set errno to ENOSYS.
+ * PARAM path Directory to be watched
+ *       watch Watch returned by fs_watch
+ *       events Array receiving the changes
+ *       count Size of events
+ *       timeout Milliseconds to wait for a first change (-1 waits forever)
+ * RETURNS -1 if error, the watch (fs_watch), 0 (fs_unwatch) or the number of
+ *         changes, 0 if none arrived in time (fs_events) if no error
+ */
+int fs_watch(fs_session_t *session, const char *path);
+
+int fs_unwatch(fs_session_t *session, int watch);
 
-int fs_chown(const char *path, uid_t uid, gid_t gid);
+int fs_events(fs_session_t *session, struct fs_event *events, int count, int timeout);
@@ -0,0 +1,635 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "filesystem.h"
+
+//
+// Stand-in backend
+//
+// This backend keeps files in a local directory and makes every call behave
+// like a request to remote storage, so that the connector can be benchmarked
+// (see WorkloadBenchmark) without a live cluster. It is selected at build
+// time with the standin Maven profile, and configured through the following
+// environment variables of the JVM:
+//
+// STANDIN_ROOT              Local directory holding the files (/tmp/standin)
+// STANDIN_LATENCY_META      Latency of metadata calls (open, stat, mkdir, ...)
+// STANDIN_LATENCY_DATA      Latency to the first byte of reads and writes
+// STANDIN_LATENCY_LIST      Latency of opening a listing and of each page
+// STANDIN_LIST_PAGE         Directory entries returned by each page (1000)
+// STANDIN_BANDWIDTH         Bytes per second of a single request (unlimited)
+// STANDIN_LINK_BANDWIDTH    Bytes per second shared by all requests of an
+//                           authority (unlimited)
+// STANDIN_ERROR_RATE        Probability of a call failing with EIO (0)
+// STANDIN_REPLICAS          Replicas of every file (1, FS_CAP_REPLICA if more)
+// STANDIN_NODES             Hosts blocks are spread over (4)
+// STANDIN_BLOCK_SIZE        Block size reported by fs_blocksize (0, none)
+// STANDIN_SEED              Seed of latencies and errors (time of startup)
+//
+// Latencies are given in microseconds as fixed:US, uniform:MIN:MAX, exp:MEAN
+// or lognormal:MEDIAN:SIGMA (the latter gives remote-storage-like tails), and
+// are drawn independently for every call. Data calls also take as long as
+// their bytes need at the configured bandwidths. Changes are watched through
+// inotify, so that files modified outside the connector are noticed too.
+//
+
+// Changes of a watched directory (a written file is reported on every write,
+// which inotify coalesces while they are not read)
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+// Bytes of inotify events read at once
+#define EVENT_BUFFER (64 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+
+// Latency distributions
+#define DIST_NONE 0
+#define DIST_FIXED 1
+#define DIST_UNIFORM 2
+#define DIST_EXP 3
+#define DIST_LOGNORMAL 4
+
+struct latency {
+	int dist;
+	double a;	// Fixed, minimum, mean or median (us)
+	double b;	// Maximum (us) or sigma
+};
+
+// Listing that charges a page latency every page of entries
+struct standin_dir {
+	DIR *dp;	// Must be first, so that the handle can be passed to readdir
+	long entries;
+};
+
+static struct {
+	char root[PATH_MAX];
+	struct latency meta;
+	struct latency data;
+	struct latency list;
+	long page;
+	double bandwidth;
+	double link;
+	double errors;
+	int replicas;
+	int nodes;
+	off_t blksize;
+	unsigned int seed;
+} config;
+
+// Authority, with a link of its own (as a separate storage system would have)
+struct fs_session {
+	char root[PATH_MAX];	// Directory of the authority
+	pthread_mutex_t link_lock;
+	long long link_free;	// Time the shared link is next idle (ns)
+	int notify;	// Inotify descriptor of the watches (-1 if unavailable)
+	int notify_error;	// Why notify is unavailable
+	char events[EVENT_BUFFER] __attribute__((aligned(__alignof__(struct inotify_event))));	// Events read and not yet returned
+	size_t events_start;
+	size_t events_end;
+};
+
+static pthread_once_t configured = PTHREAD_ONCE_INIT;
+static unsigned int threads = 0;	// Threads that have drawn a random number
+static __thread unsigned int seed = 0;	// Per-thread generator state
+static __thread int seeded = 0;
+
+static void parse_latency(const char *name, struct latency *latency) {
+	const char *value = getenv(name);
+
+	memset(latency, 0, sizeof(struct latency));
+	if(!value) return;
+
+	if(sscanf(value, "fixed:%lf", &latency->a) == 1) latency->dist = DIST_FIXED;
+	else if(sscanf(value, "uniform:%lf:%lf", &latency->a, &latency->b) == 2) latency->dist = DIST_UNIFORM;
+	else if(sscanf(value, "exp:%lf", &latency->a) == 1) latency->dist = DIST_EXP;
+	else if(sscanf(value, "lognormal:%lf:%lf", &latency->a, &latency->b) == 2) latency->dist = DIST_LOGNORMAL;
+	else fprintf(stderr, "standin: ignoring malformed %s=%s\n", name, value);
+}
+
+static double parse_double(const char *name, double fallback) {
+	const char *value = getenv(name);
+
+	return value ? atof(value) : fallback;
+}
+
+static void configure() {
+	const char *root = getenv("STANDIN_ROOT");
+
+	snprintf(config.root, PATH_MAX, "%s", root ? root : "/tmp/standin");
+	parse_latency("STANDIN_LATENCY_META", &config.meta);
+	parse_latency("STANDIN_LATENCY_DATA", &config.data);
+	parse_latency("STANDIN_LATENCY_LIST", &config.list);
+	config.page = (long) parse_double("STANDIN_LIST_PAGE", 1000);
+	config.bandwidth = parse_double("STANDIN_BANDWIDTH", 0);
+	config.link = parse_double("STANDIN_LINK_BANDWIDTH", 0);
+	config.errors = parse_double("STANDIN_ERROR_RATE", 0);
+	config.replicas = (int) parse_double("STANDIN_REPLICAS", 1);
+	config.nodes = (int) parse_double("STANDIN_NODES", 4);
+	config.blksize = (off_t) parse_double("STANDIN_BLOCK_SIZE", 0);
+	config.seed = (unsigned int) parse_double("STANDIN_SEED", time(NULL));
+
+	if(config.page < 1) config.page = 1;
+	if(config.replicas < 1) config.replicas = 1;
+	if(config.nodes < 1) config.nodes = 1;
+}
+
+// Uniform random number in [0, 1)
+static double uniform() {
+	if(!seeded) {
+		seed = config.seed ^ (__sync_add_and_fetch(&threads, 1) * 2654435761u);
+		seeded = 1;
+	}
+
+	return rand_r(&seed) / ((double) RAND_MAX + 1);
+}
+
+static double draw(const struct latency *latency) {
+	switch(latency->dist) {
+		case DIST_FIXED:
+			return latency->a;
+		case DIST_UNIFORM:
+			return latency->a + (latency->b - latency->a) * uniform();
+		case DIST_EXP:
+			return -latency->a * log(1 - uniform());
+		case DIST_LOGNORMAL:
+
+			// Box-Muller transform of two uniform numbers
+			return latency->a * exp(latency->b * sqrt(-2 * log(1 - uniform())) * cos(2 * M_PI * uniform()));
+		default:
+			return 0;
+	}
+}
+
+static long long now() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(long long deadline) {
+	struct timespec ts;
+	long long left;
+
+	while((left = deadline - now()) > 0) {
+		ts.tv_sec = left / 1000000000LL;
+		ts.tv_nsec = left % 1000000000LL;
+		nanosleep(&ts, NULL);
+	}
+}
+
+// Delays the caller as a request moving nbyte bytes would, and decides
+// whether the request fails
+// RETURNS -1 (errno set to EIO) if an error is injected, 0 if not
+static int request(fs_session_t *session, const struct latency *latency, size_t nbyte) {
+	long long start = now(), deadline, transfer;
+
+	deadline = start + (long long) (draw(latency) * 1000);
+	if(nbyte && config.bandwidth > 0) deadline += (long long) (nbyte * 1e9 / config.bandwidth);
+
+	// Bytes queue up on the shared link behind those of other requests
+	if(nbyte && config.link > 0) {
+		transfer = (long long) (nbyte * 1e9 / config.link);
+		pthread_mutex_lock(&session->link_lock);
+		if(session->link_free < start) session->link_free = start;
+		session->link_free += transfer;
+		if(deadline < session->link_free) deadline = session->link_free;
+		pthread_mutex_unlock(&session->link_lock);
+	}
+	sleep_until(deadline);
+
+	if(config.errors > 0 && uniform() < config.errors) {
+		errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Creates path and its missing parents
+static int mkdirs(const char *path) {
+	char buf[PATH_MAX], *p;
+
+	snprintf(buf, PATH_MAX, "%s", path);
+	for(p = buf + 1; *p; p++) {
+		if(*p != '/') continue;
+		*p = '\0';
+		if(mkdir(buf, 0755) && errno != EEXIST) return -1;
+		*p = '/';
+	}
+	if(mkdir(buf, 0755) && errno != EEXIST) return -1;
+
+	return 0;
+}
+
+// Capabilities
+
+int fs_capabilities(fs_session_t *session) {
+	pthread_once(&configured, configure);
+
+	return FS_CAP_PREAD | FS_CAP_PWRITE | FS_CAP_SEEK_HOLE | (config.replicas > 1 ? FS_CAP_REPLICA : 0);
+}
+
+// Initialization
+
+fs_session_t *fs_init(const char *authority) {
+	fs_session_t *session;
+
+	pthread_once(&configured, configure);
+
+	session = calloc(1, sizeof(struct fs_session));
+	if(!session) return NULL;
+	pthread_mutex_init(&session->link_lock, NULL);
+
+	// Watches are a local feature, a session without them still works
+	session->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	session->notify_error = errno;
+
+	// Every authority has a directory of its own under the root
+	if(snprintf(session->root, PATH_MAX, "%s/%s", config.root, authority) >= PATH_MAX) errno = ENAMETOOLONG;
+	else if(!request(session, &config.meta, 0) && !mkdirs(session->root)) return session;
+
+	fs_destroy(session);
+	return NULL;
+}
+
+int fs_destroy(fs_session_t *session) {
+	int err = errno;
+
+	pthread_mutex_destroy(&session->link_lock);
+	if(session->notify >= 0) close(session->notify);
+	free(session);
+	errno = err;
+
+	return 0;
+}
+
+// Paths
+
+int fs_translate(fs_session_t *session, const char *path, char *fspath) {
+	if(snprintf(fspath, PATH_MAX, "%s%s", session->root, path) >= PATH_MAX) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Directories
+
+DIR *fs_opendir(fs_session_t *session, const char *path) {
+	struct standin_dir *dir;
+
+	if(request(session, &config.list, 0)) return NULL;
+
+	dir = malloc(sizeof(struct standin_dir));
+	if(!dir) return NULL;
+	dir->dp = opendir(path);
+	if(!dir->dp) {
+		free(dir);
+		return NULL;
+	}
+	dir->entries = 0;
+
+	return (DIR *) dir;
+}
+
+struct dirent *fs_readdir(fs_session_t *session, DIR *dirp) {
+	struct standin_dir *dir = (struct standin_dir *) dirp;
+
+	// Entries after the first page arrive in further requests (a failed one
+	// ends the listing with errno set, and is retried by the next call)
+	if(dir->entries > 0 && dir->entries % config.page == 0 && request(session, &config.list, 0)) return NULL;
+	dir->entries++;
+
+	return readdir(dir->dp);
+}
+
+int fs_closedir(fs_session_t *session, DIR *dirp) {
+	struct standin_dir *dir = (struct standin_dir *) dirp;
+	int res;
+
+	res = closedir(dir->dp);
+	free(dir);
+
+	return res;
+}
+
+int fs_mkdir(fs_session_t *session, const char *path, mode_t mode) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return mkdir(path, mode);
+}
+
+int fs_rmdir(fs_session_t *session, const char *path) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return rmdir(path);
+}
+
+// Files
+
+int fs_open(fs_session_t *session, const char *path, int oflag, ...) {
+	mode_t mode = 0;
+	va_list ap;
+
+	if(oflag & O_CREAT) {
+		va_start(ap, oflag);
+		mode = va_arg(ap, int);
+		va_end(ap);
+	}
+	if(request(session, &config.meta, 0)) return -1;
+
+	return open(path, oflag, mode);
+}
+
+int fs_close(fs_session_t *session, int fildes) {
+	int flags = fcntl(fildes, F_GETFL);
+
+	// Written files are committed by the storage on close
+	if(flags >= 0 && (flags & O_ACCMODE) != O_RDONLY) request(session, &config.meta, 0);
+
+	return close(fildes);
+}
+
+int fs_unlink(fs_session_t *session, const char *path) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return unlink(path);
+}
+
+int fs_unlink_batch(fs_session_t *session, const char **paths, int count, int *errors) {
+	int i;
+
+	// Whole batch is a single request
+	if(request(session, &config.meta, 0)) return -1;
+
+	for(i = 0; i < count; i++) {
+		if(!paths[i]) errors[i] = 0;
+		else errors[i] = unlink(paths[i]) ? errno : 0;
+	}
+
+	return 0;
+}
+
+ssize_t fs_read(fs_session_t *session, int fildes, void *buf, size_t nbyte) {
+	if(request(session, &config.data, nbyte)) return -1;
+
+	return read(fildes, buf, nbyte);
+}
+
+ssize_t fs_write(fs_session_t *session, int fildes, const void *buf, size_t nbyte) {
+	if(request(session, &config.data, nbyte)) return -1;
+
+	return write(fildes, buf, nbyte);
+}
+
+ssize_t fs_pread(fs_session_t *session, int fildes, void *buf, size_t nbyte, off_t offset) {
+	if(request(session, &config.data, nbyte)) return -1;
+
+	return pread(fildes, buf, nbyte, offset);
+}
+
+ssize_t fs_pread_replica(fs_session_t *session, int fildes, int replica, void *buf, size_t nbyte, off_t offset) {
+	if(config.replicas < 2) {
+		errno = ENOSYS;
+		return -1;
+	}
+	if(replica < 0 || replica >= config.replicas) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Replicas share the contents but draw their latencies independently
+	return fs_pread(session, fildes, buf, nbyte, offset);
+}
+
+ssize_t fs_pwrite(fs_session_t *session, int fildes, const void *buf, size_t nbyte, off_t offset) {
+	if(request(session, &config.data, nbyte)) return -1;
+
+	return pwrite(fildes, buf, nbyte, offset);
+}
+
+int fs_put(fs_session_t *session, const char *path, const void *buf, size_t nbyte, int oflag, mode_t mode) {
+	ssize_t res;
+	size_t done;
+	int fd;
+
+	if(request(session, &config.data, nbyte)) return -1;
+
+	fd = open(path, O_WRONLY | oflag, mode);
+	if(fd < 0) return -1;
+	for(done = 0; done < nbyte; done += res) {
+		res = write(fd, (const char *) buf + done, nbyte - done);
+		if(res < 0) {
+			close(fd);
+			return -1;
+		}
+	}
+
+	return close(fd);
+}
+
+ssize_t fs_get(fs_session_t *session, const char *path, void *buf, size_t nbyte) {
+	ssize_t res, done;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if(fd < 0) return -1;
+	for(done = 0; done < (ssize_t) nbyte; done += res) {
+		res = read(fd, (char *) buf + done, nbyte - done);
+		if(res < 0) {
+			close(fd);
+			return -1;
+		}
+		if(res == 0) break;
+	}
+	close(fd);
+
+	// Contents come back with the reply to the single request
+	if(request(session, &config.data, done)) return -1;
+
+	return done;
+}
+
+int fs_fadvise(fs_session_t *session, int fildes, off_t offset, off_t len, int advice) {
+	int res;
+
+	// Advice is local to the client, it costs no request
+	res = posix_fadvise(fildes, offset, len, advice);
+	if(res) {
+		errno = res;
+		return -1;
+	}
+
+	return 0;
+}
+
+int fs_fallocate(fs_session_t *session, int fildes, off_t offset, off_t len) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return fallocate(fildes, FALLOC_FL_KEEP_SIZE, offset, len);
+}
+
+int fs_ftruncate(fs_session_t *session, int fildes, off_t length) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return ftruncate(fildes, length);
+}
+
+int fs_stat(fs_session_t *session, const char *path, struct stat *buf) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return stat(path, buf);
+}
+
+int fs_stat_batch(fs_session_t *session, const char **paths, int count, struct stat *bufs, int *errors) {
+	int i;
+
+	// Whole batch is a single request
+	if(request(session, &config.meta, 0)) return -1;
+
+	for(i = 0; i < count; i++) {
+		if(!paths[i]) errors[i] = 0;
+		else errors[i] = stat(paths[i], &bufs[i]) ? errno : 0;
+	}
+
+	return 0;
+}
+
+int fs_fstat(fs_session_t *session, int fildes, struct stat *buf) {
+	return fstat(fildes, buf);
+}
+
+off_t fs_lseek(fs_session_t *session, int fildes, off_t offset, int whence) {
+
+	// Looking up extents asks the storage, unlike moving the file pointer
+	if((whence == SEEK_DATA || whence == SEEK_HOLE) && request(session, &config.meta, 0)) return -1;
+
+	return lseek(fildes, offset, whence);
+}
+
+// Distribution
+
+int fs_replication(fs_session_t *session, const char *path) {
+	return config.replicas;
+}
+
+off_t fs_blocksize(fs_session_t *session, const char *path) {
+	return config.blksize;
+}
+
+int fs_locate(fs_session_t *session, const char *path, off_t blksize, char ***urls) {
+	struct stat st;
+	off_t blocks, i;
+	int j;
+
+	if(request(session, &config.meta, 0) || stat(path, &st)) return -1;
+
+	// Replicas of consecutive blocks go round the nodes
+	blocks = st.st_size / blksize + (st.st_size % blksize != 0);
+	for(i = 0; i < blocks; i++) {
+		for(j = 0; j < config.replicas; j++) {
+			snprintf(urls[i][j], HOST_NAME_MAX, "standin-%d", (int) ((i + j) % config.nodes));
+		}
+	}
+
+	return 0;
+}
+
+int fs_rename(fs_session_t *session, const char *src, const char *dst) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return rename(src, dst);
+}
+
+// Change properties
+
+int fs_chmod(fs_session_t *session, const char *path, mode_t permission) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return chmod(path, permission);
+}
+
+int fs_chown(fs_session_t *session, const char *path, uid_t uid, gid_t gid) {
+	if(request(session, &config.meta, 0)) return -1;
+
+	return chown(path, uid, gid);
+}
+
+// Change notification
+
+int fs_watch(fs_session_t *session, const char *path) {
+	if(session->notify < 0) {
+		errno = session->notify_error;
+		return -1;
+	}
+	if(request(session, &config.meta, 0)) return -1;
+
+	return inotify_add_watch(session->notify, path, WATCH_MASK | IN_ONLYDIR);
+}
+
+int fs_unwatch(fs_session_t *session, int watch) {
+	if(session->notify < 0) {
+		errno = session->notify_error;
+		return -1;
+	}
+
+	return inotify_rm_watch(session->notify, watch);
+}
+
+int fs_events(fs_session_t *session, struct fs_event *events, int count, int timeout) {
+	struct inotify_event *event;
+	struct pollfd ready;
+	ssize_t len;
+	int n = 0;
+
+	if(session->notify < 0) {
+		errno = session->notify_error;
+		return -1;
+	}
+
+	// Read more events only once the last ones were all returned
+	if(session->events_start == session->events_end) {
+		ready.fd = session->notify;
+		ready.events = POLLIN;
+		if(poll(&ready, 1, timeout) <= 0) return 0;
+
+		len = read(session->notify, session->events, EVENT_BUFFER);
+		if(len < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+		session->events_start = 0;
+		session->events_end = (size_t) len;
+	}
+
+	while(n < count && session->events_start < session->events_end) {
+		event = (struct inotify_event *) (session->events + session->events_start);
+
+		// Lost events are reported after the ones before them
+		if(event->mask & IN_Q_OVERFLOW) {
+			if(n > 0) break;
+			session->events_start += sizeof(struct inotify_event) + event->len;
+			errno = EOVERFLOW;
+			return -1;
+		}
+		session->events_start += sizeof(struct inotify_event) + event->len;
+
+		// Ended watches were already reported through their directory
+		if(event->mask & IN_IGNORED) continue;
+
+		events[n].watch = event->wd;
+		snprintf(events[n].name, NAME_MAX + 1, "%s", event->len > 0 ? event->name : "");
+		n++;
+	}
+
+	return n;
+}
@@ -1,4 +1,6 @@
 #include <jni.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
@@ -6,13 +8,19 @@
 #include <grp.h>
 #include <limits.h>
 #include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include "fs/filesystem.h"
+#include "util/crc32c.h"
+#include "util/glob.h"
+#include "util/pool.h"
 
 #define GROUPNAME_MAX 64
 #define USERNAME_MAX 64
 #define ERR_MAX 1024
+#define IO_BUFFER_SIZE (1024 * 1024)
 
 // Class name
 #define STRING_NAME "java/lang/String"
@@ -23,8 +31,10 @@
 #define PATH_NAME "org/apache/hadoop/fs/Path"
 #define FILESTATUS_NAME "org/apache/hadoop/fs/FileStatus"
 #define FSPERMISSION_NAME "org/apache/hadoop/fs/permission/FsPermission"
-#define ARRAYLIST_NAME "java/util/ArrayList"
 #define BLOCKLOCATION_NAME "org/apache/hadoop/fs/BlockLocation"
+#define LOCATEDFILESTATUS_NAME "org/apache/hadoop/fs/LocatedFileStatus"
+#define CONTENTSUMMARY_NAME "org/apache/hadoop/fs/ContentSummary"
+#define GENERICFILESYSTEM_NAME "org/apache/hadoop/fs/connector/generic/GenericFileSystem"
 #define GENERICINPUTSTREAM_NAME "org/apache/hadoop/fs/connector/generic/stream/GenericInputStream"
 #define GENERICOUTPUTSTREAM_NAME "org/apache/hadoop/fs/connector/generic/stream/GenericOutputStream"
 
@@ -37,12 +47,16 @@ static jclass URI;
 static jclass Path;
 static jclass FileStatus;
 static jclass FsPermission;
-static jclass ArrayList;
 static jclass BlockLocation;
+static jclass LocatedFileStatus;
+static jclass ContentSummary;
+static jclass GenericFileSystem;
 static jclass GenericInputStream;
 static jclass GenericOutputStream;
 
 // Method definition
+static jmethodID IOException_init;
+static jmethodID FileNotFoundException_init;
 static jmethodID URI_init;
 static jmethodID URI_getAuthority;
 static jmethodID URI_getScheme;
@@ -60,17 +74,47 @@ static jmethodID FileStatus_getReplication;
 static jmethodID FileStatus_isFile;
 static jmethodID FileStatus_isDirectory;
 static jmethodID FsPermission_init;
-static jmethodID ArrayList_init;
-static jmethodID ArrayList_add;
 static jmethodID BlockLocation_init;
+static jmethodID LocatedFileStatus_init;
+static jmethodID ContentSummary_init;
 
 // Field definition
+static jfieldID GenericFileSystem_threads;
+static jfieldID GenericFileSystem_blockSize;
 static jfieldID GenericInputStream_fd;
+static jfieldID GenericInputStream_fileLength;
 static jfieldID GenericOutputStream_fd;
 static jfieldID GenericOutputStream_permission;
 static jfieldID GenericOutputStream_overwrite;
 static jfieldID GenericOutputStream_append;
 
+// Backend session of an authority (see fs_init). Besides the backend state,
+// every session has helper threads, a budget of I/O buffer bytes and metrics
+// of its own, so that a slow authority only holds back calls made on it.
+struct session {
+	char authority[PATH_MAX];
+	fs_session_t *fs;
+	int refs;	// GenericSession objects and listing cursors
+	int status;	// SESSION_OPENING while fs_init runs, then 0, or its errno if it failed
+	int capabilities;
+	struct pool *pool;
+	pthread_mutex_t budget_lock;
+	pthread_cond_t budget_freed;
+	size_t budget;	// I/O buffer bytes (0 if unlimited)
+	size_t available;
+	long long calls;	// Metrics (see GenericSession)
+	long long bytes_read;
+	long long bytes_written;
+	long long buffer_waits;
+	struct session *next;
+};
+
+// Sessions with live references, one per authority
+#define SESSION_OPENING -1
+static struct session *sessions = NULL;
+static pthread_mutex_t sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sessions_opened = PTHREAD_COND_INITIALIZER;
+
 //    ###    ##     ## ##     ## #### ##       ####    ###    ########  ##    ##
 //   ## ##   ##     ##  ##   ##   ##  ##        ##    ## ##   ##     ##  ##  ##
 //  ##   ##  ##     ##   ## ##    ##  ##        ##   ##   ##  ##     ##   ####
@@ -107,12 +151,18 @@ int search_ids(JNIEnv *env) {
 	// FsPermission
 	FsPermission = (*env)->NewGlobalRef(env, (*env)->FindClass(env, FSPERMISSION_NAME));
 	if(!FsPermission) return -1;
-	// ArrayList
-	ArrayList = (*env)->NewGlobalRef(env, (*env)->FindClass(env, ARRAYLIST_NAME));
-	if(!ArrayList) return -1;
 	// BlockLocation
 	BlockLocation = (*env)->NewGlobalRef(env, (*env)->FindClass(env, BLOCKLOCATION_NAME));
 	if(!BlockLocation) return -1;
+	// LocatedFileStatus
+	LocatedFileStatus = (*env)->NewGlobalRef(env, (*env)->FindClass(env, LOCATEDFILESTATUS_NAME));
+	if(!LocatedFileStatus) return -1;
+	// ContentSummary
+	ContentSummary = (*env)->NewGlobalRef(env, (*env)->FindClass(env, CONTENTSUMMARY_NAME));
+	if(!ContentSummary) return -1;
+	// GenericFileSystem
+	GenericFileSystem = (*env)->NewGlobalRef(env, (*env)->FindClass(env, GENERICFILESYSTEM_NAME));
+	if(!GenericFileSystem) return -1;
 	// GenericInputStream
 	GenericInputStream = (*env)->NewGlobalRef(env, (*env)->FindClass(env, GENERICINPUTSTREAM_NAME));
 	if(!GenericInputStream) return -1;
@@ -122,6 +172,12 @@ int search_ids(JNIEnv *env) {
 
 	// Search for all required method IDs
 
+	// IOException: (Constructor) IOException(String message)
+	IOException_init = (*env)->GetMethodID(env, IOException, "<init>", "(Ljava/lang/String;)V");
+	if(!IOException_init) return -1;
+	// FileNotFoundException: (Constructor) FileNotFoundException(String message)
+	FileNotFoundException_init = (*env)->GetMethodID(env, FileNotFoundException, "<init>", "(Ljava/lang/String;)V");
+	if(!FileNotFoundException_init) return -1;
 	// URI: (Constructor) URI(String str)
 	URI_init = (*env)->GetMethodID(env, URI, "<init>", "(Ljava/lang/String;)V");
 	if(!URI_init) return -1;
@@ -173,21 +229,30 @@ int search_ids(JNIEnv *env) {
 	// FsPermission: (Constructor) FsPermission(short)
 	FsPermission_init = (*env)->GetMethodID(env, FsPermission, "<init>", "(S)V");
 	if(!FsPermission_init) return -1;
-	// ArrayList: (Constructor) ArrayList()
-	ArrayList_init = (*env)->GetMethodID(env, ArrayList, "<init>", "()V");
-	if(!ArrayList_init) return -1;
-	// ArrayList: boolean add(Object)
-	ArrayList_add = (*env)->GetMethodID(env, ArrayList, "add", "(Ljava/lang/Object;)Z");
-	if(!ArrayList_add) return -1;
 	// BlockLocation: (Constructor) BlockLocation(String[] names, String[] hosts, long offset, long length)
 	BlockLocation_init = (*env)->GetMethodID(env, BlockLocation, "<init>", "([Ljava/lang/String;[Ljava/lang/String;JJ)V");
 	if(!BlockLocation_init) return -1;
+	// LocatedFileStatus: (Constructor) LocatedFileStatus(FileStatus stat, BlockLocation[] locations)
+	LocatedFileStatus_init = (*env)->GetMethodID(env, LocatedFileStatus, "<init>", "(Lorg/apache/hadoop/fs/FileStatus;[Lorg/apache/hadoop/fs/BlockLocation;)V");
+	if(!LocatedFileStatus_init) return -1;
+	// ContentSummary: (Constructor) ContentSummary(long length, long fileCount, long directoryCount)
+	ContentSummary_init = (*env)->GetMethodID(env, ContentSummary, "<init>", "(JJJ)V");
+	if(!ContentSummary_init) return -1;
 
 	// Search for all required field IDs
 
+	// GenericFileSystem: threads
+	GenericFileSystem_threads = (*env)->GetFieldID(env, GenericFileSystem, "threads", "I");
+	if(!GenericFileSystem_threads) return -1;
+	// GenericFileSystem: blockSize
+	GenericFileSystem_blockSize = (*env)->GetFieldID(env, GenericFileSystem, "blockSize", "J");
+	if(!GenericFileSystem_blockSize) return -1;
 	// GenericInputStream: fd
 	GenericInputStream_fd = (*env)->GetFieldID(env, GenericInputStream, "fd", "I");
 	if(!GenericInputStream_fd) return -1;
+	// GenericInputStream: fileLength
+	GenericInputStream_fileLength = (*env)->GetFieldID(env, GenericInputStream, "fileLength", "J");
+	if(!GenericInputStream_fileLength) return -1;
 	// GenericOutputStream: fd
 	GenericOutputStream_fd = (*env)->GetFieldID(env, GenericOutputStream, "fd", "I");
 	if(!GenericOutputStream_fd) return -1;
@@ -224,10 +289,14 @@ void destroy_ids(JNIEnv *env) {
 	(*env)->DeleteGlobalRef(env, FileStatus);
 	// FsPermission
 	(*env)->DeleteGlobalRef(env, FsPermission);
-	// ArrayList
-	(*env)->DeleteGlobalRef(env, ArrayList);
 	// BlockLocation
 	(*env)->DeleteGlobalRef(env, BlockLocation);
+	// LocatedFileStatus
+	(*env)->DeleteGlobalRef(env, LocatedFileStatus);
+	// ContentSummary
+	(*env)->DeleteGlobalRef(env, ContentSummary);
+	// GenericFileSystem
+	(*env)->DeleteGlobalRef(env, GenericFileSystem);
 	// GenericInputStream
 	(*env)->DeleteGlobalRef(env, GenericInputStream);
 	// GenericOutputStream
@@ -236,19 +305,163 @@ void destroy_ids(JNIEnv *env) {
 	return;
 }
 
-int remove_directory(const char *path) {
+// Finds the session of an authority, or opens it with the given helper
+// threads and buffer budget (later references keep those of the first one).
+// The backend is initialized outside the lock of the session list, so that
+// other authorities are not held back: the session is listed as opening until
+// then, and references taken meanwhile wait for the outcome.
+// RETURNS NULL if error (errno set), or the session with a new reference
+struct session *session_open(const char *authority, int threads, size_t budget) {
+	struct session *session, **link;
+	int error = 0, last = 0;
+
+	pthread_mutex_lock(&sessions_lock);
+	for(session = sessions; session && strcmp(session->authority, authority); session = session->next);
+	if(session) {
+		session->refs++;
+		while(session->status == SESSION_OPENING) pthread_cond_wait(&sessions_opened, &sessions_lock);
+		if(!session->status) {
+			pthread_mutex_unlock(&sessions_lock);
+			return session;
+		}
+
+		// Opening failed, the last one to learn it frees the session
+		error = session->status;
+		last = --session->refs == 0;
+		pthread_mutex_unlock(&sessions_lock);
+		if(last) free(session);
+		errno = error;
+		return NULL;
+	}
+
+	session = calloc(1, sizeof(struct session));
+	if(!session) {
+		pthread_mutex_unlock(&sessions_lock);
+		errno = ENOMEM;
+		return NULL;
+	}
+	strcpy(session->authority, authority);
+	session->status = SESSION_OPENING;
+	session->refs = 1;
+	session->next = sessions;
+	sessions = session;
+	pthread_mutex_unlock(&sessions_lock);
+
+	session->pool = pool_create(threads);
+	session->fs = session->pool ? fs_init(authority) : NULL;
+	if(session->fs) {
+		session->capabilities = fs_capabilities(session->fs);
+		pthread_mutex_init(&session->budget_lock, NULL);
+		pthread_cond_init(&session->budget_freed, NULL);
+		session->budget = session->available = budget;
+	}
+	else {
+		error = errno ? errno : EIO;
+		pool_destroy(session->pool);
+	}
+
+	pthread_mutex_lock(&sessions_lock);
+	session->status = error;
+	if(error) {
+		for(link = &sessions; *link != session; link = &(*link)->next);
+		*link = session->next;
+		last = --session->refs == 0;
+	}
+	pthread_cond_broadcast(&sessions_opened);
+	pthread_mutex_unlock(&sessions_lock);
+
+	if(!error) return session;
+	if(last) free(session);
+	errno = error;
+	return NULL;
+}
+
+void session_retain(struct session *session) {
+	pthread_mutex_lock(&sessions_lock);
+	session->refs++;
+	pthread_mutex_unlock(&sessions_lock);
+}
+
+// Drops a reference, closing the session with the last one
+// RETURNS -1 if error (errno set), 0 if no error
+int session_release(struct session *session) {
+	struct session **link;
+	int res;
+
+	pthread_mutex_lock(&sessions_lock);
+	if(--session->refs > 0) {
+		pthread_mutex_unlock(&sessions_lock);
+		return 0;
+	}
+	for(link = &sessions; *link != session; link = &(*link)->next);
+	*link = session->next;
+	pthread_mutex_unlock(&sessions_lock);
+
+	// No call is running on the session anymore
+	pool_destroy(session->pool);
+	res = fs_destroy(session->fs);
+	pthread_cond_destroy(&session->budget_freed);
+	pthread_mutex_destroy(&session->budget_lock);
+	free(session);
+
+	return res;
+}
+
+// Bytes of the budget a buffer takes (buffers larger than the whole budget
+// take all of it, so that they wait for every other buffer but still run)
+size_t session_charge(struct session *session, size_t size) {
+	return session->budget && size > session->budget ? session->budget : size;
+}
+
+// Gives back a buffer of session_alloc
+void session_free(struct session *session, void *buffer, size_t size) {
+	free(buffer);
+	if(!session->budget) return;
+
+	pthread_mutex_lock(&session->budget_lock);
+	session->available += session_charge(session, size);
+	pthread_cond_broadcast(&session->budget_freed);
+	pthread_mutex_unlock(&session->budget_lock);
+}
+
+// Allocates an I/O buffer within the budget of a session, waiting for calls
+// on the session to give back theirs if it is exhausted. Calls never hold
+// more than one buffer at a time, so waits always end.
+// RETURNS NULL if error (errno set), or the buffer
+void *session_alloc(struct session *session, size_t size) {
+	size_t charge = session_charge(session, size);
+	void *buffer;
+
+	if(session->budget) {
+		pthread_mutex_lock(&session->budget_lock);
+		if(session->available < charge) session->buffer_waits++;
+		while(session->available < charge) pthread_cond_wait(&session->budget_freed, &session->budget_lock);
+		session->available -= charge;
+		pthread_mutex_unlock(&session->budget_lock);
+	}
+
+	buffer = malloc(size ? size : 1);
+	if(!buffer) {
+		session_free(session, NULL, size);
+		errno = ENOMEM;
+	}
+
+	return buffer;
+}
+
+int remove_directory(fs_session_t *fs, const char *path) {
 	DIR *d;
 	size_t path_len;
 	int r = -1;
 
 	path_len = strlen(path);
-	d = fs_opendir(path);
+	d = fs_opendir(fs, path);
 	if (d) {
 		struct dirent *p;
 
 		r = 0;
 
-		while (!r && (p=fs_readdir(d))){
+		while (!r && (p=fs_readdir(fs, d))){
 			int r2 = -1;
 			char *buf;
 			size_t len;
@@ -262,360 +475,1819 @@ int remove_directory(const char *path) {
 			if (buf) {
 				struct stat statbuf;
 				snprintf(buf, len, "%s/%s", path, p->d_name);
-				if (!fs_stat(buf, &statbuf)) {
+				if (!fs_stat(fs, buf, &statbuf)) {
 					if (S_ISDIR(statbuf.st_mode)) {
-						r2 = remove_directory(buf);
+						r2 = remove_directory(fs, buf);
 					}
 					else {
-						r2 = fs_unlink(buf);
+						r2 = fs_unlink(fs, buf);
 					}
 				}
 				free(buf);
 			}
 			r = r2;
 		}
-		fs_closedir(d);
+		fs_closedir(fs, d);
 	}
 	if (!r) {
-		r = fs_rmdir(path);
+		r = fs_rmdir(fs, path);
 	}
 	return r;
 }
 
-int parseString(JNIEnv *env, const jstring jstr, char* str, int length) {
-	const char* tmp;
+// Makes path and every missing parent
+// RETURNS -1 if error (errno set, err describes it), 0 if no error
+int make_directories(fs_session_t *fs, char *path, mode_t permission, char *err) {
+	struct stat check;
+	char *pointer;
+	size_t length;
+	int res;
 
-	// Convert string to char array
-	tmp = (*env)->GetStringUTFChars(env, jstr, 0);
+	// Save path length
+	length = strlen(path);
 
-	// Check path length
-	if(strlen(tmp) >= length) {
+	// Root (mount point) is always present
+	if(strcmp(path, "/") == 0) return 0;
 
-		// Release memory for char array
-		(*env)->ReleaseStringUTFChars(env, jstr, tmp);
-		return -1;
-	}
+	// Remove trailing "/" from path if present
+	if(path[length-1] == '/') path[length-1] = '\0';
 
-	// Copy char array to result
-	strcpy(str, tmp);
+	// Iterate over path char by char
+	for(pointer = path + 1; *pointer != '\0'; pointer++) {
 
-	// Release memory for char array
-	(*env)->ReleaseStringUTFChars(env, jstr, tmp);
+		// Once a "/" is found, convert to NULL to fake string ending
+		if(*pointer == '/') {
+			*pointer = '\0';
 
-	return 0;
-}
+			// Get file stats
+			res = fs_stat(fs, path, &check);
 
-int parsePath(JNIEnv *env, const jobject jpath, char* path) {
-	jstring jstr;
+			if(res == 0 && S_ISDIR(check.st_mode)) {
 
-	// Convert path to string
-	jstr = (*env)->CallObjectMethod(env, jpath, Path_toString);
+				// If file exists, and it is a directory, don't make it
+				*pointer = '/';
+				continue;
+			}
+			else if (res == 0) {
 
-	// Convert string to char array
-	if(parseString(env, jstr, path, PATH_MAX)) {
-		return -1;
-	}
+				// If file exists, but is not a directory, fail
+				sprintf(err, "fs_mkdir: '%s' is a FILE", path);
+				*pointer = '/';
+				errno = ENOTDIR;
+				return -1;
+			}
+			else {
 
-	return 0;
-}
+				// If file doesn't exist, make directory
+				res = fs_mkdir(fs, path, permission);
+				if(res < 0 && errno != EEXIST) {
+					res = errno;
+					sprintf(err, "fs_mkdir: %s", strerror(res));
+					*pointer = '/';
+					errno = res;
+					return -1;
+				}
+			}
 
-int translatePath(JNIEnv *env, const jobject jpath, char* path) {
-	char rpath[PATH_MAX], authority[PATH_MAX];
-	jobject jpathnouri, uri, jauthority;
+			// Turn '\0' back to '/' so that processing can continue
+			*pointer = '/';
+		}
+	}
 
-	// Remove URI from path
-	jpathnouri = (*env)->CallStaticObjectMethod(env, Path, Path_getPathWithoutSchemeAndAuthority, jpath);
+	// Get file stats for last entry
+	res = fs_stat(fs, path, &check);
 
-	// Get URI from path
-	uri = (*env)->CallObjectMethod(env, jpath, Path_toUri);
+	if(res == 0 && S_ISDIR(check.st_mode)) {
 
-	// Get authority from URI
-	jauthority = (*env)->CallObjectMethod(env, uri, URI_getAuthority);
+		// If file exists, and it is a directory, don't make it (we're done)
+		return 0;
+	}
+	else if(res == 0) {
 
-	// Convert authority to char array
-	if(parseString(env, jauthority, authority, PATH_MAX)) return -1;
+		// If file exists, but is not a directory, fail
+		sprintf(err, "fs_mkdir: '%s' is a FILE", path);
+		errno = ENOTDIR;
+		return -1;
+	}
 
-	// Convert path without URI to char array
-	if(parsePath(env, jpathnouri, rpath)) return -1;
+	// Make last directory entry through Expand library (full path)
+	if(fs_mkdir(fs, path, permission) && errno != EEXIST) {
+		res = errno;
+		sprintf(err, "fs_mkdir: %s", strerror(res));
+		errno = res;
+		return -1;
+	}
 
-	// Generate actual path from authority and its relative path
-	return fs_translate(authority, rpath, path);
+	return 0;
 }
 
-// ##     ##    ###    #### ##    ##
-// ###   ###   ## ##    ##  ###   ##
-// #### ####  ##   ##   ##  ####  ##
-// ## ### ## ##     ##  ##  ## ## ##
-// ##     ## #########  ##  ##  ####
-// ##     ## ##     ##  ##  ##   ###
-// ##     ## ##     ## #### ##    ##
-
-// [GenericFileSystem] void initConnector() throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_initConnector(JNIEnv *env, jobject obj) {
-	char err[ERR_MAX];
-
-	// Search for Java class IDs and method IDs
-	if(search_ids(env)) {
-		return;
-	}
+int put_file(fs_session_t *fs, char *path, const void *buf, size_t len, int flags, mode_t mode, mode_t dirmode, const char **call) {
+	char err[ERR_MAX], *slash;
+	size_t count = 0;
+	ssize_t res;
+	int fd, retried = 0;
+
+	for(;;) {
+
+		// Whole file in one round trip if backend supports it
+		*call = "fs_put";
+		if(!fs_put(fs, path, buf, len, flags, mode)) return 0;
+
+		// Otherwise open, write and close
+		if(errno == ENOSYS) {
+			*call = "fs_open";
+			fd = fs_open(fs, path, O_WRONLY | flags, mode);
+			if(fd >= 0) {
+				*call = "fs_write";
+				for(count = 0; count < len; count += res) {
+					res = fs_write(fs, fd, (const char *) buf + count, len - count);
+					if(res <= 0) {
+						if(res == 0) errno = EIO;
+						break;
+					}
+				}
+				if(count == len) {
+					*call = "fs_close";
+					if(!fs_close(fs, fd)) return 0;
+				}
+				else {
+					res = errno;
+					fs_close(fs, fd);
+					errno = res;
+				}
+				return errno ? errno : EIO;
+			}
+		}
 
-	// Initialize Expand library
-	if(fs_init()) {
-		sprintf(err, "fs_init: %s", strerror(errno));
-		(*env)->ThrowNew(env, IOException, err);
-		return;
+		// Missing parent is only created (once) after a failed attempt, so
+		// that the common case costs no fs_stat at all
+		if(errno != ENOENT || retried || !(flags & O_CREAT) || !(slash = strrchr(path, '/')) || slash == path) return errno;
+		*slash = '\0';
+		res = make_directories(fs, path, dirmode, err);
+		*slash = '/';
+		if(res) {
+			*call = "make_directories";
+			return errno;
+		}
+		retried = 1;
 	}
 }
 
-// [GenericFileSystem] void destConnector() throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_destConnector(JNIEnv *env, jobject obj) {
-	char err[ERR_MAX];
-
-	// Destroy cached Java class IDs and method IDs
-	destroy_ids(env);
-
-	// Destroy Expand library
-	if(fs_destroy()) {
-		sprintf(err, "fs_destroy: %s", strerror(errno));
-		(*env)->ThrowNew(env, IOException, err);
-		return;
+ssize_t get_file(fs_session_t *fs, const char *path, void *buf, size_t len, const char **call) {
+	size_t count = 0;
+	ssize_t res;
+	int fd, error;
+
+	// Whole file in one round trip if backend supports it
+	*call = "fs_get";
+	res = fs_get(fs, path, buf, len);
+	if(res >= 0 || errno != ENOSYS) return res;
+
+	// Otherwise open, read until EOF or buffer full and close
+	*call = "fs_open";
+	fd = fs_open(fs, path, O_RDONLY);
+	if(fd < 0) return -1;
+	*call = "fs_read";
+	res = 0;
+	while(count < len && (res = fs_read(fs, fd, (char *) buf + count, len - count)) > 0) count += (size_t) res;
+	if(res < 0) {
+		error = errno;
+		fs_close(fs, fd);
+		errno = error;
+		return -1;
 	}
-}
+	*call = "fs_close";
+	if(fs_close(fs, fd)) return -1;
 
-// [GenericFileSystem] FileStatus getFileStatus0(Path path) throws IOException
-JNIEXPORT jobject JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getFileStatus0(JNIEnv *env, jobject obj, jobject jpath) {
-	char path[PATH_MAX], err[ERR_MAX];
-	DIR *dir;
-	struct stat statbuf;
-	struct passwd *pwd;
-	struct group *grp;
-	uid_t uid = -1;
-	gid_t gid = -1;
-	mode_t mode = 0;
-	jlong size = 0, blksize = 0, modtime = 0, acctime = 0;
-	jint res = -1, blkrep = -1;
-	jboolean isdir;
-	jobject permission;
-	jstring owner, group;
+	return (ssize_t) count;
+}
 
-	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return NULL;
+int same_hosts(char **a, char **b, int replication) {
+	int i, j;
 
-	// Stat file or directory through Expand library
-	res = fs_stat(path, &statbuf);
-	if(res < 0) {
-		if(errno == ENOENT) {
-			sprintf(err, "fs_stat: %s", strerror(errno));
-			(*env)->ThrowNew(env, FileNotFoundException, err);
-			return NULL;
-		}
-		else {
-			sprintf(err, "fs_stat: %s", strerror(errno));
-			(*env)->ThrowNew(env, IOException, err);
-			return NULL;
-		}
+	// Both blocks must be stored on the same set of hosts (in any order)
+	for(i = 0; i < replication; i++) {
+		for(j = 0; j < replication && strcmp(a[i], b[j]); j++);
+		if(j == replication) return 0;
 	}
 
-	// Prepare results
-	size = (jlong) statbuf.st_size;
-	isdir = S_ISDIR(statbuf.st_mode);
-	blkrep = fs_replication(path);
-	blksize = (jlong) statbuf.st_blksize;
-	modtime = (jlong) statbuf.st_mtime * (jlong) 1000;
-	acctime = (jlong) statbuf.st_atime * (jlong) 1000;
-	mode = (mode_t) statbuf.st_mode;
-	uid = (uid_t) statbuf.st_uid;
-	gid = (gid_t) statbuf.st_gid;
-	if(blkrep == -1) {
-		sprintf(err, "fs_replication: %s", strerror(errno));
-		(*env)->ThrowNew(env, IOException, err);
-		return NULL;
-	}
+	return 1;
+}
 
-	// Convert mode (short) to permission (FsPermission)
-	permission = (*env)->NewObject(env, FsPermission, FsPermission_init, mode);
+void free_urls(char ***urls, jlong nblks, int replication) {
+	jlong i;
+	int j;
 
-	// Convert uid (short) to owner (String)
-	pwd = getpwuid(uid);
-	if(pwd == NULL) {
-		if(errno == 0 || errno == ENOENT || errno == ESRCH || errno == EBADF || errno == EPERM) owner = (*env)->NewStringUTF(env, "unknown");
-		else {
-			sprintf(err, "getpwuid: %s", strerror(errno));
-			(*env)->ThrowNew(env, IOException, err);
-			return NULL;
+	if(!urls) return;
+	for(i = 0; i < nblks; i++) {
+		if(!urls[i]) continue;
+		for(j = 0; j < replication; j++) {
+			free(urls[i][j]);
 		}
+		free(urls[i]);
 	}
-	else owner = (*env)->NewStringUTF(env, pwd->pw_name);
+	free(urls);
+}
 
-	// Convert gid (short) to group (String)
-	grp = getgrgid(gid);
-	if(grp == NULL) {
-		if(errno == 0 || errno == ENOENT || errno == ESRCH || errno == EBADF || errno == EPERM) group = (*env)->NewStringUTF(env, "unknown");
-		else {
-			sprintf(err, "getgrgid: %s", strerror(errno));
-			(*env)->ThrowNew(env, IOException, err);
+// Allocates room for the URL of every replica of every block, as fs_locate
+// fills the whole file
+// RETURNS NULL if error (errno set), or the URLs to be given to free_urls
+char ***alloc_urls(jlong nblks, int replication) {
+	char ***urls;
+	jlong i;
+	int j;
+
+	urls = calloc(nblks ? nblks : 1, sizeof(char **));
+	for(i = 0; urls && i < nblks; i++) {
+		urls[i] = calloc(replication ? replication : 1, sizeof(char *));
+		for(j = 0; urls[i] && j < replication; j++) {
+			urls[i][j] = calloc(HOST_NAME_MAX, sizeof(char));
+			if(!urls[i][j]) break;
+		}
+		if(!urls[i] || j < replication) {
+			free_urls(urls, i + 1, replication);
+			errno = ENOMEM;
 			return NULL;
 		}
 	}
-	else group = (*env)->NewStringUTF(env, grp->gr_name);
+	if(!urls) errno = ENOMEM;
 
-	return (*env)->NewObject(env, FileStatus, FileStatus_init, size, isdir, blkrep, blksize, modtime, acctime, permission, owner, group, jpath);
+	return urls;
 }
 
-// [GenericFileSystem] List<Path> getDirEntries0(Path path) throws IOException
-JNIEXPORT jobject JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getDirEntries0(JNIEnv *env, jobject obj, jobject jpath) {
-	char path[PATH_MAX], err[ERR_MAX];
-	DIR* dp;
-	struct dirent *ent;
-	jobject ret;
-	jsize cnt = 0;
+// Names and hosts of the replica URLs seen so far, so that each URL is parsed
+// and turned into Java strings once however many blocks it stores (global
+// references, as a listing keeps them across its pages)
+struct host_table {
+	char **urls;	// Open addressing by hash of the URL (NULL if free)
+	jstring *names;
+	jstring *hosts;
+	size_t count;
+	size_t size;	// Power of two, or 0 before the first URL
+};
 
-	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return NULL;
+size_t hash_url(const char *url) {
+	size_t hash = 2166136261u;
 
-	// Open directory through Expand library (if NULL, path points to file)
-	dp = fs_opendir((const char *) path);
-	if(!dp) {
-		if (errno == ENOTDIR) return NULL;
-		else {
-			sprintf(err, "fs_opendir: %s", strerror(errno));
-			(*env)->ThrowNew(env, IOException, err);
-			return NULL;
-		}
-	}
+	// FNV-1a
+	for(; *url; url++) hash = (hash ^ (unsigned char) *url) * 16777619u;
 
-	// Instantiate ArrayList to store results
-	ret = (jobject) (*env)->NewObject(env, ArrayList, ArrayList_init);
+	return hash;
+}
 
-	// Read all directory entries through Expand library
-	while(ent = fs_readdir(dp)) {
-		jstring filename;
-		jobject newpath;
+// Doubles the table, keeping it at most half full
+// RETURNS -1 if error (errno set), or 0 on success
+int grow_hosts(struct host_table *table) {
+	size_t size = table->size ? table->size * 2 : 64, i, k;
+	char **urls;
+	jstring *names, *hosts;
+
+	urls = calloc(size, sizeof(char *));
+	names = calloc(size, sizeof(jstring));
+	hosts = calloc(size, sizeof(jstring));
+	if(!urls || !names || !hosts) {
+		free(urls);
+		free(names);
+		free(hosts);
+		errno = ENOMEM;
+		return -1;
+	}
+	for(i = 0; i < table->size; i++) {
+		if(!table->urls[i]) continue;
+		for(k = hash_url(table->urls[i]) & (size - 1); urls[k]; k = (k + 1) & (size - 1));
+		urls[k] = table->urls[i];
+		names[k] = table->names[i];
+		hosts[k] = table->hosts[i];
+	}
+	free(table->urls);
+	free(table->names);
+	free(table->hosts);
+	table->urls = urls;
+	table->names = names;
+	table->hosts = hosts;
+	table->size = size;
 
-		// Ignore self directory and parent directory
-		if(!strcmp(".", ent->d_name) || !strcmp("..", ent->d_name)) continue;
+	return 0;
+}
 
-		// Convert name char array to path
-		filename = (*env)->NewStringUTF(env, ent->d_name);
+// Finds the name (authority) and host of a replica URL, parsing it if new
+// RETURNS -1 if error (Java exception pending), or 0 on success
+int intern_host(JNIEnv *env, struct host_table *table, const char *url, jstring *name, jstring *host) {
+	char err[ERR_MAX];
+	jstring jurl, jname, jhost;
+	jobject uri;
+	size_t k;
 
-		// Append entry name to parent path
-		newpath = (*env)->NewObject(env, Path, Path_init1, jpath, filename);
+	if(2 * (table->count + 1) > table->size && grow_hosts(table)) {
+		sprintf(err, "malloc: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
+	for(k = hash_url(url) & (table->size - 1); table->urls[k]; k = (k + 1) & (table->size - 1)) {
+		if(strcmp(table->urls[k], url)) continue;
+		*name = table->names[k];
+		*host = table->hosts[k];
+		return 0;
+	}
 
-		// Add entry to ArrayList object
-		(*env)->CallBooleanMethod(env, ret, ArrayList_add, newpath);
+	// Parse to URI
+	jurl = (*env)->NewStringUTF(env, url);
+	if(!jurl) return -1;
+	uri = (*env)->NewObject(env, URI, URI_init, jurl);
+	(*env)->DeleteLocalRef(env, jurl);
+	if(!uri) return -1;
+	table->urls[k] = strdup(url);
+	if(!table->urls[k]) {
+		(*env)->DeleteLocalRef(env, uri);
+		sprintf(err, "strdup: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
 	}
 
-	// Close directory through Expand
-	fs_closedir(dp);
+	// Get authority and host from URI
+	jname = (*env)->CallObjectMethod(env, uri, URI_getAuthority);
+	jhost = (*env)->CallObjectMethod(env, uri, URI_getHost);
+	table->names[k] = jname ? (*env)->NewGlobalRef(env, jname) : NULL;
+	table->hosts[k] = jhost ? (*env)->NewGlobalRef(env, jhost) : NULL;
+	table->count++;
+	*name = table->names[k];
+	*host = table->hosts[k];
+
+	(*env)->DeleteLocalRef(env, uri);
+	(*env)->DeleteLocalRef(env, jname);
+	(*env)->DeleteLocalRef(env, jhost);
 
-	return ret;
+	return 0;
 }
 
-// [GenericFileSystem] boolean mkdirs0(Path path) throws IOException
-JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_mkdirs0(JNIEnv *env, jobject obj, jobject jpath, jshort permission) {
-	struct stat check;
-	char path[PATH_MAX], err[ERR_MAX], *pointer;
-	int res;
-	jsize length;
+void free_hosts(JNIEnv *env, struct host_table *table) {
+	size_t i;
 
-	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return JNI_FALSE;
+	for(i = 0; i < table->size; i++) {
+		if(!table->urls[i]) continue;
+		free(table->urls[i]);
+		if(table->names[i]) (*env)->DeleteGlobalRef(env, table->names[i]);
+		if(table->hosts[i]) (*env)->DeleteGlobalRef(env, table->hosts[i]);
+	}
+	free(table->urls);
+	free(table->names);
+	free(table->hosts);
+	memset(table, 0, sizeof(struct host_table));
+}
 
-	// Save path length
-	length = strlen(path);
+// Builds the locations of the blocks [fblk, lblk) of a file, one per group of
+// adjacent blocks stored on the same hosts
+// RETURNS NULL if error (Java exception pending), or the BlockLocation array
+jobjectArray newBlockLocations(JNIEnv *env, char ***urls, int replication, jlong blksize, jlong tlen, jlong fblk, jlong lblk, struct host_table *table) {
+	jobjectArray blockLocations;
+	jlong i, k, ngrps = 0, z = 0;
+	int j;
 
-	// Root (mount point) is always present
-	if(strcmp(path, "/") == 0) return JNI_TRUE;
+	// Count groups of adjacent blocks stored on the same hosts
+	for(i = fblk; i < lblk; i++) {
+		if(i == fblk || !same_hosts(urls[i - 1], urls[i], replication)) ngrps++;
+	}
 
-	// Remove trailing "/" from path if present
-	if(path[length-1] == '/') path[length-1] = '\0';
+	// Prepare block locations array
+	blockLocations = (*env)->NewObjectArray(env, ngrps, BlockLocation, NULL);
+	if(!blockLocations) return NULL;
 
-	// Iterate over path char by char
-	for(pointer = path + 1; *pointer != '\0'; pointer++) {
+	// Set block locations array using Expand library results
+	for(i = fblk; i < lblk; i = k) {
+		jobjectArray names, hosts;
+		jlong offset, length;
+		jobject blockLocation;
 
-		// Once a "/" is found, convert to NULL to fake string ending
-		if(*pointer == '/') {
-			*pointer = '\0';
+		// Find the end of this group
+		for(k = i + 1; k < lblk && same_hosts(urls[i], urls[k], replication); k++);
 
-			// Get file stats
-			res = fs_stat(path, &check);
+		// Prepare name and host arrays
+		names = (*env)->NewObjectArray(env, replication, String, NULL);
+		hosts = (*env)->NewObjectArray(env, replication, String, NULL);
+		if(!names || !hosts) return NULL;
 
-			if(res == 0 && S_ISDIR(check.st_mode)) {
+		// Set names and hosts using Expand library results (shared by every block)
+		for(j = 0; j < replication; j++) {
+			jstring name, host;
 
-				// If file exists, and it is a directory, don't make it
-				*pointer = '/';
+			if(intern_host(env, table, urls[i][j], &name, &host)) return NULL;
+			(*env)->SetObjectArrayElement(env, names, j, name);
+			(*env)->SetObjectArrayElement(env, hosts, j, host);
+		}
+
+		// Calculate offset from file start
+		offset = i * blksize;
+
+		// Calculate length of the group (last block may be partial)
+		length = (k * blksize < tlen ? k * blksize : tlen) - offset;
+
+		// Create BlockLocation for this group of blocks
+		blockLocation = (*env)->NewObject(env, BlockLocation, BlockLocation_init, names, hosts, offset, length);
+		if(!blockLocation) return NULL;
+
+		// Add BlockLocation to array
+		(*env)->SetObjectArrayElement(env, blockLocations, z++, blockLocation);
+
+		// Release local references created for this group
+		(*env)->DeleteLocalRef(env, names);
+		(*env)->DeleteLocalRef(env, hosts);
+		(*env)->DeleteLocalRef(env, blockLocation);
+	}
+
+	return blockLocations;
+}
+
+struct checksum_block {
+	struct session *session;
+	const char *path;
+	off_t offset;
+	size_t length;
+	uint32_t crc;
+	int error;
+	const char *call;
+};
+
+void checksum_block(void *arg, size_t task) {
+	struct checksum_block *block = (struct checksum_block *) arg + task;
+	fs_session_t *fs = block->session->fs;
+	size_t left = block->length, size = left < IO_BUFFER_SIZE ? left : IO_BUFFER_SIZE;
+	unsigned char *buffer;
+	ssize_t res;
+	int fd;
+
+	block->crc = 0;
+
+	// Every block reads through its own file descriptor
+	buffer = session_alloc(block->session, size);
+	if(!buffer) {
+		block->error = ENOMEM;
+		block->call = "malloc";
+		return;
+	}
+	fd = fs_open(fs, block->path, O_RDONLY);
+	if(fd < 0) {
+		block->error = errno;
+		block->call = "fs_open";
+		session_free(block->session, buffer, size);
+		return;
+	}
+	if(fs_lseek(fs, fd, block->offset, SEEK_SET) != block->offset) {
+		block->error = errno;
+		block->call = "fs_lseek";
+		fs_close(fs, fd);
+		session_free(block->session, buffer, size);
+		return;
+	}
+
+	// Raw CRC register of this block, starting from zero
+	while(left > 0) {
+		res = fs_read(fs, fd, buffer, left < IO_BUFFER_SIZE ? left : IO_BUFFER_SIZE);
+		if(res <= 0) {
+			block->error = res < 0 ? errno : EIO;
+			block->call = "fs_read";
+			break;
+		}
+		block->crc = crc32c_update(block->crc, buffer, res);
+		left -= res;
+	}
+	__sync_fetch_and_add(&block->session->bytes_read, (long long) (block->length - left));
+
+	fs_close(fs, fd);
+	session_free(block->session, buffer, size);
+}
+
+struct delete_batch {
+	fs_session_t *fs;
+	char **paths;
+	int *errors;
+	const char **calls;
+	jboolean recursive;
+	int bulk;
+};
+
+void delete_path(void *arg, size_t task) {
+	struct delete_batch *batch = arg;
+	fs_session_t *fs = batch->fs;
+	const char *path = batch->paths[task];
+	struct stat check;
+	int error;
+
+	// Path could not be translated (error already set)
+	if(!path) return;
+
+	// Regular files go away with a single call (already done if bulk)
+	if(batch->bulk) error = batch->errors[task];
+	else error = fs_unlink(fs, path) ? errno : 0;
+	batch->errors[task] = error;
+	batch->calls[task] = "fs_unlink";
+	if(!error || (error != EISDIR && error != EPERM)) return;
+
+	// Directories cannot be unlinked, check whether this is one
+	if(fs_stat(fs, path, &check)) {
+		batch->errors[task] = errno;
+		batch->calls[task] = "fs_stat";
+		return;
+	}
+	if(!S_ISDIR(check.st_mode)) return;
+
+	// Recursive operation shall delete directory and all of its contents
+	if(batch->recursive) {
+		batch->errors[task] = remove_directory(fs, path) ? (errno ? errno : EIO) : 0;
+		batch->calls[task] = "remove_directory";
+	}
+
+	// Non-recursive operation shall delete directory only if empty
+	else {
+		batch->errors[task] = fs_rmdir(fs, path) ? errno : 0;
+		batch->calls[task] = "fs_rmdir";
+	}
+}
+
+struct rename_batch {
+	fs_session_t *fs;
+	char **srcs;
+	char **dsts;
+	int *errors;
+};
+
+void rename_path(void *arg, size_t task) {
+	struct rename_batch *batch = arg;
+
+	// Path could not be translated (error already set)
+	if(!batch->srcs[task] || !batch->dsts[task]) return;
+
+	// Callers already know both ends, so no fs_stat is needed
+	batch->errors[task] = fs_rename(batch->fs, batch->srcs[task], batch->dsts[task]) ? errno : 0;
+}
+
+// Open directory being listed a page at a time
+struct cursor {
+	struct session *session;	// Referenced until the cursor is closed
+	DIR *dp;
+	char path[PATH_MAX];	// Filesystem path of the directory
+	struct host_table hosts;	// Replicas of the located pages
+};
+
+// Status of a path, gathered without JNI so that any thread can do it
+struct path_status {
+	struct stat st;
+	int replication;
+	off_t blksize;
+	const char *call;	// Call that failed, if any
+	int error;	// Its errno (0 if none)
+};
+
+// Completes the status of a path already stat'ed
+void describe_path(fs_session_t *fs, const char *path, struct path_status *status) {
+	status->error = 0;
+	status->call = "fs_replication";
+	status->replication = fs_replication(fs, path);
+	if(status->replication == -1) {
+		status->error = errno;
+		return;
+	}
+	status->call = "fs_blocksize";
+	status->blksize = fs_blocksize(fs, path);
+	if(status->blksize == -1) status->error = errno;
+}
+
+void stat_path(fs_session_t *fs, const char *path, struct path_status *status) {
+	status->error = 0;
+	status->call = "fs_stat";
+	if(fs_stat(fs, path, &status->st) < 0) {
+		status->error = errno;
+		return;
+	}
+	describe_path(fs, path, status);
+}
+
+// Appends path to a growing array of strings, taking ownership of it
+int add_path(char ***paths, size_t *count, size_t *size, char *path) {
+	char **tmp;
+
+	if(*count == *size) {
+		tmp = realloc(*paths, (*size ? *size * 2 : 16) * sizeof(char *));
+		if(!tmp) {
+			errno = ENOMEM;
+			return -1;
+		}
+		*paths = tmp;
+		*size = *size ? *size * 2 : 16;
+	}
+	(*paths)[(*count)++] = path;
+
+	return 0;
+}
+
+// Joins path and name (root has its own slash already)
+char *join_path(const char *path, const char *name) {
+	char *res;
+	size_t len;
+
+	len = strlen(path) + strlen(name) + 2;
+	if(len > PATH_MAX || !(res = malloc(len))) {
+		errno = len > PATH_MAX ? ENAMETOOLONG : ENOMEM;
+		return NULL;
+	}
+	if(snprintf(res, len, "%s%s%s", path, strcmp(path, "/") ? "/" : "", name) >= (int) len) {
+		free(res);
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
+
+	return res;
+}
+
+void free_children(char **paths, size_t count) {
+	size_t i;
+
+	for(i = 0; i < count; i++) free(paths[i]);
+	free(paths);
+}
+
+// Directories to be filtered by one component of a glob pattern
+struct glob_scan {
+	fs_session_t *fs;
+	char **dirs;	// Hadoop paths, without scheme nor authority
+	const struct glob_component *component;
+	char ***matches;	// Matching children of each directory
+	size_t *counts;
+	int *errors;
+};
+
+void scan_directory(void *arg, size_t task) {
+	struct glob_scan *scan = arg;
+	char path[PATH_MAX], *child;
+	struct dirent *ent;
+	size_t size = 0;
+	fs_session_t *fs = scan->fs;
+	DIR *dp;
+
+	scan->errors[task] = 0;
+	if(fs_translate(fs, scan->dirs[task], path)) {
+		scan->errors[task] = errno ? errno : EINVAL;
+		return;
+	}
+
+	// Names are filtered while reading, nothing else is stat'ed
+	dp = fs_opendir(fs, path);
+	if(!dp) {
+		scan->errors[task] = errno;
+		return;
+	}
+	// The end of the directory leaves errno alone, a failed read sets it
+	for(;;) {
+		errno = 0;
+		if(!(ent = fs_readdir(fs, dp))) {
+			if(errno) scan->errors[task] = errno;
+			break;
+		}
+		if(!strcmp(".", ent->d_name) || !strcmp("..", ent->d_name)) continue;
+		if(!glob_match(scan->component, ent->d_name)) continue;
+		child = join_path(scan->dirs[task], ent->d_name);
+		if(!child || add_path(&scan->matches[task], &scan->counts[task], &size, child)) {
+			scan->errors[task] = errno;
+			free(child);
+			break;
+		}
+	}
+	fs_closedir(fs, dp);
+}
+
+// Expands a glob pattern without braces spanning components (see glob_expand)
+// into the Hadoop paths it may match, appending them to paths. Only the
+// components with wildcards are listed, every directory of a level in its own
+// task. Missing directories and files in the way are skipped, as in Hadoop.
+// RETURNS -1 if error (with errno and call set), 0 if no error
+int glob_paths(struct session *session, const char *pattern, int threads, char ***paths, size_t *count, size_t *size, int *wildcard, const char **call) {
+	struct glob_component component;
+	struct glob_scan scan;
+	char **level, **next, *tmp;
+	size_t nlevel = 1, nnext, snext, i, j;
+	const char *start, *end;
+	int error = 0;
+
+	level = malloc(sizeof(char *));
+	if(!level || !(level[0] = strdup("/"))) {
+		free(level);
+		*call = "malloc";
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for(start = pattern; *start && nlevel > 0 && !error; start = end) {
+
+		// Find next component (backslashes escape slashes too)
+		while(*start == '/') start++;
+		for(end = start; *end && *end != '/'; end++) {
+			if(*end == '\\' && end[1]) end++;
+		}
+		if(end == start) break;
+
+		*call = "glob_compile";
+		if(glob_compile(start, end - start, &component)) {
+			error = errno;
+			break;
+		}
+
+		// Literal components are appended without listing anything
+		if(component.literal) {
+			for(i = 0; i < nlevel && !error; i++) {
+				if(!(tmp = join_path(level[i], component.name))) error = errno;
+				else {
+					free(level[i]);
+					level[i] = tmp;
+				}
+			}
+			glob_free(&component);
+			continue;
+		}
+		*wildcard = 1;
+
+		// Scan every directory of this level in parallel
+		scan.fs = session->fs;
+		scan.dirs = level;
+		scan.component = &component;
+		scan.matches = calloc(nlevel, sizeof(char **));
+		scan.counts = calloc(nlevel, sizeof(size_t));
+		scan.errors = calloc(nlevel, sizeof(int));
+		if(!scan.matches || !scan.counts || !scan.errors) error = ENOMEM;
+		else pool_run(session->pool, threads, nlevel, scan_directory, &scan);
+
+		// Gather next level, skipping what is not a directory (or is gone)
+		next = NULL;
+		nnext = snext = 0;
+		*call = "fs_opendir";
+		for(i = 0; !error && i < nlevel; i++) {
+			if(scan.errors[i] && scan.errors[i] != ENOENT && scan.errors[i] != ENOTDIR) error = scan.errors[i];
+			for(j = 0; !error && j < scan.counts[i]; j++) {
+				if(add_path(&next, &nnext, &snext, scan.matches[i][j])) error = errno;
+				else scan.matches[i][j] = NULL;
+			}
+		}
+		for(i = 0; scan.matches && scan.counts && i < nlevel; i++) free_children(scan.matches[i], scan.counts[i]);
+		free(scan.matches);
+		free(scan.counts);
+		free(scan.errors);
+		glob_free(&component);
+
+		free_children(level, nlevel);
+		level = next;
+		nlevel = nnext;
+	}
+
+	// Hand over whatever matched the whole pattern
+	for(i = 0; !error && i < nlevel; i++) {
+		if(add_path(paths, count, size, level[i])) error = errno;
+		else level[i] = NULL;
+	}
+	free_children(level, nlevel);
+
+	if(error) {
+		errno = error;
+		return -1;
+	}
+
+	return 0;
+}
+
+struct stat_batch {
+	fs_session_t *fs;
+	char **paths;
+	struct path_status *statuses;
+};
+
+void stat_match(void *arg, size_t task) {
+	struct stat_batch *batch = arg;
+	char path[PATH_MAX];
+
+	if(fs_translate(batch->fs, batch->paths[task], path)) {
+		batch->statuses[task].call = "fs_translate";
+		batch->statuses[task].error = errno ? errno : EINVAL;
+		return;
+	}
+	stat_path(batch->fs, path, &batch->statuses[task]);
+}
+
+int compare_paths(const void *a, const void *b) {
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+// Blocks of a file and the URLs of their replicas (see fs_locate)
+struct file_blocks {
+	char ***urls;	// NULL if the file has no located blocks
+	jlong nblks;
+	jlong blksize;
+	int replication;
+};
+
+struct page_batch {
+	fs_session_t *fs;
+	char **paths;
+	struct path_status *statuses;
+	struct file_blocks *blocks;	// NULL unless files are located as well
+	jlong blockSize;	// Logical block size unless backend provides one
+};
+
+void stat_child(void *arg, size_t task) {
+	struct page_batch *batch = arg;
+	struct path_status *status = &batch->statuses[task];
+	struct file_blocks *blocks;
+	jlong size;
+
+	stat_path(batch->fs, batch->paths[task], status);
+	if(!batch->blocks || status->error || !S_ISREG(status->st.st_mode)) return;
+
+	// Files are located while their status is at hand, as getFileBlockLocations0 would
+	blocks = &batch->blocks[task];
+	size = (jlong) status->st.st_size;
+	blocks->blksize = status->blksize ? (jlong) status->blksize : batch->blockSize;
+	blocks->replication = status->replication > 0 ? status->replication : 0;
+	if(size == 0 || blocks->blksize <= 0 || blocks->replication == 0) return;
+	blocks->nblks = size / blocks->blksize + (size % blocks->blksize != 0);
+	blocks->urls = alloc_urls(blocks->nblks, blocks->replication);
+	if(!blocks->urls) {
+		status->error = errno;
+		status->call = "malloc";
+		return;
+	}
+	if(fs_locate(batch->fs, batch->paths[task], blocks->blksize, blocks->urls)) {
+		status->error = errno;
+		status->call = "fs_locate";
+	}
+}
+
+// Unrelated paths stat'ed together (already by the backend if bulk)
+struct status_batch {
+	fs_session_t *fs;
+	char **paths;
+	struct path_status *statuses;
+	int bulk;
+};
+
+void stat_status(void *arg, size_t task) {
+	struct status_batch *batch = arg;
+	struct path_status *status = &batch->statuses[task];
+
+	// Path could not be translated or stat'ed (error already set)
+	if(!batch->paths[task] || status->error) return;
+
+	if(batch->bulk) describe_path(batch->fs, batch->paths[task], status);
+	else stat_path(batch->fs, batch->paths[task], status);
+}
+
+// Totals of a subtree gathered by one thread
+struct summary {
+	jlong length;
+	jlong files;
+	jlong directories;
+};
+
+struct summary_walk {
+	fs_session_t *fs;
+	struct summary *totals;	// One per thread
+	int error;	// First errno of the walk (0 if none)
+	const char *call;
+};
+
+void summary_failed(struct summary_walk *walk, const char *call, int error) {
+	if(__sync_bool_compare_and_swap(&walk->error, 0, error)) walk->call = call;
+}
+
+void summarize_directory(void *arg, void *job, struct pool_worker *worker) {
+	struct summary_walk *walk = arg;
+	struct summary *total = &walk->totals[pool_worker_id(worker)];
+	fs_session_t *fs = walk->fs;
+	char *path = job, *child;
+	struct dirent *ent;
+	struct stat check;
+	int isdir;
+	DIR *dp;
+
+	// Nothing else to do once the walk has failed
+	if(walk->error) {
+		free(path);
+		return;
+	}
+
+	// Directories removed meanwhile are skipped
+	dp = fs_opendir(fs, path);
+	if(!dp) {
+		if(errno != ENOENT) summary_failed(walk, "fs_opendir", errno);
+		free(path);
+		return;
+	}
+
+	// The end of the directory leaves errno alone, a failed read sets it
+	while(!walk->error) {
+		errno = 0;
+		if(!(ent = fs_readdir(fs, dp))) {
+			if(errno) summary_failed(walk, "fs_readdir", errno);
+			break;
+		}
+		if(!strcmp(".", ent->d_name) || !strcmp("..", ent->d_name)) continue;
+		if(!(child = join_path(path, ent->d_name))) {
+			summary_failed(walk, "fs_readdir", errno);
+			break;
+		}
+
+		// Only files need to be stat'ed (for their length)
+#ifdef _DIRENT_HAVE_D_TYPE
+		isdir = ent->d_type == DT_DIR;
+#else
+		isdir = 0;
+#endif
+		if(!isdir) {
+			if(fs_stat(fs, child, &check)) {
+				if(errno != ENOENT) summary_failed(walk, "fs_stat", errno);
+				free(child);
 				continue;
 			}
-			else if (res == 0) {
+			isdir = S_ISDIR(check.st_mode);
+		}
+
+		// Subdirectories are walked by whichever thread is idle
+		if(isdir) {
+			total->directories++;
+			if(pool_submit(worker, child)) {
+				summary_failed(walk, "pool_submit", errno);
+				free(child);
+			}
+			continue;
+		}
+		total->files++;
+		total->length += check.st_size;
+		free(child);
+	}
+
+	fs_closedir(fs, dp);
+	free(path);
+}
+
+// Data of an open file as offset/length pairs, in a malloc'ed array. Holes
+// are only told apart if the backend reports FS_CAP_SEEK_HOLE, otherwise the
+// whole file is a single range. Returns the number of ranges, or -1 and sets
+// errno (and call) if error.
+ssize_t data_ranges(fs_session_t *fs, int fd, off_t length, off_t **ranges, const char **call) {
+	off_t offset, data, hole, *grown;
+	size_t count = 0, size = 16;
+	int holes = fs_capabilities(fs) & FS_CAP_SEEK_HOLE;
+
+	*ranges = malloc(2 * size * sizeof(off_t));
+	if(!*ranges) {
+		*call = "malloc";
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for(offset = 0; offset < length; offset = hole) {
+		if(holes) {
+			data = fs_lseek(fs, fd, offset, SEEK_DATA);
+
+			// Nothing but holes up to the end
+			if(data < 0 && errno == ENXIO) break;
+			hole = data < 0 ? -1 : fs_lseek(fs, fd, data, SEEK_HOLE);
+			if(hole < 0) {
+				*call = "fs_lseek";
+				free(*ranges);
+				*ranges = NULL;
+				return -1;
+			}
+		}
+		else {
+			data = 0;
+			hole = length;
+		}
+
+		// File may have changed since its length was learnt
+		if(data >= length || hole <= data) break;
+		if(hole > length) hole = length;
+
+		if(count == size) {
+			grown = realloc(*ranges, 4 * size * sizeof(off_t));
+			if(!grown) {
+				*call = "realloc";
+				free(*ranges);
+				*ranges = NULL;
+				errno = ENOMEM;
+				return -1;
+			}
+			*ranges = grown;
+			size *= 2;
+		}
+		(*ranges)[2 * count] = data;
+		(*ranges)[2 * count + 1] = hole - data;
+		count++;
+	}
+
+	return (ssize_t) count;
+}
+
+// Copy of a file to a local file, one stripe of its data per task (holes are
+// left alone)
+struct copy_batch {
+	struct session *session;
+	int src;
+	int dst;
+	off_t length;
+	off_t *stripes;	// Start and end of each stripe
+	int error;	// First errno (0 if none)
+	const char *call;
+};
+
+void copy_failed(struct copy_batch *batch, const char *call, int error) {
+	if(__sync_bool_compare_and_swap(&batch->error, 0, error)) batch->call = call;
+}
+
+void copy_stripe(void *arg, size_t task) {
+	struct copy_batch *batch = arg;
+	off_t start = batch->stripes[2 * task], end = batch->stripes[2 * task + 1];
+	ssize_t res, written, done;
+	size_t chunk;
+	char *buffer;
+
+	buffer = session_alloc(batch->session, IO_BUFFER_SIZE);
+	if(!buffer) {
+		copy_failed(batch, "malloc", ENOMEM);
+		return;
+	}
+
+	// Stripe goes straight from backend to local file, a buffer at a time
+	while(start < end && !batch->error) {
+		chunk = end - start < IO_BUFFER_SIZE ? (size_t) (end - start) : IO_BUFFER_SIZE;
+		res = fs_pread(batch->session->fs, batch->src, buffer, chunk, start);
+		if(res <= 0) {
+
+			// File shrank while being copied if nothing was read
+			copy_failed(batch, "fs_pread", res < 0 ? errno : EIO);
+			break;
+		}
+		for(done = 0; done < res; done += written) {
+			written = pwrite(batch->dst, buffer + done, res - done, start + done);
+			if(written < 0) {
+				copy_failed(batch, "pwrite", errno);
+				break;
+			}
+		}
+		start += res;
+		__sync_fetch_and_add(&batch->session->bytes_read, (long long) res);
+	}
+
+	session_free(batch->session, buffer, IO_BUFFER_SIZE);
+}
+
+int parseString(JNIEnv *env, const jstring jstr, char* str, int length) {
+	const char* tmp;
+
+	// Convert string to char array
+	tmp = (*env)->GetStringUTFChars(env, jstr, 0);
+
+	// Check path length
+	if(strlen(tmp) >= length) {
+
+		// Release memory for char array
+		(*env)->ReleaseStringUTFChars(env, jstr, tmp);
+		return -1;
+	}
+
+	// Copy char array to result
+	strcpy(str, tmp);
+
+	// Release memory for char array
+	(*env)->ReleaseStringUTFChars(env, jstr, tmp);
+
+	return 0;
+}
+
+int parsePath(JNIEnv *env, const jobject jpath, char* path) {
+	jstring jstr;
+
+	// Convert path to string
+	jstr = (*env)->CallObjectMethod(env, jpath, Path_toString);
+
+	// Convert string to char array
+	if(parseString(env, jstr, path, PATH_MAX)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// Session a call is made on (as given by GenericSession), counted in its metrics
+struct session *getSession(jlong jsession) {
+	struct session *session = (struct session *) (intptr_t) jsession;
+
+	__sync_fetch_and_add(&session->calls, 1);
+	return session;
+}
+
+int translatePath(JNIEnv *env, struct session *session, const jobject jpath, char* path) {
+	char rpath[PATH_MAX];
+	jobject jpathnouri;
+
+	// Remove URI from path (it belongs to the authority of the session)
+	jpathnouri = (*env)->CallStaticObjectMethod(env, Path, Path_getPathWithoutSchemeAndAuthority, jpath);
+
+	// Convert path without URI to char array
+	if(parsePath(env, jpathnouri, rpath)) return -1;
+
+	// Generate actual path from the session and its relative path
+	return fs_translate(session->fs, rpath, path);
+}
+
+char **translatePaths(JNIEnv *env, struct session *session, const jobjectArray jpaths, jsize count) {
+	char path[PATH_MAX], **paths;
+	jobject jpath;
+	jsize i;
+
+	// Paths that cannot be translated are left NULL
+	paths = calloc(count ? count : 1, sizeof(char *));
+	if(!paths) return NULL;
+
+	for(i = 0; i < count; i++) {
+		jpath = (*env)->GetObjectArrayElement(env, jpaths, i);
+		if(jpath && !translatePath(env, session, jpath, path)) paths[i] = strdup(path);
+		(*env)->DeleteLocalRef(env, jpath);
+
+		// Translation errors are reported per path, not for the whole batch
+		if((*env)->ExceptionCheck(env)) (*env)->ExceptionClear(env);
+	}
+
+	return paths;
+}
+
+void freePaths(char **paths, jsize count) {
+	jsize i;
+
+	if(!paths) return;
+	for(i = 0; i < count; i++) free(paths[i]);
+	free(paths);
+}
+
+jobject newException(JNIEnv *env, const char *call, int error) {
+	char err[ERR_MAX];
+	jstring message;
+	jobject exception;
+
+	// Missing files map to FileNotFoundException, as single operations do
+	sprintf(err, "%s: %s", call, strerror(error));
+	message = (*env)->NewStringUTF(env, err);
+	if(error == ENOENT) exception = (*env)->NewObject(env, FileNotFoundException, FileNotFoundException_init, message);
+	else exception = (*env)->NewObject(env, IOException, IOException_init, message);
+	(*env)->DeleteLocalRef(env, message);
+
+	return exception;
+}
+
+// Version of an open file as FileStatus reports it: modification time (in
+// milliseconds) and length. Backends that cannot stat descriptors stat the path.
+// RETURNS -1 if error (Java exception pending), or 0 on success
+int getVersion(JNIEnv *env, struct session *session, jint fd, const char *path, jlongArray jversion) {
+	char err[ERR_MAX];
+	struct stat statbuf;
+	jlong version[2];
+
+	if(fs_fstat(session->fs, fd, &statbuf) && (errno != ENOSYS || fs_stat(session->fs, path, &statbuf))) {
+		sprintf(err, "fs_fstat: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
+	version[0] = (jlong) statbuf.st_mtime * (jlong) 1000;
+	version[1] = (jlong) statbuf.st_size;
+	(*env)->SetLongArrayRegion(env, jversion, 0, 2, version);
+
+	return 0;
+}
+
+jobject newFileStatus(JNIEnv *env, const struct path_status *status, jobject jpath, jlong defaultBlockSize) {
+	char err[ERR_MAX];
+	struct passwd *pwd;
+	struct group *grp;
+	uid_t uid = -1;
+	gid_t gid = -1;
+	mode_t mode = 0;
+	jlong size = 0, blksize = 0, modtime = 0, acctime = 0;
+	jint blkrep = -1;
+	jboolean isdir;
+	jobject permission, res;
+	jstring owner, group;
+
+	// Prepare results
+	size = (jlong) status->st.st_size;
+	isdir = S_ISDIR(status->st.st_mode);
+	blkrep = status->replication;
+	blksize = (jlong) status->blksize;
+	modtime = (jlong) status->st.st_mtime * (jlong) 1000;
+	acctime = (jlong) status->st.st_atime * (jlong) 1000;
+	mode = (mode_t) status->st.st_mode;
+	uid = (uid_t) status->st.st_uid;
+	gid = (gid_t) status->st.st_gid;
+
+	// Backend has no block layout for this file, use logical block size
+	if(blksize == 0) blksize = defaultBlockSize;
+
+	// Convert mode (short) to permission (FsPermission)
+	permission = (*env)->NewObject(env, FsPermission, FsPermission_init, mode);
+
+	// Convert uid (short) to owner (String)
+	pwd = getpwuid(uid);
+	if(pwd == NULL) {
+		if(errno == 0 || errno == ENOENT || errno == ESRCH || errno == EBADF || errno == EPERM) owner = (*env)->NewStringUTF(env, "unknown");
+		else {
+			sprintf(err, "getpwuid: %s", strerror(errno));
+			(*env)->ThrowNew(env, IOException, err);
+			return NULL;
+		}
+	}
+	else owner = (*env)->NewStringUTF(env, pwd->pw_name);
+
+	// Convert gid (short) to group (String)
+	grp = getgrgid(gid);
+	if(grp == NULL) {
+		if(errno == 0 || errno == ENOENT || errno == ESRCH || errno == EBADF || errno == EPERM) group = (*env)->NewStringUTF(env, "unknown");
+		else {
+			sprintf(err, "getgrgid: %s", strerror(errno));
+			(*env)->ThrowNew(env, IOException, err);
+			return NULL;
+		}
+	}
+	else group = (*env)->NewStringUTF(env, grp->gr_name);
+
+	res = (*env)->NewObject(env, FileStatus, FileStatus_init, size, isdir, blkrep, blksize, modtime, acctime, permission, owner, group, jpath);
+
+	// Callers may build many statuses in a row
+	(*env)->DeleteLocalRef(env, permission);
+	(*env)->DeleteLocalRef(env, owner);
+	(*env)->DeleteLocalRef(env, group);
+
+	return res;
+}
+
+//       ## ##    ## ####
+//       ## ###   ##  ##
+//       ## ####  ##  ##
+//       ## ## ## ##  ##
+// ##    ## ##  ####  ##
+// ##    ## ##   ###  ##
+//  ######  ##    ## ####
+
+// Class, method and field IDs are looked up once, when the library is loaded
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+	JNIEnv *env;
+
+	if((*vm)->GetEnv(vm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) return JNI_ERR;
+
+	// Search for Java class IDs and method IDs
+	if(search_ids(env)) return JNI_ERR;
+
+	// Pick CRC32C kernel for this CPU
+	crc32c_init();
+
+	return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *reserved) {
+	JNIEnv *env;
+
+	if((*vm)->GetEnv(vm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) return;
+
+	// Destroy cached Java class IDs and method IDs
+	destroy_ids(env);
+}
+
+// ##     ##    ###    #### ##    ##
+// ###   ###   ## ##    ##  ###   ##
+// #### ####  ##   ##   ##  ####  ##
+// ## ### ## ##     ##  ##  ## ## ##
+// ##     ## #########  ##  ##  ####
+// ##     ## ##     ##  ##  ##   ###
+// ##     ## ##     ## #### ##    ##
+
+// [GenericSession] static long open0(String authority, int threads, long bufferBudget) throws IOException
+JNIEXPORT jlong JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericSession_open0(JNIEnv *env, jclass cls, jstring jauthority, jint threads, jlong bufferBudget) {
+	char authority[PATH_MAX], err[ERR_MAX];
+	struct session *session;
+
+	// Convert authority to char array
+	if(parseString(env, jauthority, authority, PATH_MAX)) {
+		(*env)->ThrowNew(env, IOException, "open0: authority too long");
+		return 0;
+	}
+
+	// Only the first reference for an authority initializes the library
+	session = session_open(authority, threads > 0 ? threads : 0, bufferBudget > 0 ? (size_t) bufferBudget : 0);
+	if(!session) {
+		sprintf(err, "fs_init: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return 0;
+	}
+
+	return (jlong) (intptr_t) session;
+}
+
+// [GenericSession] static void close0(long session) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericSession_close0(JNIEnv *env, jclass cls, jlong jsession) {
+	char err[ERR_MAX];
+
+	// Only the last reference for an authority destroys the library
+	if(session_release((struct session *) (intptr_t) jsession)) {
+		sprintf(err, "fs_destroy: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+}
+
+// [GenericSession] static int getCapabilities0(long session)
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericSession_getCapabilities0(JNIEnv *env, jclass cls, jlong jsession) {
+	return ((struct session *) (intptr_t) jsession)->capabilities;
+}
+
+// [GenericSession] static long[] getMetrics0(long session)
+JNIEXPORT jlongArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericSession_getMetrics0(JNIEnv *env, jclass cls, jlong jsession) {
+	struct session *session = (struct session *) (intptr_t) jsession;
+	jlongArray array;
+	jlong metrics[8];
+
+	// Same order as GenericSession.METRICS
+	metrics[0] = (jlong) __sync_fetch_and_add(&session->calls, 0);
+	metrics[1] = (jlong) __sync_fetch_and_add(&session->bytes_read, 0);
+	metrics[2] = (jlong) __sync_fetch_and_add(&session->bytes_written, 0);
+	pthread_mutex_lock(&session->budget_lock);
+	metrics[3] = (jlong) session->buffer_waits;
+	metrics[4] = (jlong) (session->budget - session->available);
+	metrics[5] = (jlong) session->budget;
+	pthread_mutex_unlock(&session->budget_lock);
+	metrics[6] = (jlong) pool_threads(session->pool);
+	pthread_mutex_lock(&sessions_lock);
+	metrics[7] = (jlong) session->refs;
+	pthread_mutex_unlock(&sessions_lock);
+
+	array = (*env)->NewLongArray(env, 8);
+	if(array) (*env)->SetLongArrayRegion(env, array, 0, 8, metrics);
+
+	return array;
+}
+
+// [GenericFileSystem] FileStatus getFileStatus0(long session, Path path) throws IOException
+JNIEXPORT jobject JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getFileStatus0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	struct path_status status;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return NULL;
+
+	// Stat file or directory through Expand library
+	stat_path(session->fs, path, &status);
+	if(status.error) {
+		sprintf(err, "%s: %s", status.call, strerror(status.error));
+		if(status.error == ENOENT && !strcmp(status.call, "fs_stat")) (*env)->ThrowNew(env, FileNotFoundException, err);
+		else (*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+
+	return newFileStatus(env, &status, jpath, (*env)->GetLongField(env, obj, GenericFileSystem_blockSize));
+}
+
+// [GenericFileSystem] static FileStatus[] getFileStatuses0(long session, Path[] paths, int threads, long blockSize) throws IOException
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getFileStatuses0(JNIEnv *env, jclass cls, jlong jsession, jobjectArray jpaths, jint threads, jlong blockSize) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+	struct status_batch batch;
+	struct stat *bufs;
+	jobjectArray results = NULL;
+	jobject jpath, status;
+	const char *call = NULL;
+	jsize count, i;
+	int *errors, error = 0;
+
+	count = (*env)->GetArrayLength(env, jpaths);
+
+	// Translate every Hadoop path in a single crossing
+	batch.paths = translatePaths(env, session, jpaths, count);
+	batch.fs = session->fs;
+	batch.statuses = calloc(count ? count : 1, sizeof(struct path_status));
+	batch.bulk = 0;
+	bufs = calloc(count ? count : 1, sizeof(struct stat));
+	errors = calloc(count ? count : 1, sizeof(int));
+	if(!batch.paths || !batch.statuses || !bufs || !errors) {
+		freePaths(batch.paths, count);
+		free(batch.statuses);
+		free(bufs);
+		free(errors);
+		sprintf(err, "calloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+	for(i = 0; i < count; i++) {
+		if(!batch.paths[i]) {
+			batch.statuses[i].error = ENAMETOOLONG;
+			batch.statuses[i].call = "translatePath";
+		}
+	}
+
+	// Let the backend stat every path at once if it can
+	if(!fs_stat_batch(session->fs, (const char **) batch.paths, count, bufs, errors)) {
+		batch.bulk = 1;
+		for(i = 0; i < count; i++) {
+			if(!batch.paths[i]) continue;
+			batch.statuses[i].st = bufs[i];
+			batch.statuses[i].error = errors[i];
+			batch.statuses[i].call = "fs_stat_batch";
+		}
+	}
+	else if(errno != ENOSYS) {
+		error = errno;
+		call = "fs_stat_batch";
+	}
+	free(bufs);
+	free(errors);
+
+	// Stat (or complete) every path from several threads
+	if(!error) pool_run(session->pool, threads, count, stat_status, &batch);
 
-				// If file exists, but is not a directory, throw IOException
-				sprintf(err, "fs_mkdir: '%s' is a FILE", path);
-				(*env)->ThrowNew(env, IOException, err);
-				return JNI_FALSE;
-			}
-			else {
+	// Missing paths are reported as null, any other failure fails the batch
+	for(i = 0; !error && i < count; i++) {
+		if(batch.statuses[i].error && (batch.statuses[i].error != ENOENT || !strcmp(batch.statuses[i].call, "translatePath"))) {
+			error = batch.statuses[i].error;
+			call = batch.statuses[i].call;
+		}
+	}
+	if(error) {
+		sprintf(err, "%s: %s", call, strerror(error));
+		(*env)->ThrowNew(env, IOException, err);
+	}
+	else results = (*env)->NewObjectArray(env, count, FileStatus, NULL);
+	for(i = 0; results && i < count; i++) {
+		if(batch.statuses[i].error) continue;
+
+		jpath = (*env)->GetObjectArrayElement(env, jpaths, i);
+		status = newFileStatus(env, &batch.statuses[i], jpath, blockSize);
+		if(!status) results = NULL;
+		else (*env)->SetObjectArrayElement(env, results, i, status);
+
+		// Every reference is released before the next path
+		(*env)->DeleteLocalRef(env, status);
+		(*env)->DeleteLocalRef(env, jpath);
+	}
 
-				// If file doesn't exist, make directory
-				res = fs_mkdir(path, permission);
-				if(res < 0) {
-					if(errno == EEXIST) {
+	freePaths(batch.paths, count);
+	free(batch.statuses);
 
-						// If directory is already there, don't make it
-						*pointer = '/';
-						continue;
-					}
-					else {
-						sprintf(err, "fs_mkdir: %s", strerror(errno));
-						(*env)->ThrowNew(env, IOException, err);
-						return JNI_FALSE;
-					}
+	return results;
+}
+
+// [GenericFileSystem] FileStatus[] globStatus0(long session, Path pattern) throws IOException
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_globStatus0(JNIEnv *env, jobject obj, jlong jsession, jobject jpattern) {
+	struct session *session = getSession(jsession);
+	char pattern[PATH_MAX], err[ERR_MAX], **patterns = NULL, **paths = NULL;
+	struct stat_batch batch;
+	jobject jpathnouri, uri, jscheme, jauthority, jpath, status;
+	jobjectArray results = NULL;
+	jstring jchild;
+	size_t count = 0, size = 0, found, i, j;
+	int npatterns, k, wildcard = 0, error = 0;
+	const char *call = "parsePath";
+	jlong blockSize = 0;
+	jint threads = 1;
+
+	// Patterns are matched against Hadoop paths, each directory is translated
+	// right before it is read
+	jpathnouri = (*env)->CallStaticObjectMethod(env, Path, Path_getPathWithoutSchemeAndAuthority, jpattern);
+	uri = (*env)->CallObjectMethod(env, jpattern, Path_toUri);
+	jscheme = (*env)->CallObjectMethod(env, uri, URI_getScheme);
+	jauthority = (*env)->CallObjectMethod(env, uri, URI_getAuthority);
+	if(parsePath(env, jpathnouri, pattern)) {
+		sprintf(err, "%s: %s", call, strerror(ENAMETOOLONG));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+
+	// Braces spanning several components give several patterns
+	npatterns = glob_expand(pattern, &patterns);
+	if(npatterns < 0) {
+		sprintf(err, "glob_expand: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+	if(npatterns > 1) wildcard = 1;
+
+	// Walk the tree, listing only the directories wildcards apply to
+	threads = (*env)->GetIntField(env, obj, GenericFileSystem_threads);
+	for(k = 0; k < npatterns && !error; k++) {
+		if(glob_paths(session, patterns[k], threads, &paths, &count, &size, &wildcard, &call)) error = errno;
+	}
+	glob_free_all(patterns, npatterns);
+	if(error) {
+		sprintf(err, "%s: %s", call, strerror(error));
+		(*env)->ThrowNew(env, IOException, err);
+		free_children(paths, count);
+		return NULL;
+	}
+
+	// Alternatives may overlap, keep every path once
+	qsort(paths, count, sizeof(char *), compare_paths);
+	for(i = j = 0; i < count; i++) {
+		if(j && !strcmp(paths[j - 1], paths[i])) free(paths[i]);
+		else paths[j++] = paths[i];
+	}
+	count = j;
+
+	// Stat matches only, from several threads
+	blockSize = (*env)->GetLongField(env, obj, GenericFileSystem_blockSize);
+	batch.fs = session->fs;
+	batch.paths = paths;
+	batch.statuses = calloc(count ? count : 1, sizeof(struct path_status));
+	if(!batch.statuses) {
+		sprintf(err, "calloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		free_children(paths, count);
+		return NULL;
+	}
+	pool_run(session->pool, threads, count, stat_match, &batch);
+
+	// Paths removed meanwhile (or with a file in the way) do not match
+	for(i = found = 0; i < count; i++) {
+		error = batch.statuses[i].error;
+		if(!error) found++;
+		else if(error != ENOENT && error != ENOTDIR) {
+			sprintf(err, "%s: %s", batch.statuses[i].call, strerror(error));
+			(*env)->ThrowNew(env, IOException, err);
+			free_children(paths, count);
+			free(batch.statuses);
+			return NULL;
+		}
+	}
+
+	// A plain path that does not exist gives null, as in Hadoop
+	if(found || wildcard) results = (*env)->NewObjectArray(env, found, FileStatus, NULL);
+	for(i = j = 0; results && i < count; i++) {
+		if(batch.statuses[i].error) continue;
+
+		jchild = (*env)->NewStringUTF(env, paths[i]);
+		jpath = (*env)->NewObject(env, Path, Path_init2, jscheme, jauthority, jchild);
+		status = newFileStatus(env, &batch.statuses[i], jpath, blockSize);
+		if(!status) results = NULL;
+		else (*env)->SetObjectArrayElement(env, results, j++, status);
+
+		// Matches may be many, release references as they are stored
+		(*env)->DeleteLocalRef(env, status);
+		(*env)->DeleteLocalRef(env, jpath);
+		(*env)->DeleteLocalRef(env, jchild);
+	}
+
+	free_children(paths, count);
+	free(batch.statuses);
+
+	return results;
+}
+
+// [GenericFileSystem] ContentSummary getContentSummary0(long session, Path path) throws IOException
+JNIEXPORT jobject JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getContentSummary0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX], *root;
+	struct summary_walk walk;
+	struct summary total;
+	struct stat check;
+	jint threads = 1, i;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return NULL;
+
+	// Stat file or directory through Expand library
+	if(fs_stat(session->fs, path, &check) < 0) {
+		sprintf(err, "fs_stat: %s", strerror(errno));
+		(*env)->ThrowNew(env, errno == ENOENT ? FileNotFoundException : IOException, err);
+		return NULL;
+	}
+
+	// A file sums up to itself
+	if(!S_ISDIR(check.st_mode)) return (*env)->NewObject(env, ContentSummary, ContentSummary_init, (jlong) check.st_size, (jlong) 1, (jlong) 0);
+
+	// Walk subtree from several threads, adding up totals in C
+	threads = (*env)->GetIntField(env, obj, GenericFileSystem_threads);
+	if(threads < 1) threads = 1;
+	walk.fs = session->fs;
+	walk.totals = calloc(threads, sizeof(struct summary));
+	walk.error = 0;
+	walk.call = NULL;
+	root = strdup(path);
+	if(!walk.totals || !root) {
+		free(walk.totals);
+		free(root);
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+	pool_steal(session->pool, threads, root, summarize_directory, &walk);
+
+	// Directory itself counts as well
+	memset(&total, 0, sizeof(struct summary));
+	total.directories = 1;
+	for(i = 0; i < threads; i++) {
+		total.length += walk.totals[i].length;
+		total.files += walk.totals[i].files;
+		total.directories += walk.totals[i].directories;
+	}
+	free(walk.totals);
+
+	if(walk.error) {
+		sprintf(err, "%s: %s", walk.call, strerror(walk.error));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+
+	return (*env)->NewObject(env, ContentSummary, ContentSummary_init, total.length, total.files, total.directories);
+}
+
+// [GenericFileSystem] long copyToLocal0(long session, Path src, String dst, long stripeSize) throws IOException
+JNIEXPORT jlong JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_copyToLocal0(JNIEnv *env, jobject obj, jlong jsession, jobject jsrc, jstring jdst, jlong stripeSize) {
+	struct session *session = getSession(jsession);
+	char src[PATH_MAX], dst[PATH_MAX], err[ERR_MAX];
+	struct copy_batch batch;
+	struct stat check;
+	off_t *ranges = NULL, stripe, start;
+	ssize_t count;
+	size_t stripes, i;
+	jint threads = 1;
+
+	// Translate Hadoop path to filesystem path, destination is a local path
+	if(translatePath(env, session, jsrc, src)) return -1;
+	if(parseString(env, jdst, dst, PATH_MAX)) {
+		sprintf(err, "parseString: %s", strerror(ENAMETOOLONG));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
+
+	// Open source through Expand library and learn its length
+	batch.src = fs_open(session->fs, src, O_RDONLY);
+	if(batch.src < 0) {
+		sprintf(err, "fs_open: %s", strerror(errno));
+		(*env)->ThrowNew(env, FileNotFoundException, err);
+		return -1;
+	}
+	if(fs_fstat(session->fs, batch.src, &check) < 0) {
+		sprintf(err, "fs_fstat: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		fs_close(session->fs, batch.src);
+		return -1;
+	}
+
+	// Local file gets its final length up front, so stripes land in place
+	batch.dst = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(batch.dst < 0 || ftruncate(batch.dst, check.st_size) < 0) {
+		sprintf(err, "%s: %s", batch.dst < 0 ? "open" : "ftruncate", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		if(batch.dst >= 0) close(batch.dst);
+		fs_close(session->fs, batch.src);
+		return -1;
+	}
+
+	// Only data is copied: holes of the source stay holes of the local file,
+	// which already has its length
+	batch.session = session;
+	batch.length = check.st_size;
+	batch.error = 0;
+	batch.call = NULL;
+	batch.stripes = NULL;
+	count = data_ranges(session->fs, batch.src, batch.length, &ranges, &batch.call);
+	if(count < 0) batch.error = errno;
+	else {
+
+		// Every range is cut into stripes
+		stripe = stripeSize > 0 ? stripeSize : IO_BUFFER_SIZE;
+		for(i = 0, stripes = 0; i < (size_t) count; i++) stripes += (size_t) ((ranges[2 * i + 1] + stripe - 1) / stripe);
+		batch.stripes = malloc((stripes ? stripes : 1) * 2 * sizeof(off_t));
+		if(!batch.stripes) {
+			batch.error = ENOMEM;
+			batch.call = "malloc";
+		}
+		else {
+			for(i = 0, stripes = 0; i < (size_t) count; i++) {
+				for(start = ranges[2 * i]; start < ranges[2 * i] + ranges[2 * i + 1]; start += stripe) {
+					batch.stripes[2 * stripes] = start;
+					batch.stripes[2 * stripes + 1] = ranges[2 * i] + ranges[2 * i + 1] - start > stripe ? start + stripe : ranges[2 * i] + ranges[2 * i + 1];
+					stripes++;
 				}
 			}
 
-			// Turn '\0' back to '/' so that processing can continue
-			*pointer = '/';
+			// Copy stripes from several threads
+			threads = (*env)->GetIntField(env, obj, GenericFileSystem_threads);
+			pool_run(session->pool, threads, stripes, copy_stripe, &batch);
 		}
+		free(ranges);
 	}
+	free(batch.stripes);
 
-	// Get file stats for last entry
-	res = fs_stat(path, &check);
+	fs_close(session->fs, batch.src);
+	if(close(batch.dst) < 0 && !batch.error) {
+		batch.error = errno;
+		batch.call = "close";
+	}
+	if(batch.error) {
+		sprintf(err, "%s: %s", batch.call, strerror(batch.error));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
 
-	if(res == 0 && S_ISDIR(check.st_mode)) {
+	return (jlong) batch.length;
+}
 
-		// If file exists, and it is a directory, don't make it (we're done)
-		return JNI_TRUE;
+// [GenericFileSystem] static long[] getDataRanges0(long session, Path path) throws IOException
+JNIEXPORT jlongArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getDataRanges0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	struct stat check;
+	const char *call = NULL;
+	off_t *ranges = NULL;
+	ssize_t count;
+	jlong *pairs;
+	jlongArray array;
+	ssize_t i;
+	int fd, error;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return NULL;
+
+	// Open file through Expand library and learn its length
+	fd = fs_open(session->fs, path, O_RDONLY);
+	if(fd < 0) {
+		sprintf(err, "fs_open: %s", strerror(errno));
+		(*env)->ThrowNew(env, FileNotFoundException, err);
+		return NULL;
+	}
+	if(fs_fstat(session->fs, fd, &check) < 0) {
+		sprintf(err, "fs_fstat: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		fs_close(session->fs, fd);
+		return NULL;
+	}
+	if(S_ISDIR(check.st_mode)) {
+		sprintf(err, "fs_fstat: %s", strerror(EISDIR));
+		(*env)->ThrowNew(env, FileNotFoundException, err);
+		fs_close(session->fs, fd);
+		return NULL;
 	}
-	else if(res == 0) {
 
-		// If file exists, but is not a directory, throw IOException
-		sprintf(err, "fs_mkdir: '%s' is a FILE", path);
+	// Walk data and holes from the start (closing must not clobber its error)
+	count = data_ranges(session->fs, fd, check.st_size, &ranges, &call);
+	error = errno;
+	fs_close(session->fs, fd);
+	if(count < 0) {
+		sprintf(err, "%s: %s", call, strerror(error));
 		(*env)->ThrowNew(env, IOException, err);
-		return JNI_FALSE;
+		return NULL;
 	}
-	else {
 
-		// Make last directory entry through Expand library (full path)
-		if(fs_mkdir(path, permission)) {
-			sprintf(err, "fs_mkdir: %s", strerror(errno));
+	// Offsets and lengths go back as a flat array of pairs
+	array = (*env)->NewLongArray(env, (jsize) (2 * count));
+	if(array && count > 0) {
+		pairs = malloc(2 * count * sizeof(jlong));
+		if(!pairs) {
+			sprintf(err, "malloc: %s", strerror(ENOMEM));
 			(*env)->ThrowNew(env, IOException, err);
-			return JNI_FALSE;
+			free(ranges);
+			return NULL;
 		}
-		return JNI_TRUE;
+		for(i = 0; i < 2 * count; i++) pairs[i] = (jlong) ranges[i];
+		(*env)->SetLongArrayRegion(env, array, 0, (jsize) (2 * count), pairs);
+		free(pairs);
+	}
+	free(ranges);
+
+	return array;
+}
+
+// [GenericFileSystem] boolean mkdirs0(long session, Path path) throws IOException
+JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_mkdirs0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jshort permission) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return JNI_FALSE;
+
+	// Make every missing directory through Expand library
+	if(make_directories(session->fs, path, permission, err)) {
+		(*env)->ThrowNew(env, IOException, err);
+		return JNI_FALSE;
 	}
+
+	return JNI_TRUE;
 }
 
-// [GenericFileSystem] boolean rename0(Path src, Path dst) throws IOException
-JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_rename0(JNIEnv *env, jobject obj, jobject jsrc, jobject jdst) {
+// [GenericFileSystem] boolean rename0(long session, Path src, Path dst) throws IOException
+JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_rename0(JNIEnv *env, jobject obj, jlong jsession, jobject jsrc, jobject jdst) {
+	struct session *session = getSession(jsession);
 	char src[PATH_MAX], dst[PATH_MAX], err[ERR_MAX];
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jsrc, src)) return JNI_FALSE;
+	if(translatePath(env, session, jsrc, src)) return JNI_FALSE;
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jdst, dst)) return JNI_FALSE;
+	if(translatePath(env, session, jdst, dst)) return JNI_FALSE;
 
 	// Rename *source* file or directory to *destination* through Expand library
-	if(fs_rename(src, dst)) {
+	if(fs_rename(session->fs, src, dst)) {
 		if(errno == EEXIST) {
 			sprintf(err, "fs_rename: %s", strerror(errno));
 			(*env)->ThrowNew(env, FileAlreadyExistsException, err);
@@ -636,17 +2308,18 @@ JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFi
 	return JNI_TRUE;
 }
 
-// [GenericFileSystem] boolean delete0(Path path, boolean recursive) throws IOException
-JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_delete0(JNIEnv *env, jobject obj, jobject jpath, jboolean recursive) {
+// [GenericFileSystem] boolean delete0(long session, Path path, boolean recursive) throws IOException
+JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_delete0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jboolean recursive) {
+	struct session *session = getSession(jsession);
 	char path[PATH_MAX], err[ERR_MAX], *pointer;
 	struct stat check;
 	jsize length;
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return JNI_FALSE;
+	if(translatePath(env, session, jpath, path)) return JNI_FALSE;
 
 	// Get file stats
-	if(fs_stat(path, &check)) {
+	if(fs_stat(session->fs, path, &check)) {
 			sprintf(err, "fs_stat: %s", strerror(errno));
 			(*env)->ThrowNew(env, IOException, err);
 			return JNI_FALSE;
@@ -659,7 +2332,7 @@ JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFi
 		if(recursive) {
 
 			// Run recursive removal function
-			if(remove_directory(path)) {
+			if(remove_directory(session->fs, path)) {
 				sprintf(err, "remove_directory: recursive operation failed");
 				(*env)->ThrowNew(env, IOException, err);
 				return JNI_FALSE;
@@ -671,7 +2344,7 @@ JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFi
 		else {
 
 			// Remove directory through Expand library
-			if(fs_rmdir(path)) {
+			if(fs_rmdir(session->fs, path)) {
 				if(errno == ENOENT) {
 					sprintf(err, "fs_rmdir: %s", strerror(errno));
 					(*env)->ThrowNew(env, FileNotFoundException, err);
@@ -689,7 +2362,7 @@ JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFi
 	else {
 
 		// Unlink file through Expand library (if file, recursive flag ignored)
-		if(fs_unlink(path)) {
+		if(fs_unlink(session->fs, path)) {
 			if(errno == ENOENT) {
 				sprintf(err, "fs_unlink: %s", strerror(errno));
 				(*env)->ThrowNew(env, FileNotFoundException, err);
@@ -705,15 +2378,216 @@ JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFi
 	}
 }
 
-// [GenericFileSystem] void setPermission0(Path f, short permission) throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_setPermission0(JNIEnv *env, jobject obj, jobject jpath, jshort permission) {
+// [GenericFileSystem] IOException[] deleteBatch0(long session, Path[] paths, boolean recursive)
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_deleteBatch0(JNIEnv *env, jobject obj, jlong jsession, jobjectArray jpaths, jboolean recursive) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+	struct delete_batch batch;
+	jobjectArray results;
+	jsize count, i;
+	jint threads = 1;
+
+	count = (*env)->GetArrayLength(env, jpaths);
+
+	// Translate every Hadoop path in a single crossing
+	batch.fs = session->fs;
+	batch.paths = translatePaths(env, session, jpaths, count);
+	batch.errors = calloc(count ? count : 1, sizeof(int));
+	batch.calls = calloc(count ? count : 1, sizeof(char *));
+	batch.recursive = recursive;
+	batch.bulk = 0;
+	if(!batch.paths || !batch.errors || !batch.calls) {
+		freePaths(batch.paths, count);
+		free(batch.errors);
+		free(batch.calls);
+		sprintf(err, "calloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+	for(i = 0; i < count; i++) {
+		if(!batch.paths[i]) {
+			batch.errors[i] = ENAMETOOLONG;
+			batch.calls[i] = "translatePath";
+		}
+	}
+
+	// Let the backend remove every file at once if it can
+	if(!fs_unlink_batch(session->fs, (const char **) batch.paths, count, batch.errors)) batch.bulk = 1;
+	else if(errno != ENOSYS) {
+		sprintf(err, "fs_unlink_batch: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		freePaths(batch.paths, count);
+		free(batch.errors);
+		free(batch.calls);
+		return NULL;
+	}
+
+	// Unlink files (or handle directories) from several threads
+	threads = (*env)->GetIntField(env, obj, GenericFileSystem_threads);
+	pool_run(session->pool, threads, count, delete_path, &batch);
+
+	// Report every failure next to its path
+	results = (*env)->NewObjectArray(env, count, IOException, NULL);
+	for(i = 0; results && i < count; i++) {
+		jobject exception;
+
+		if(!batch.errors[i]) continue;
+		exception = newException(env, batch.calls[i], batch.errors[i]);
+		(*env)->SetObjectArrayElement(env, results, i, exception);
+		(*env)->DeleteLocalRef(env, exception);
+	}
+
+	freePaths(batch.paths, count);
+	free(batch.errors);
+	free(batch.calls);
+
+	return results;
+}
+
+// [GenericFileSystem] IOException[] renameBatch0(long session, Path[] srcs, Path[] dsts)
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_renameBatch0(JNIEnv *env, jobject obj, jlong jsession, jobjectArray jsrcs, jobjectArray jdsts) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+	struct rename_batch batch;
+	jobjectArray results;
+	jsize count, i;
+	jint threads = 1;
+
+	count = (*env)->GetArrayLength(env, jsrcs);
+
+	// Translate every Hadoop path in a single crossing
+	batch.fs = session->fs;
+	batch.srcs = translatePaths(env, session, jsrcs, count);
+	batch.dsts = translatePaths(env, session, jdsts, count);
+	batch.errors = calloc(count ? count : 1, sizeof(int));
+	if(!batch.srcs || !batch.dsts || !batch.errors) {
+		freePaths(batch.srcs, count);
+		freePaths(batch.dsts, count);
+		free(batch.errors);
+		sprintf(err, "calloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+	for(i = 0; i < count; i++) {
+		if(!batch.srcs[i] || !batch.dsts[i]) batch.errors[i] = ENAMETOOLONG;
+	}
+
+	// Rename every entry from several threads
+	threads = (*env)->GetIntField(env, obj, GenericFileSystem_threads);
+	pool_run(session->pool, threads, count, rename_path, &batch);
+
+	// Report every failure next to its path
+	results = (*env)->NewObjectArray(env, count, IOException, NULL);
+	for(i = 0; results && i < count; i++) {
+		jobject exception;
+
+		if(!batch.errors[i]) continue;
+		exception = newException(env, batch.srcs[i] && batch.dsts[i] ? "fs_rename" : "translatePath", batch.errors[i]);
+		(*env)->SetObjectArrayElement(env, results, i, exception);
+		(*env)->DeleteLocalRef(env, exception);
+	}
+
+	freePaths(batch.srcs, count);
+	freePaths(batch.dsts, count);
+	free(batch.errors);
+
+	return results;
+}
+
+// [GenericFileSystem] void writeFile0(long session, Path path, byte[] b, ByteBuffer direct, int off, int len, boolean create, boolean overwrite, boolean append, short permission, short dirPermission) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_writeFile0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jbyteArray jbuffer, jobject jdirect, jint off, jint len, jboolean create, jboolean overwrite, jboolean append, jshort permission, jshort dirPermission) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	const char *call = NULL;
+	jbyte *buffer = NULL;
+	int flags, error;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return;
+
+	// Adjust open flags as per create, overwrite and append
+	if(append) flags = O_APPEND | (create ? O_CREAT : 0);
+	else if(overwrite) flags = O_TRUNC | O_CREAT;
+	else flags = O_EXCL | O_CREAT;
+
+	// Access contents without copying direct buffers
+	if(jdirect) buffer = (jbyte *) (*env)->GetDirectBufferAddress(env, jdirect);
+	else buffer = (*env)->GetByteArrayElements(env, jbuffer, NULL);
+	if(!buffer) {
+		(*env)->ThrowNew(env, IOException, "writeFile0: cannot access buffer");
+		return;
+	}
+
+	// Create parents (if needed), open, write and close in one crossing
+	error = put_file(session->fs, path, buffer + off, len, flags, permission, dirPermission, &call);
+	if(!jdirect) (*env)->ReleaseByteArrayElements(env, jbuffer, buffer, JNI_ABORT);
+	if(error) {
+		sprintf(err, "%s: %s", call, strerror(error));
+		if(error == EEXIST && !overwrite && !append) (*env)->ThrowNew(env, FileAlreadyExistsException, err);
+		else if(error == ENOENT) (*env)->ThrowNew(env, FileNotFoundException, err);
+		else (*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+	__sync_fetch_and_add(&session->bytes_written, (long long) len);
+
+	return;
+}
+
+// [GenericFileSystem] byte[] readFile0(long session, Path path, int maxLen) throws IOException
+JNIEXPORT jbyteArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_readFile0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jint maxLen) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	const char *call = NULL;
+	jbyteArray result;
+	jbyte *buffer;
+	ssize_t res;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return NULL;
+
+	// One extra byte tells files larger than maxLen apart
+	buffer = session_alloc(session, (size_t) maxLen + 1);
+	if(!buffer) {
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+
+	// Open, read and close in one crossing
+	res = get_file(session->fs, path, buffer, (size_t) maxLen + 1, &call);
+	if(res < 0) {
+		sprintf(err, "%s: %s", call, strerror(errno));
+		if(errno == ENOENT) (*env)->ThrowNew(env, FileNotFoundException, err);
+		else (*env)->ThrowNew(env, IOException, err);
+		session_free(session, buffer, (size_t) maxLen + 1);
+		return NULL;
+	}
+	if(res > maxLen) {
+		sprintf(err, "readFile: file is larger than %d bytes", maxLen);
+		(*env)->ThrowNew(env, IOException, err);
+		session_free(session, buffer, (size_t) maxLen + 1);
+		return NULL;
+	}
+
+	// Copy contents to a new byte array
+	__sync_fetch_and_add(&session->bytes_read, (long long) res);
+	result = (*env)->NewByteArray(env, (jsize) res);
+	if(result) (*env)->SetByteArrayRegion(env, result, 0, (jsize) res, buffer);
+	session_free(session, buffer, (size_t) maxLen + 1);
+
+	return result;
+}
+
+// [GenericFileSystem] void setPermission0(long session, Path f, short permission) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_setPermission0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jshort permission) {
+	struct session *session = getSession(jsession);
 	char path[PATH_MAX], err[ERR_MAX];
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return;
+	if(translatePath(env, session, jpath, path)) return;
 
 	// Change permission through Expand library
-	if(fs_chmod(path, permission)) {
+	if(fs_chmod(session->fs, path, permission)) {
 		sprintf(err, "fs_chmod: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
 		return;
@@ -722,8 +2596,9 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSy
 	return;
 }
 
-// [GenericFileSystem] void setOwner0(Path path, String username, String groupname) throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_setOwner0(JNIEnv *env, jobject obj, jobject jpath, jstring username, jstring groupname) {
+// [GenericFileSystem] void setOwner0(long session, Path path, String username, String groupname) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_setOwner0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jstring username, jstring groupname) {
+	struct session *session = getSession(jsession);
 	char path[PATH_MAX], owner[USERNAME_MAX], group[GROUPNAME_MAX], err[ERR_MAX];
 	struct passwd *pwd;
 	struct group *grp;
@@ -731,7 +2606,7 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSy
 	gid_t gid;
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return;
+	if(translatePath(env, session, jpath, path)) return;
 
 	// If username is null, then nothing shall be changed
 	if(username != NULL) {
@@ -782,7 +2657,7 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSy
 	else gid = -1;
 
 	// Change ownership through Expand library
-	if(fs_chown(path, uid, gid)) {
+	if(fs_chown(session->fs, path, uid, gid)) {
 		sprintf(err, "fs_chown: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
 		return;
@@ -791,15 +2666,17 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSy
 	return;
 }
 
-// [GenericFileSystem] BlockLocation[] getFileBlockLocations0(FileStatus file, long start, long len) throws IOException
-JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getFileBlockLocations0(JNIEnv *env, jobject obj, jobject file, jlong start, jlong len) {
+// [GenericFileSystem] BlockLocation[] getFileBlockLocations0(long session, FileStatus file, long start, long len) throws IOException
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getFileBlockLocations0(JNIEnv *env, jobject obj, jlong jsession, jobject file, jlong start, jlong len) {
+	struct session *session = getSession(jsession);
+	struct host_table hosts = {0};
 	char path[PATH_MAX], err[ERR_MAX];
 	char*** urls;
-	jlong tlen = 0, blksize = 0, nblks = 0, i = 0, fblk = 0, lblk = 0, tblks = 0, z = 0;
-	jshort replication = 0, j = 0;
+	jlong tlen = 0, blksize = 0, end = 0, fblk = 0, lblk = 0, tblks = 0;
+	jshort replication = 0;
 	jobject jpath;
 	jobjectArray blockLocations;
-	jboolean isFile = JNI_FALSE, isDir = JNI_FALSE;
+	jboolean isFile = JNI_FALSE;
 
 	// Retrieve all useful data from file object.
 	jpath = (*env)->CallObjectMethod(env, file, FileStatus_getPath);
@@ -807,196 +2684,569 @@ JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_Gener
 	blksize = (*env)->CallLongMethod(env, file, FileStatus_getBlockSize);
 	replication = (*env)->CallShortMethod(env, file, FileStatus_getReplication);
 	isFile = (*env)->CallBooleanMethod(env, file, FileStatus_isFile);
-	isDir = (*env)->CallBooleanMethod(env, file, FileStatus_isDirectory);
+
+	// Calculate requested range, clamped to the file length
+	end = len > tlen - start ? tlen : start + len;
+
+	// Directories, empty ranges and files without blocks have no locations
+	if(!isFile || blksize <= 0 || start >= end) return (*env)->NewObjectArray(env, 0, BlockLocation, NULL);
+	if(replication < 0) replication = 0;
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return JNI_FALSE;
+	if(translatePath(env, session, jpath, path)) return NULL;
 
-		// Calculate first block (floor)
+	// Calculate first block overlapping the range (floor)
 	fblk = start / blksize;
 
-	// Calculate last block (ceil)
-	lblk = tlen / blksize + (tlen % blksize != 0);
-
-	// Calculate number of blocks to locate
-	nblks = lblk - fblk;
+	// Calculate block after the last one overlapping the range (ceil)
+	lblk = end / blksize + (end % blksize != 0);
 
 	// Calculate total number of blocks in file (ceil)
-	tblks = len / blksize + (len % blksize != 0);
+	tblks = tlen / blksize + (tlen % blksize != 0);
+
+	// Allocate memory for all blocks, as fs_locate fills the whole file
+	urls = alloc_urls(tblks, replication);
+	if(!urls) {
+		sprintf(err, "malloc: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return NULL;
+	}
+
+	// Retrieve URLs through Expand library
+	if(replication > 0 && fs_locate(session->fs, path, blksize, urls)) {
+		sprintf(err, "fs_locate: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		free_urls(urls, tblks, replication);
+		return NULL;
+	}
+
+	// Group blocks stored on the same hosts (each host is parsed once)
+	blockLocations = newBlockLocations(env, urls, replication, blksize, tlen, fblk, lblk, &hosts);
+
+	// Free resources
+	free_hosts(env, &hosts);
+	free_urls(urls, tblks, replication);
+
+	return blockLocations;
+}
+
+// [GenericFileSystem] int getFileChecksum0(long session, Path path, long length, long blockSize) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericFileSystem_getFileChecksum0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath, jlong length, jlong blockSize) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	struct checksum_block *blocks;
+	jlong nblks = 0, i = 0;
+	jint threads = 1;
+	uint32_t crc = ~0U;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return 0;
+
+	// Calculate number of blocks (ceil)
+	nblks = length / blockSize + (length % blockSize != 0);
+
+	// Describe every block
+	blocks = calloc(nblks ? nblks : 1, sizeof(struct checksum_block));
+	if(!blocks) {
+		sprintf(err, "calloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return 0;
+	}
+	for(i = 0; i < nblks; i++) {
+		blocks[i].session = session;
+		blocks[i].path = path;
+		blocks[i].offset = i * blockSize;
+		blocks[i].length = i < nblks - 1 ? blockSize : length - i * blockSize;
+	}
+
+	// Checksum blocks in parallel
+	threads = (*env)->GetIntField(env, obj, GenericFileSystem_threads);
+	pool_run(session->pool, threads, nblks, checksum_block, blocks);
+
+	// Compose block CRCs in file order
+	for(i = 0; i < nblks; i++) {
+		if(blocks[i].error) {
+			sprintf(err, "%s: %s", blocks[i].call, strerror(blocks[i].error));
+			(*env)->ThrowNew(env, IOException, err);
+			free(blocks);
+			return 0;
+		}
+		crc = crc32c_shift(crc, blocks[i].length) ^ blocks[i].crc;
+	}
+	free(blocks);
+
+	return (jint) ~crc;
+}
+
+// [GenericMetadataCache] static int watch0(long session, Path path) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericMetadataCache_watch0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	int watch;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return -1;
+
+	// Subscribe to changes through Expand library (backends may not notify)
+	watch = fs_watch(session->fs, path);
+	if(watch < 0) {
+		if(errno == ENOSYS) return -1;
+		sprintf(err, "fs_watch: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
+
+	return (jint) watch;
+}
+
+// [GenericMetadataCache] static void unwatch0(long session, int watch) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericMetadataCache_unwatch0(JNIEnv *env, jclass cls, jlong jsession, jint watch) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+
+	// Unsubscribe through Expand library
+	if(fs_unwatch(session->fs, watch)) {
+		sprintf(err, "fs_unwatch: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+}
+
+// [GenericMetadataCache] static int nextEvents0(long session, int[] watches, String[] names, int timeout) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericMetadataCache_nextEvents0(JNIEnv *env, jclass cls, jlong jsession, jintArray jwatches, jobjectArray jnames, jint timeout) {
+	struct session *session = getSession(jsession);
+	struct fs_event *events;
+	char err[ERR_MAX];
+	jstring jname;
+	jint *watches;
+	int count, i;
+
+	count = (int) (*env)->GetArrayLength(env, jwatches);
+	events = malloc(count * sizeof(struct fs_event));
+	watches = malloc(count * sizeof(jint));
+	if(!events || !watches) {
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		free(events);
+		free(watches);
+		return -1;
+	}
+
+	// Wait for changes through Expand library (lost ones are reported as -1)
+	count = fs_events(session->fs, events, count, timeout);
+	if(count < 0) {
+		if(errno != EOVERFLOW) {
+			sprintf(err, "fs_events: %s", strerror(errno));
+			(*env)->ThrowNew(env, IOException, err);
+		}
+		free(events);
+		free(watches);
+		return -1;
+	}
+
+	// Changes go back as a watch and an entry name each
+	for(i = 0; i < count; i++) {
+		watches[i] = (jint) events[i].watch;
+		jname = (*env)->NewStringUTF(env, events[i].name);
+		if(!jname) {
+			free(events);
+			free(watches);
+			return -1;
+		}
+		(*env)->SetObjectArrayElement(env, jnames, i, jname);
+		(*env)->DeleteLocalRef(env, jname);
+	}
+	(*env)->SetIntArrayRegion(env, jwatches, 0, count, watches);
+	free(events);
+	free(watches);
 
-	// Allocate memory for all blocks
-	urls = malloc(nblks * sizeof(char**));
+	return (jint) count;
+}
 
-	for(i = 0; i < tblks; i++) {
+// #### ##    ## ########  ##     ## ########
+//  ##  ###   ## ##     ## ##     ##    ##
+//  ##  ####  ## ##     ## ##     ##    ##
+//  ##  ## ## ## ########  ##     ##    ##
+//  ##  ##  #### ##        ##     ##    ##
+//  ##  ##   ### ##        ##     ##    ##
+// #### ##    ## ##         #######     ##
 
-		// Allocate memory for all replicas of this block
-		urls[i] = malloc(replication * sizeof(char*));
+// [GenericStatusIterator] static long openCursor0(long session, Path path) throws IOException
+JNIEXPORT jlong JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericStatusIterator_openCursor0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	struct cursor *cursor;
+	DIR *dp;
 
-		for(j = 0; j < replication; j++) {
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return 0;
 
-			// Allocate memory for the URL storing this replica of the block
-			urls[i][j] = malloc(HOST_NAME_MAX * sizeof(char));
-		}
+	// Open directory through Expand library (files have nothing to list)
+	dp = fs_opendir(session->fs, path);
+	if(!dp) {
+		if(errno == ENOTDIR) return 0;
+		sprintf(err, "fs_opendir: %s", strerror(errno));
+		(*env)->ThrowNew(env, errno == ENOENT ? FileNotFoundException : IOException, err);
+		return 0;
 	}
 
-	// Retrieve URLs through Expand library
-	if(fs_locate(path, urls)) {
-		sprintf(err, "fs_locate: %s", strerror(errno));
+	// Directory stays open until the cursor is closed
+	cursor = malloc(sizeof(struct cursor));
+	if(!cursor) {
+		fs_closedir(session->fs, dp);
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
 		(*env)->ThrowNew(env, IOException, err);
-		return NULL;
+		return 0;
 	}
+	cursor->dp = dp;
+	strcpy(cursor->path, path);
+	memset(&cursor->hosts, 0, sizeof(struct host_table));
 
-	// Prepare block locations array
-	blockLocations = (*env)->NewObjectArray(env, nblks, BlockLocation, NULL);
-
-	// Set block locations array using Expand library results
-	for(i = fblk; i < lblk; i++) {
-		char split[HOST_NAME_MAX];
-		jobjectArray names, hosts;
-		jlong offset, length;
-		jobject blockLocation;
+	// Listing may outlive the FileSystem instance it was opened through
+	cursor->session = session;
+	session_retain(session);
 
-		// Prepare name array
-		names = (*env)->NewObjectArray(env, replication, String, NULL);
+	return (jlong) (intptr_t) cursor;
+}
 
-		// Prepare host array
-		hosts = (*env)->NewObjectArray(env, replication, String, NULL);
+// Reads and stats the next page of a cursor, locating its files if asked to
+// RETURNS NULL at the end of the listing or if error (Java exception pending),
+// or the FileStatus (or LocatedFileStatus) array
+jobjectArray nextPage(JNIEnv *env, struct cursor *cursor, jobject jpath, jint size, jint threads, jlong blockSize, int locate) {
+	char err[ERR_MAX], **names;
+	struct page_batch batch;
+	struct file_blocks *blocks;
+	struct dirent *ent;
+	jobjectArray results = NULL, locations;
+	jobject jchild, status, located;
+	jstring jname;
+	jsize count = 0, found, i, j;
+	const char *call = "calloc";
+	int error = 0;
+
+	names = calloc(size, sizeof(char *));
+	batch.paths = calloc(size, sizeof(char *));
+	batch.statuses = calloc(size, sizeof(struct path_status));
+	batch.blocks = locate ? calloc(size, sizeof(struct file_blocks)) : NULL;
+	batch.blockSize = blockSize;
+	batch.fs = cursor->session->fs;
+	if(!names || !batch.paths || !batch.statuses || (locate && !batch.blocks)) error = ENOMEM;
+
+	// Read up to a page of entries through Expand library (the end of the
+	// directory leaves errno alone, a failed read sets it)
+	while(!error && count < size) {
+		errno = 0;
+		if(!(ent = fs_readdir(cursor->session->fs, cursor->dp))) {
+			if(errno) {
+				error = errno;
+				call = "fs_readdir";
+			}
+			break;
+		}
+		if(!strcmp(".", ent->d_name) || !strcmp("..", ent->d_name)) continue;
+		names[count] = strdup(ent->d_name);
+		batch.paths[count] = join_path(cursor->path, ent->d_name);
+		if(!names[count] || !batch.paths[count]) {
+			error = errno;
+			call = "fs_readdir";
+		}
+		count++;
+	}
 
-		// Set names and hosts using Expand library results
-		for(j = 0; j < replication; j++) {
-			char debug[HOST_NAME_MAX];
-			jstring name, host;
-			jobject uri;
+	// Stat (and locate) the whole page from several threads
+	if(!error) pool_run(cursor->session->pool, threads, count, stat_child, &batch);
 
-			// Parse to URI
-			uri = (*env)->NewObject(env, URI, URI_init, (*env)->NewStringUTF(env, urls[i][j]));
+	// Entries removed meanwhile are skipped
+	for(i = found = 0; !error && i < count; i++) {
+		if(!batch.statuses[i].error) found++;
+		else if(batch.statuses[i].error != ENOENT) {
+			error = batch.statuses[i].error;
+			call = batch.statuses[i].call;
+		}
+	}
+	if(error) {
+		sprintf(err, "%s: %s", call, strerror(error));
+		(*env)->ThrowNew(env, IOException, err);
+	}
 
-			// Get authority from URI
-			name = (*env)->CallObjectMethod(env, uri, URI_getAuthority);
+	// Null marks the end of the listing (a page may be empty if its entries are gone)
+	else if(count > 0) results = (*env)->NewObjectArray(env, found, locate ? LocatedFileStatus : FileStatus, NULL);
+	for(i = j = 0; results && i < count; i++) {
+		if(batch.statuses[i].error) continue;
+
+		jname = (*env)->NewStringUTF(env, names[i]);
+		jchild = (*env)->NewObject(env, Path, Path_init1, jpath, jname);
+		status = newFileStatus(env, &batch.statuses[i], jchild, blockSize);
+		located = locations = NULL;
+		if(status && locate) {
+
+			// Files get an array even without blocks, directories none
+			blocks = &batch.blocks[i];
+			if(!S_ISREG(batch.statuses[i].st.st_mode)) locations = NULL;
+			else if(!blocks->urls) locations = (*env)->NewObjectArray(env, 0, BlockLocation, NULL);
+			else locations = newBlockLocations(env, blocks->urls, blocks->replication, blocks->blksize, (jlong) batch.statuses[i].st.st_size, 0, blocks->nblks, &cursor->hosts);
+			if(!(*env)->ExceptionCheck(env)) located = (*env)->NewObject(env, LocatedFileStatus, LocatedFileStatus_init, status, locations);
+		}
+		if(!status || (locate && !located)) results = NULL;
+		else (*env)->SetObjectArrayElement(env, results, j++, locate ? located : status);
+
+		// Every reference of a page is released before the next one
+		(*env)->DeleteLocalRef(env, located);
+		(*env)->DeleteLocalRef(env, locations);
+		(*env)->DeleteLocalRef(env, status);
+		(*env)->DeleteLocalRef(env, jchild);
+		(*env)->DeleteLocalRef(env, jname);
+	}
 
-			// Get host from URI
-			host = (*env)->CallObjectMethod(env, uri, URI_getHost);
+	for(i = 0; i < count; i++) {
+		free(names[i]);
+		free(batch.paths[i]);
+		if(batch.blocks) free_urls(batch.blocks[i].urls, batch.blocks[i].nblks, batch.blocks[i].replication);
+	}
+	free(names);
+	free(batch.paths);
+	free(batch.statuses);
+	free(batch.blocks);
 
-			// Add name to array
-			(*env)->SetObjectArrayElement(env, names, j, name);
+	return results;
+}
 
-			// Add host to array
-			(*env)->SetObjectArrayElement(env, hosts, j, host);
-		}
+// [GenericStatusIterator] static FileStatus[] nextPage0(long cursor, Path path, int size, int threads, long blockSize) throws IOException
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericStatusIterator_nextPage0(JNIEnv *env, jclass cls, jlong jcursor, jobject jpath, jint size, jint threads, jlong blockSize) {
+	return nextPage(env, (struct cursor *) (intptr_t) jcursor, jpath, size, threads, blockSize, 0);
+}
 
-		// Calculate offset from file start
-		offset = i * blksize;
+// [GenericStatusIterator] static FileStatus[] nextLocatedPage0(long cursor, Path path, int size, int threads, long blockSize) throws IOException
+JNIEXPORT jobjectArray JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericStatusIterator_nextLocatedPage0(JNIEnv *env, jclass cls, jlong jcursor, jobject jpath, jint size, jint threads, jlong blockSize) {
+	return nextPage(env, (struct cursor *) (intptr_t) jcursor, jpath, size, threads, blockSize, 1);
+}
 
-		// Calculate length of block
-		length = blksize;
+// [GenericStatusIterator] static void closeCursor0(long cursor) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_GenericStatusIterator_closeCursor0(JNIEnv *env, jclass cls, jlong jcursor) {
+	struct cursor *cursor = (struct cursor *) (intptr_t) jcursor;
+	char err[ERR_MAX];
+	int res, error;
+
+	// Close directory through Expand library
+	res = fs_closedir(cursor->session->fs, cursor->dp);
+	error = errno;
+	session_release(cursor->session);
+	free_hosts(env, &cursor->hosts);
+	free(cursor);
+	if(res < 0) {
+		sprintf(err, "fs_closedir: %s", strerror(error));
+		(*env)->ThrowNew(env, IOException, err);
+	}
+}
 
-		// Create BlockLocation for this block
-		blockLocation = (*env)->NewObject(env, BlockLocation, BlockLocation_init, names, hosts, offset, length);
+// [GenericInputStream] void open0(long session, Path path) throws FileNotFoundException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_open0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	int flag = O_RDONLY;
+	jint fd = -1;
 
-		// Add BlockLocation to array
-		(*env)->SetObjectArrayElement(env, blockLocations, z, blockLocation);
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return;
 
-		// Next BlockLocation array position
-		z++;
+	// Open file through Expand library
+	fd = fs_open(session->fs, path, flag);
+	if(fd < 0) {
+		sprintf(err, "fs_open: %s", strerror(errno));
+		(*env)->ThrowNew(env, FileNotFoundException, err);
+		return;
 	}
 
-	// Free resources
-	for(i = 0; i < tblks; i++) {
-		for(j = 0; j < replication; j++) {
-			free(urls[i][j]);
-		}
-		free(urls[i]);
-	}
-	free(urls);
+	// Save fd field to keep value in calling object
+	(*env)->SetIntField(env, obj, GenericInputStream_fd, fd);
 
-	return blockLocations;
+	return;
 }
 
-// #### ##    ## ########  ##     ## ########
-//  ##  ###   ## ##     ## ##     ##    ##
-//  ##  ####  ## ##     ## ##     ##    ##
-//  ##  ## ## ## ########  ##     ##    ##
-//  ##  ##  #### ##        ##     ##    ##
-//  ##  ##   ### ##        ##     ##    ##
-// #### ##    ## ##         #######     ##
-
-// [GenericInputStream] void open0(Path path) throws FileNotFoundException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_open0(JNIEnv *env, jobject obj, jobject jpath) {
+// [GenericInputStream] void openWithStatus0(long session, Path path) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_openWithStatus0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
 	char path[PATH_MAX], err[ERR_MAX];
-	int flag = O_RDONLY;
+	struct stat statbuf;
 	jint fd = -1;
 
-	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return;
+	// Translate Hadoop path to filesystem path (only once)
+	if(translatePath(env, session, jpath, path)) return;
 
 	// Open file through Expand library
-	fd = fs_open(path, flag);
+	fd = fs_open(session->fs, path, O_RDONLY);
 	if(fd < 0) {
 		sprintf(err, "fs_open: %s", strerror(errno));
 		(*env)->ThrowNew(env, FileNotFoundException, err);
 		return;
 	}
 
-	// Save fd field to keep value in calling object
+	// Stat descriptor (or path, if the backend cannot stat descriptors)
+	if(fs_fstat(session->fs, fd, &statbuf) && (errno != ENOSYS || fs_stat(session->fs, path, &statbuf))) {
+		sprintf(err, "fs_fstat: %s", strerror(errno));
+		fs_close(session->fs, fd);
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+
+	// If file is directory, throw exception
+	if(S_ISDIR(statbuf.st_mode)) {
+		fs_close(session->fs, fd);
+		(*env)->ThrowNew(env, FileNotFoundException, "open() cannot open directories");
+		return;
+	}
+
+	// Save fd and length fields to keep values in calling object
 	(*env)->SetIntField(env, obj, GenericInputStream_fd, fd);
+	(*env)->SetLongField(env, obj, GenericInputStream_fileLength, (jlong) statbuf.st_size);
 
 	return;
 }
 
-// [GenericInputStream] int read0() throws IOException
-JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_read0(JNIEnv *env, jobject obj) {
+// [GenericInputStream] int readBytes(long session, byte b[], int off, int len) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_readBytes(JNIEnv *env, jobject obj, jlong jsession, jbyteArray jbuffer, jint off, jint len) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
-	unsigned char buffer = 0;
 	jint res = -1, fd = -1;
+	jbyte *buffer;
+
+	// Stream buffers may be large, keep them off the stack
+	buffer = session_alloc(session, len);
+	if(!buffer) {
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
 
 	// Retrieve fd field from calling object
 	fd = (*env)->GetIntField(env, obj, GenericInputStream_fd);
 
 	// Read file through Expand library
-	res = fs_read(fd, &buffer, 1);
-	if(res == 0) return -1; // EOF
+	res = fs_read(session->fs, fd, buffer, len);
+	if(res == 0) {
+		session_free(session, buffer, len);
+		return -1; // EOF
+	}
 	else if(res < 0) {
 		sprintf(err, "fs_read: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
+		session_free(session, buffer, len);
 		return -1;
 	}
-	else return buffer;
+
+	// If at least a byte was read, save result array
+	(*env)->SetByteArrayRegion(env, jbuffer, off, res, buffer);
+	__sync_fetch_and_add(&session->bytes_read, (long long) res);
+	session_free(session, buffer, len);
+
+	return res;
 }
 
-// [GenericInputStream] int readBytes(byte b[], int off, int len) throws IOException
-JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_readBytes(JNIEnv *env, jobject obj, jbyteArray jbuffer, jint off, jint len) {
+// [GenericInputStream] static int preadReplica0(long session, int fd, int replica, long position, byte b[], int off, int len) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_preadReplica0(JNIEnv *env, jclass cls, jlong jsession, jint fd, jint replica, jlong position, jbyteArray jbuffer, jint off, jint len) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
-	jint res = -1, fd = -1;
-	jbyte buffer[len];
+	jbyte *buffer;
+	ssize_t res = -1;
 
-	// Retrieve fd field from calling object
-	fd = (*env)->GetIntField(env, obj, GenericInputStream_fd);
+	// Positional reads may be large and run concurrently, keep them off the stack
+	buffer = session_alloc(session, len);
+	if(!buffer) {
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
 
-	// Read file through Expand library
-	res = fs_read(fd, buffer, len);
-	if(res == 0) return -1; // EOF
+	// Read file through Expand library without moving the file pointer
+	if(replica < 0) res = fs_pread(session->fs, fd, buffer, len, position);
+	else res = fs_pread_replica(session->fs, fd, replica, buffer, len, position);
+	if(res == 0) {
+		session_free(session, buffer, len);
+		return -1; // EOF
+	}
 	else if(res < 0) {
-		sprintf(err, "fs_read: %s", strerror(errno));
+		sprintf(err, "%s: %s", replica < 0 ? "fs_pread" : "fs_pread_replica", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
+		session_free(session, buffer, len);
 		return -1;
 	}
 
 	// If at least a byte was read, save result array
 	(*env)->SetByteArrayRegion(env, jbuffer, off, res, buffer);
+	__sync_fetch_and_add(&session->bytes_read, (long long) res);
+	session_free(session, buffer, len);
 
-	return res;
+	return (jint) res;
+}
+
+// [GenericInputStream] static int pread0(long session, int fd, long position, byte b[], int off, int len) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_pread0(JNIEnv *env, jclass cls, jlong jsession, jint fd, jlong position, jbyteArray jbuffer, jint off, jint len) {
+
+	// Any replica, as the backend sees fit
+	return Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_preadReplica0(env, cls, jsession, fd, -1, position, jbuffer, off, len);
 }
 
-// [GenericInputStream] void seek0(long pos) throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_seek0(JNIEnv *env, jobject obj, jlong pos) {
+// [GenericInputStream] static void fadvise0(long session, int fd, long offset, long len, int policy) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_fadvise0(JNIEnv *env, jclass cls, jlong jsession, jint fd, jlong offset, jlong len, jint policy) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
-	jint res = -1, fd = -1;
+	int advice;
+
+	// Read policies map to POSIX advice (see GenericReadPolicy)
+	switch(policy) {
+		case 1:
+			advice = POSIX_FADV_SEQUENTIAL;
+			break;
+		case 2:
+			advice = POSIX_FADV_RANDOM;
+			break;
+		default:
+			advice = POSIX_FADV_NORMAL;
+	}
+
+	// Advise filesystem through Expand library (backends may not take advice)
+	if(fs_fadvise(session->fs, fd, offset, len, advice) && errno != ENOSYS) {
+		sprintf(err, "fs_fadvise: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+
+	return;
+}
+
+// [GenericInputStream] static int replicas0(long session, Path path) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_replicas0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	int res = -1;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return -1;
+
+	// Get number of replicas through Expand library
+	res = fs_replication(session->fs, path);
+	if(res == -1) {
+		sprintf(err, "fs_replication: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return -1;
+	}
+
+	return (jint) res;
+}
+
+// [GenericInputStream] void seek0(long session, long pos) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_seek0(JNIEnv *env, jobject obj, jlong jsession, jlong pos) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+	jint fd = -1;
+	off_t res = -1;
 
 	// Retrieve fd field from calling object
 	fd = (*env)->GetIntField(env, obj, GenericInputStream_fd);
 
-	// Change current file pointer position through Expand library
-	res = fs_lseek(fd, pos, SEEK_SET);
+	// Change current file pointer position through Expand library (offsets
+	// beyond 2 GiB do not fit a jint)
+	res = fs_lseek(session->fs, fd, pos, SEEK_SET);
 	if(res != pos) {
 		sprintf(err, "fs_lseek: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
@@ -1006,8 +3256,20 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	return;
 }
 
-// [GenericInputStream] void close0() throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_close0(JNIEnv *env, jobject obj) {
+// [GenericInputStream] static void version0(long session, int fd, Path path, long[] version) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_version0(JNIEnv *env, jclass cls, jlong jsession, jint fd, jobject jpath, jlongArray jversion) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX];
+
+	// Translate Hadoop path to filesystem path (only used without fs_fstat)
+	if(translatePath(env, session, jpath, path)) return;
+
+	getVersion(env, session, fd, path, jversion);
+}
+
+// [GenericInputStream] void close0(long session) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericInputStream_close0(JNIEnv *env, jobject obj, jlong jsession) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
 	jint fd = -1;
 
@@ -1015,7 +3277,7 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	fd = (*env)->GetIntField(env, obj, GenericInputStream_fd);
 
 	// Close file through Expand library
-	if(fs_close(fd)) {
+	if(fs_close(session->fs, fd)) {
 		sprintf(err, "fs_close: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
 		return;
@@ -1027,6 +3289,45 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	return;
 }
 
+// [GenericHandleCache] static int open0(long session, Path path, long[] version) throws IOException
+JNIEXPORT jint JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericHandleCache_open0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath, jlongArray jversion) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	jint fd = -1;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return -1;
+
+	// Open file through Expand library
+	fd = fs_open(session->fs, path, O_RDONLY);
+	if(fd < 0) {
+		sprintf(err, "fs_open: %s", strerror(errno));
+		(*env)->ThrowNew(env, FileNotFoundException, err);
+		return -1;
+	}
+
+	// Handles are cached under the version actually opened
+	if(getVersion(env, session, fd, path, jversion)) {
+		fs_close(session->fs, fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// [GenericHandleCache] static void close0(long session, int fd) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericHandleCache_close0(JNIEnv *env, jclass cls, jlong jsession, jint fd) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+
+	// Close file through Expand library
+	if(fs_close(session->fs, fd)) {
+		sprintf(err, "fs_close: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+}
+
 //  #######  ##     ## ######## ########  ##     ## ########
 // ##     ## ##     ##    ##    ##     ## ##     ##    ##
 // ##     ## ##     ##    ##    ##     ## ##     ##    ##
@@ -1035,8 +3336,9 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 // ##     ## ##     ##    ##    ##        ##     ##    ##
 //  #######   #######     ##    ##         #######     ##
 
-// [GenericOutputStream] void open0(Path path) throws FileNotFoundException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_open0(JNIEnv *env, jobject obj, jobject jpath) {
+// [GenericOutputStream] void open0(long session, Path path) throws FileNotFoundException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_open0(JNIEnv *env, jobject obj, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
 	char path[PATH_MAX], err[ERR_MAX];
 	int flags = O_WRONLY;
 	jint fd = -1;
@@ -1044,7 +3346,7 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	jboolean overwrite = JNI_FALSE, append = JNI_FALSE;
 
 	// Translate Hadoop path to filesystem path
-	if(translatePath(env, jpath, path)) return;
+	if(translatePath(env, session, jpath, path)) return;
 
 	append = (*env)->GetBooleanField(env, obj, GenericOutputStream_append);
 
@@ -1065,7 +3367,7 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	else flags |= O_APPEND;
 
 	// Open file through Expand library
-	fd = fs_open(path, flags, permission);
+	fd = fs_open(session->fs, path, flags, permission);
 	if(fd < 0) {
 		sprintf(err, "fs_open: %s", strerror(errno));
 		if(overwrite || append) (*env)->ThrowNew(env, FileNotFoundException, err);
@@ -1079,19 +3381,57 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	return;
 }
 
-// [GenericOutputStream] void write0(byte b) throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_write0(JNIEnv *env, jobject obj, jint jbuffer) {
+// [GenericOutputStream] void writeBytes(long session, byte b[], int off, int len) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_writeBytes(JNIEnv *env, jobject obj, jlong jsession, jbyteArray jbuffer, jint off, jint len) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
-	unsigned char buffer = jbuffer;
-	jint res = -1, fd = -1;
+	jbyte *buffer;
+	jint res = -1, count = 0, left = len, fd = -1;
+
+	// Stream buffers may be large, keep them off the stack
+	buffer = session_alloc(session, len);
+	if(!buffer) {
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+
+	// Convert byte array object to byte array
+	(*env)->GetByteArrayRegion(env, jbuffer, off, len, buffer);
+
+	// Retrieve fd field from calling object
+	fd = (*env)->GetIntField(env, obj, GenericOutputStream_fd);
+
+	// Write file through Expand library (a whole buffer per call, if it can)
+	while(left > 0) {
+		res = fs_write(session->fs, fd, buffer + count, left);
+		if(res <= 0) {
+			sprintf(err, "fs_write: %s", strerror(res < 0 ? errno : EIO));
+			(*env)->ThrowNew(env, IOException, err);
+			session_free(session, buffer, len);
+			return;
+		}
+		count += res;
+		left -= res;
+	}
+	__sync_fetch_and_add(&session->bytes_written, (long long) len);
+	session_free(session, buffer, len);
+
+	return;
+}
+
+// [GenericOutputStream] void skip0(long session, long len) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_skip0(JNIEnv *env, jobject obj, jlong jsession, jlong len) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+	jint fd = -1;
 
 	// Retrieve fd field from calling object
 	fd = (*env)->GetIntField(env, obj, GenericOutputStream_fd);
 
-	// Write file through Expand library
-	res = fs_write(fd, &buffer, 1);
-	if(res < 1) {
-		sprintf(err, "fs_write: %s", strerror(errno));
+	// Move on through Expand library, bytes left behind are a hole
+	if(fs_lseek(session->fs, fd, (off_t) len, SEEK_CUR) < 0) {
+		sprintf(err, "fs_lseek: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
 		return;
 	}
@@ -1099,42 +3439,142 @@ JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_Generi
 	return;
 }
 
-// [GenericOutputStream] void writeBytes(byte b[], int off, int len) throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_writeBytes(JNIEnv *env, jobject obj, jbyteArray jbuffer, jint off, jint len) {
+// [GenericOutputStream] boolean fallocate0(long session, long offset, long len) throws IOException
+JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_fallocate0(JNIEnv *env, jobject obj, jlong jsession, jlong offset, jlong len) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
-	jbyte buffer[len];
-	jint res = -1, count = 0, left = len, fd = -1;
-
-	// Convert byte array object to byte array
-	(*env)->GetByteArrayRegion(env, jbuffer, off, len, buffer);
+	jint fd = -1;
 
 	// Retrieve fd field from calling object
 	fd = (*env)->GetIntField(env, obj, GenericOutputStream_fd);
 
-	// Write file through Expand library
-	while(res = fs_write(fd, buffer + count, left)) {
-		if(res < 0) {
-			sprintf(err, "fs_write: %s", strerror(errno));
+	// Reserve storage through Expand library (backends may not implement it, and
+	// a lack of space to reserve ahead does not mean the writes will not fit)
+	if(fs_fallocate(session->fs, fd, (off_t) offset, (off_t) len)) {
+		if(errno == ENOSYS || errno == EOPNOTSUPP || errno == ENOSPC) return JNI_FALSE;
+		sprintf(err, "fs_fallocate: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return JNI_FALSE;
+	}
+
+	return JNI_TRUE;
+}
+
+// [GenericOutputStream] static void pwrite0(long session, int fd, long position, byte b[], int off, int len) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_pwrite0(JNIEnv *env, jclass cls, jlong jsession, jint fd, jlong position, jbyteArray jbuffer, jint off, jint len) {
+	struct session *session = getSession(jsession);
+	char err[ERR_MAX];
+	jbyte *buffer;
+	ssize_t res = -1;
+	jint count = 0;
+
+	// Stripes are large and written concurrently, keep them off the stack
+	buffer = session_alloc(session, len);
+	if(!buffer) {
+		sprintf(err, "malloc: %s", strerror(ENOMEM));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+
+	// Convert byte array object to byte array
+	(*env)->GetByteArrayRegion(env, jbuffer, off, len, buffer);
+
+	// Write file through Expand library without moving the file pointer
+	while(count < len) {
+		res = fs_pwrite(session->fs, fd, buffer + count, len - count, position + count);
+		if(res <= 0) {
+			sprintf(err, "fs_pwrite: %s", strerror(res < 0 ? errno : EIO));
 			(*env)->ThrowNew(env, IOException, err);
+			session_free(session, buffer, len);
 			return;
 		}
 		count += res;
-		left -= res;
+	}
+	__sync_fetch_and_add(&session->bytes_written, (long long) len);
+	session_free(session, buffer, len);
+
+	return;
+}
+
+// [GenericOutputStream] static void commit0(long session, Path src, Path dst) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_commit0(JNIEnv *env, jclass cls, jlong jsession, jobject jsrc, jobject jdst) {
+	struct session *session = getSession(jsession);
+	char src[PATH_MAX], dst[PATH_MAX], err[ERR_MAX];
+
+	// Translate Hadoop paths to filesystem paths
+	if(translatePath(env, session, jsrc, src)) return;
+	if(translatePath(env, session, jdst, dst)) return;
+
+	// Temporary file takes the place of the final one through Expand library
+	if(fs_rename(session->fs, src, dst)) {
+		sprintf(err, "fs_rename: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
+	}
+
+	return;
+}
+
+// [GenericOutputStream] static void claim0(long session, Path path, short permission) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_claim0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath, jshort permission) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+	int fd;
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return;
+
+	// Empty file holds the name until the temporary file takes its place
+	fd = fs_open(session->fs, path, O_WRONLY | O_CREAT | O_EXCL, permission);
+	if(fd < 0) {
+		sprintf(err, "fs_open: %s", strerror(errno));
+		(*env)->ThrowNew(env, errno == EEXIST ? FileAlreadyExistsException : IOException, err);
+		return;
+	}
+	if(fs_close(session->fs, fd)) {
+		sprintf(err, "fs_close: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+	}
+}
+
+// [GenericOutputStream] static void discard0(long session, Path path) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_discard0(JNIEnv *env, jclass cls, jlong jsession, jobject jpath) {
+	struct session *session = getSession(jsession);
+	char path[PATH_MAX], err[ERR_MAX];
+
+	// Translate Hadoop path to filesystem path
+	if(translatePath(env, session, jpath, path)) return;
+
+	// Remove temporary file through Expand library
+	if(fs_unlink(session->fs, path) && errno != ENOENT) {
+		sprintf(err, "fs_unlink: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		return;
 	}
 
 	return;
 }
 
-// [GenericOutputStream] void close0() throws IOException
-JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_close0(JNIEnv *env, jobject obj) {
+// [GenericOutputStream] void close0(long session, long length) throws IOException
+JNIEXPORT void JNICALL Java_org_apache_hadoop_fs_connector_generic_stream_GenericOutputStream_close0(JNIEnv *env, jobject obj, jlong jsession, jlong length) {
+	struct session *session = getSession(jsession);
 	char err[ERR_MAX];
 	jint fd = -1;
 
 	// Retrieve fd field from calling object
 	fd = (*env)->GetIntField(env, obj, GenericOutputStream_fd);
 
+	// Storage reserved beyond the written bytes is given back (if any)
+	if(length >= 0 && fs_ftruncate(session->fs, fd, (off_t) length) && errno != ENOSYS && errno != EOPNOTSUPP) {
+		sprintf(err, "fs_ftruncate: %s", strerror(errno));
+		(*env)->ThrowNew(env, IOException, err);
+		fs_close(session->fs, fd);
+		(*env)->SetIntField(env, obj, GenericOutputStream_fd, -1);
+		return;
+	}
+
 	// Close file through Expand library
-	if(fs_close(fd)) {
+	if(fs_close(session->fs, fd)) {
 		sprintf(err, "fs_close: %s", strerror(errno));
 		(*env)->ThrowNew(env, IOException, err);
 		return;
@@ -0,0 +1,254 @@
+#include <pthread.h>
+
+#include "crc32c.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+// CRC32C polynomial (reflected)
+#define POLY 0x82f63b78
+
+// Bytes per lane in the interleaved hardware kernel
+#define LANE 8192
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+// Slicing-by-8 tables for the portable kernel
+static uint32_t table[8][256];
+
+// x^(2^n) mod P, used to shift registers over runs of zeros
+static uint32_t x2n_table[64];
+
+// Shift constants for one and two lanes (multiplication and CLMUL forms)
+static uint32_t lane_mul, lane2_mul;
+static uint64_t lane_clmul, lane2_clmul;
+
+static uint32_t crc32c_sw(uint32_t crc, const void *buf, size_t len);
+static uint32_t (*kernel)(uint32_t crc, const void *buf, size_t len) = crc32c_sw;
+static const char *kernel_name = "software";
+
+// ########  ######## ##    ##  ######
+// ##     ## ##       ###   ## ##    ##
+// ##     ## ##       ####  ## ##
+// ##     ## ######   ## ## ##  ######
+// ##     ## ##       ##  ####       ##
+// ##     ## ##       ##   ### ##    ##
+// ########  ##       ##    ##  ######
+
+// Multiplies a and b modulo P (both in reflected representation)
+static uint32_t multmodp(uint32_t a, uint32_t b) {
+	uint32_t m = (uint32_t) 1 << 31, p = 0;
+
+	for(;;) {
+		if(a & m) {
+			p ^= b;
+			if((a & (m - 1)) == 0) break;
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+	}
+
+	return p;
+}
+
+// Computes x^(n * 2^k) mod P
+static uint32_t x2nmodp(uint64_t n, unsigned k) {
+	uint32_t p = (uint32_t) 1 << 31;
+
+	while(n) {
+		if(n & 1) p = multmodp(x2n_table[k & 63], p);
+		n >>= 1;
+		k++;
+	}
+
+	return p;
+}
+
+// ##    ## ######## ########  ##    ## ######## ##        ######
+// ##   ##  ##       ##     ## ###   ## ##       ##       ##    ##
+// ##  ##   ##       ##     ## ####  ## ##       ##       ##
+// #####    ######   ########  ## ## ## ######   ##        ######
+// ##  ##   ##       ##   ##   ##  #### ##       ##             ##
+// ##   ##  ##       ##    ##  ##   ### ##       ##       ##    ##
+// ##    ## ######## ##     ## ##    ## ######## ########  ######
+
+static uint32_t crc32c_sw(uint32_t crc, const void *buf, size_t len) {
+	const unsigned char *next = buf;
+
+	// Align to 8 bytes
+	while(len && ((uintptr_t) next & 7)) {
+		crc = table[0][(crc ^ *next++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+
+	// Process 8 bytes per iteration
+	while(len >= 8) {
+		uint64_t word = *(const uint64_t *) next ^ crc;
+		crc = table[7][word & 0xff] ^
+			table[6][(word >> 8) & 0xff] ^
+			table[5][(word >> 16) & 0xff] ^
+			table[4][(word >> 24) & 0xff] ^
+			table[3][(word >> 32) & 0xff] ^
+			table[2][(word >> 40) & 0xff] ^
+			table[1][(word >> 48) & 0xff] ^
+			table[0][word >> 56];
+		next += 8;
+		len -= 8;
+	}
+
+	// Tail
+	while(len--) crc = table[0][(crc ^ *next++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw_serial(uint32_t crc, const unsigned char *next, size_t len) {
+	uint64_t crc0 = crc;
+
+	while(len && ((uintptr_t) next & 7)) {
+		crc0 = _mm_crc32_u8((uint32_t) crc0, *next++);
+		len--;
+	}
+	while(len >= 8) {
+		crc0 = _mm_crc32_u64(crc0, *(const uint64_t *) next);
+		next += 8;
+		len -= 8;
+	}
+	while(len--) crc0 = _mm_crc32_u8((uint32_t) crc0, *next++);
+
+	return (uint32_t) crc0;
+}
+
+// Three independent lanes hide the latency of the crc32 instruction. Lanes are
+// merged by shifting the earlier ones over the later ones.
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *buf, size_t len) {
+	const unsigned char *next = buf;
+
+	while(len >= 3 * LANE) {
+		uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+		const unsigned char *end = next + LANE;
+
+		do {
+			crc0 = _mm_crc32_u64(crc0, *(const uint64_t *) next);
+			crc1 = _mm_crc32_u64(crc1, *(const uint64_t *) (next + LANE));
+			crc2 = _mm_crc32_u64(crc2, *(const uint64_t *) (next + 2 * LANE));
+			next += 8;
+		} while(next < end);
+
+		crc = multmodp(lane2_mul, (uint32_t) crc0) ^ multmodp(lane_mul, (uint32_t) crc1) ^ (uint32_t) crc2;
+		next += 2 * LANE;
+		len -= 3 * LANE;
+	}
+
+	return crc32c_hw_serial(crc, next, len);
+}
+
+// Same as above, but lanes are merged with a carry-less multiplication
+// followed by a crc32 reduction instead of the bitwise multmodp loop
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32c_shift_clmul(uint32_t crc, uint64_t k) {
+	__m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc), _mm_cvtsi64_si128(k), 0);
+	return _mm_crc32_u64(0, (uint64_t) _mm_cvtsi128_si64(product));
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32c_sse42_pclmul(uint32_t crc, const void *buf, size_t len) {
+	const unsigned char *next = buf;
+
+	while(len >= 3 * LANE) {
+		uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+		const unsigned char *end = next + LANE;
+
+		do {
+			crc0 = _mm_crc32_u64(crc0, *(const uint64_t *) next);
+			crc1 = _mm_crc32_u64(crc1, *(const uint64_t *) (next + LANE));
+			crc2 = _mm_crc32_u64(crc2, *(const uint64_t *) (next + 2 * LANE));
+			next += 8;
+		} while(next < end);
+
+		crc = crc32c_shift_clmul((uint32_t) crc0, lane2_clmul) ^ crc32c_shift_clmul((uint32_t) crc1, lane_clmul) ^ (uint32_t) crc2;
+		next += 2 * LANE;
+		len -= 3 * LANE;
+	}
+
+	return crc32c_hw_serial(crc, next, len);
+}
+
+#endif
+
+// ########  ##     ## ########  ##       ####  ######
+// ##     ## ##     ## ##     ## ##        ##  ##    ##
+// ##     ## ##     ## ##     ## ##        ##  ##
+// ########  ##     ## ########  ##        ##  ##
+// ##        ##     ## ##     ## ##        ##  ##
+// ##        ##     ## ##     ## ##        ##  ##    ##
+// ##         #######  ########  ######## ####  ######
+
+static void crc32c_setup() {
+	uint32_t crc, p;
+	int i, j;
+
+	// Portable tables
+	for(i = 0; i < 256; i++) {
+		crc = i;
+		for(j = 0; j < 8; j++) crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+		table[0][i] = crc;
+	}
+	for(i = 0; i < 256; i++) {
+		crc = table[0][i];
+		for(j = 1; j < 8; j++) {
+			crc = table[0][crc & 0xff] ^ (crc >> 8);
+			table[j][i] = crc;
+		}
+	}
+
+	// Powers of x used for shifting (x^1, x^2, x^4, ...)
+	p = (uint32_t) 1 << 30;
+	x2n_table[0] = p;
+	for(i = 1; i < 64; i++) x2n_table[i] = p = multmodp(p, p);
+
+	// Lane merge constants
+	lane_mul = x2nmodp(LANE, 3);
+	lane2_mul = x2nmodp(2 * LANE, 3);
+
+	// The CLMUL product is one bit short and the crc32 reduction adds 32 more
+	lane_clmul = x2nmodp(8 * LANE - 33, 0);
+	lane2_clmul = x2nmodp(16 * LANE - 33, 0);
+
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul")) {
+		kernel = crc32c_sse42_pclmul;
+		kernel_name = "sse4.2+pclmul";
+	}
+	else if(__builtin_cpu_supports("sse4.2")) {
+		kernel = crc32c_sse42;
+		kernel_name = "sse4.2";
+	}
+#endif
+}
+
+void crc32c_init() {
+	pthread_once(&once, crc32c_setup);
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len) {
+	crc32c_init();
+	return kernel(crc, buf, len);
+}
+
+uint32_t crc32c_shift(uint32_t crc, uint64_t len) {
+	crc32c_init();
+	return multmodp(x2nmodp(len, 3), crc);
+}
+
+const char *crc32c_kernel() {
+	crc32c_init();
+	return kernel_name;
+}
@@ -0,0 +1,43 @@
+#ifndef UTIL_CRC32C_H
+#define UTIL_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// CRC32C (Castagnoli) helpers
+//
+// All functions work on the raw CRC register, without the initial and final
+// inversions. A standard CRC32C of a buffer is therefore computed as
+// ~crc32c_update(~0, buf, len). Working on raw registers makes the CRC linear,
+// which is what allows independent pieces of a file to be checksummed in
+// parallel and composed later with crc32c_shift.
+//
+
+/*
+ * Selects the fastest kernel supported by the running CPU. It is safe to call
+ * it several times and from several threads.
+ */
+void crc32c_init();
+
+/*
+ * Feeds len bytes from buf into the CRC register crc.
+ * RETURNS the updated CRC register
+ */
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len);
+
+/*
+ * Advances the CRC register crc over len zero bytes, which is the same as
+ * appending len bytes to the data the register was computed from. The CRC of
+ * A || B is crc32c_shift(crc(A), len(B)) ^ crc(B), where crc(B) is computed
+ * from a zero register.
+ * RETURNS the shifted CRC register
+ */
+uint32_t crc32c_shift(uint32_t crc, uint64_t len);
+
+/*
+ * Name of the kernel chosen by crc32c_init, for logging purposes.
+ */
+const char *crc32c_kernel();
+
+#endif
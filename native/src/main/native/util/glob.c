@@ -0,0 +1,196 @@
+#include <errno.h>
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glob.h"
+
+// Upper bound on the patterns a brace expansion may produce
+#define GLOB_EXPANSIONS_MAX 4096
+
+struct glob_list {
+	char **items;
+	int count;
+	int size;
+};
+
+// Appends item to list, taking ownership of it (freed if it cannot be added)
+static int list_add(struct glob_list *list, char *item) {
+	char **items;
+
+	if(list->count == GLOB_EXPANSIONS_MAX) {
+		free(item);
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Grow array geometrically
+	if(list->count == list->size) {
+		items = realloc(list->items, (list->size ? list->size * 2 : 4) * sizeof(char *));
+		if(!items) {
+			free(item);
+			return -1;
+		}
+		list->items = items;
+		list->size = list->size ? list->size * 2 : 4;
+	}
+
+	list->items[list->count++] = item;
+	return 0;
+}
+
+// Locates the first brace group of s (of len bytes)
+// RETURNS 1 if found, 0 if s has no groups, -1 if a group is not closed
+static int find_group(const char *s, size_t len, size_t *lbrace, size_t *rbrace) {
+	size_t i;
+	int depth = 0;
+
+	for(i = 0; i < len; i++) {
+		if(s[i] == '\\') i++;
+		else if(s[i] == '{') {
+			if(depth++ == 0) *lbrace = i;
+		}
+		else if(s[i] == '}' && depth > 0) {
+			if(--depth == 0) {
+				*rbrace = i;
+				return 1;
+			}
+		}
+	}
+	if(depth == 0) return 0;
+
+	errno = EINVAL;
+	return -1;
+}
+
+// Adds to list every pattern s (of len bytes) expands to
+static int expand(const char *s, size_t len, struct glob_list *list) {
+	size_t lbrace = 0, rbrace = 0, start, i, n;
+	char *buf;
+	int res, depth = 0;
+
+	res = find_group(s, len, &lbrace, &rbrace);
+	if(res < 0) return -1;
+	if(res == 0) {
+		buf = strndup(s, len);
+		return buf ? list_add(list, buf) : -1;
+	}
+
+	// Replace the group by each of its top-level alternatives, in turn
+	for(start = i = lbrace + 1; i <= rbrace; i++) {
+		if(s[i] == '\\' && i + 1 < rbrace) {
+			i++;
+			continue;
+		}
+		if(s[i] == '{') depth++;
+		else if(s[i] == '}' && i < rbrace) depth--;
+		if(i < rbrace && (s[i] != ',' || depth > 0)) continue;
+
+		n = lbrace + (i - start) + (len - rbrace - 1);
+		buf = malloc(n + 1);
+		if(!buf) return -1;
+		memcpy(buf, s, lbrace);
+		memcpy(buf + lbrace, s + start, i - start);
+		memcpy(buf + lbrace + (i - start), s + rbrace + 1, len - rbrace - 1);
+		buf[n] = '\0';
+		res = expand(buf, n, list);
+		free(buf);
+		if(res) return -1;
+		start = i + 1;
+	}
+
+	return 0;
+}
+
+// Copies s (of len bytes) without escaping backslashes
+static char *unescape(const char *s, size_t len) {
+	char *res;
+	size_t i, j;
+
+	res = malloc(len + 1);
+	if(!res) return NULL;
+	for(i = j = 0; i < len; i++) {
+		if(s[i] == '\\' && i + 1 < len) i++;
+		res[j++] = s[i];
+	}
+	res[j] = '\0';
+
+	return res;
+}
+
+int glob_expand(const char *pattern, char ***patterns) {
+	struct glob_list list = { NULL, 0, 0 };
+	size_t i, len = strlen(pattern);
+	int depth = 0, spans = 0, res;
+	char *copy;
+
+	// Look for groups spanning several components
+	for(i = 0; i < len && !spans; i++) {
+		if(pattern[i] == '\\') i++;
+		else if(pattern[i] == '{') depth++;
+		else if(pattern[i] == '}' && depth > 0) depth--;
+		else if(pattern[i] == '/' && depth > 0) spans = 1;
+	}
+
+	if(spans) res = expand(pattern, len, &list);
+	else res = (copy = strdup(pattern)) ? list_add(&list, copy) : -1;
+	if(res) {
+		glob_free_all(list.items, list.count);
+		return -1;
+	}
+
+	*patterns = list.items;
+	return list.count;
+}
+
+int glob_compile(const char *pattern, size_t len, struct glob_component *component) {
+	struct glob_list list = { NULL, 0, 0 };
+	size_t i;
+
+	memset(component, 0, sizeof(struct glob_component));
+
+	// Components without wildcards are compared as plain names
+	component->literal = 1;
+	for(i = 0; i < len; i++) {
+		if(pattern[i] == '\\') i++;
+		else if(strchr("*?[{", pattern[i])) component->literal = 0;
+	}
+	if(component->literal) {
+		component->name = unescape(pattern, len);
+		return component->name ? 0 : -1;
+	}
+
+	// Braces are expanded once here, every other wildcard is left to fnmatch
+	if(expand(pattern, len, &list)) {
+		glob_free_all(list.items, list.count);
+		return -1;
+	}
+	component->alts = list.items;
+	component->nalts = list.count;
+
+	return 0;
+}
+
+int glob_match(const struct glob_component *component, const char *name) {
+	int i;
+
+	if(component->literal) return !strcmp(component->name, name);
+	for(i = 0; i < component->nalts; i++) {
+		if(!fnmatch(component->alts[i], name, 0)) return 1;
+	}
+
+	return 0;
+}
+
+void glob_free(struct glob_component *component) {
+	free(component->name);
+	glob_free_all(component->alts, component->nalts);
+	memset(component, 0, sizeof(struct glob_component));
+}
+
+void glob_free_all(char **patterns, int count) {
+	int i;
+
+	for(i = 0; i < count; i++) free(patterns[i]);
+	free(patterns);
+}
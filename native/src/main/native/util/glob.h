@@ -0,0 +1,46 @@
+#ifndef UTIL_GLOB_H
+#define UTIL_GLOB_H
+
+//
+// Hadoop glob patterns
+//
+// Patterns follow the syntax of FileSystem.globStatus: ? and * match any
+// character and any string, [abc], [a-z] and [^a] match character classes,
+// {a,b} matches any of its comma-separated alternatives (which may contain
+// wildcards, nested groups or slashes) and \ escapes the next character.
+// Matching is done one path component at a time, so that directories can be
+// filtered while they are read.
+//
+
+// Single path component of a pattern
+struct glob_component {
+	int literal;	// Whether the component has no wildcards
+	char *name;	// Unescaped name, for literal components
+	char **alts;	// fnmatch patterns (braces expanded), for the rest
+	int nalts;
+};
+
+/*
+ * Expands every brace group of a pattern, but only if one of them contains a
+ * slash (groups within a component are handled by glob_compile instead).
+ * RETURNS -1 if error (errno set to EINVAL for malformed patterns), or the
+ *         number of patterns stored in *patterns (to be freed by glob_free_all)
+ */
+int glob_expand(const char *pattern, char ***patterns);
+
+/*
+ * Compiles the component of pattern that spans len bytes.
+ * RETURNS -1 if error (errno set to EINVAL for malformed patterns), 0 if not
+ */
+int glob_compile(const char *pattern, size_t len, struct glob_component *component);
+
+/*
+ * RETURNS 1 if name matches the component, 0 if not
+ */
+int glob_match(const struct glob_component *component, const char *name);
+
+void glob_free(struct glob_component *component);
+
+void glob_free_all(char **patterns, int count);
+
+#endif
@@ -0,0 +1,332 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pool.h"
+
+// Helpers wanted by a batch, queued until idle threads take them
+struct pool_call {
+	void (*fn)(void *data, int helper);	// Run by every helper (numbered from 1)
+	void *data;
+	int wanted;	// Helpers not taken yet
+	int taken;
+	int running;
+	struct pool_call *next;
+};
+
+struct pool {
+	pthread_mutex_t lock;
+	pthread_cond_t work;	// Calls queued (or pool stopping)
+	pthread_cond_t done;	// Helper finished
+	struct pool_call *calls;	// Oldest first
+	pthread_t *tids;
+	int threads;	// Size of the pool
+	int started;
+	int idle;
+	int stopping;
+};
+
+static void *pool_helper(void *data) {
+	struct pool *pool = data;
+	struct pool_call *call;
+	int helper;
+
+	pthread_mutex_lock(&pool->lock);
+	for(;;) {
+		while(!pool->calls && !pool->stopping) {
+			pool->idle++;
+			pthread_cond_wait(&pool->work, &pool->lock);
+			pool->idle--;
+		}
+		if(pool->stopping) break;
+
+		// Take a helper slot of the oldest call
+		call = pool->calls;
+		helper = ++call->taken;
+		if(--call->wanted == 0) pool->calls = call->next;
+		call->running++;
+		pthread_mutex_unlock(&pool->lock);
+
+		call->fn(call->data, helper);
+
+		pthread_mutex_lock(&pool->lock);
+		if(--call->running == 0) pthread_cond_broadcast(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+struct pool *pool_create(int threads) {
+	struct pool *pool;
+
+	if(threads < 0) threads = 0;
+	if(!(pool = calloc(1, sizeof(struct pool)))) return NULL;
+	if(threads > 0 && !(pool->tids = malloc(threads * sizeof(pthread_t)))) {
+		free(pool);
+		errno = ENOMEM;
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->threads = threads;
+
+	return pool;
+}
+
+void pool_destroy(struct pool *pool) {
+	int i;
+
+	if(!pool) return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(i = 0; i < pool->started; i++) pthread_join(pool->tids[i], NULL);
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->tids);
+	free(pool);
+}
+
+int pool_threads(struct pool *pool) {
+	int started;
+
+	if(!pool) return 0;
+
+	pthread_mutex_lock(&pool->lock);
+	started = pool->started;
+	pthread_mutex_unlock(&pool->lock);
+
+	return started;
+}
+
+// Runs fn(data, 0) on the calling thread and fn(data, i) on up to helpers
+// threads of the pool, those free before the calling thread is done
+static void pool_call(struct pool *pool, int helpers, void (*fn)(void *data, int helper), void *data) {
+	struct pool_call call, **link;
+	int spare;
+
+	if(!pool || pool->threads == 0 || helpers < 1) {
+		fn(data, 0);
+		return;
+	}
+
+	call.fn = fn;
+	call.data = data;
+	call.wanted = helpers;
+	call.taken = 0;
+	call.running = 0;
+	call.next = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	for(link = &pool->calls; *link; link = &(*link)->next);
+	*link = &call;
+
+	// Start threads lazily, when idle ones cannot serve the whole call
+	for(spare = pool->idle; spare < helpers && pool->started < pool->threads; spare++) {
+		if(pthread_create(&pool->tids[pool->started], NULL, pool_helper, pool)) break;
+		pool->started++;
+	}
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	// Calling thread works too
+	fn(data, 0);
+
+	// Revoke the slots nobody took, then wait for the helpers that did
+	pthread_mutex_lock(&pool->lock);
+	for(link = &pool->calls; *link; link = &(*link)->next) {
+		if(*link == &call) {
+			*link = call.next;
+			break;
+		}
+	}
+	call.wanted = 0;
+	while(call.running > 0) pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+struct pool_loop {
+	pool_task_fn fn;
+	void *arg;
+	size_t ntasks;
+	size_t next;
+};
+
+static void pool_worker(void *data, int helper) {
+	struct pool_loop *loop = data;
+	size_t task;
+
+	// Grab tasks until the loop is exhausted
+	while((task = __sync_fetch_and_add(&loop->next, 1)) < loop->ntasks) {
+		loop->fn(loop->arg, task);
+	}
+}
+
+void pool_run(struct pool *pool, int threads, size_t ntasks, pool_task_fn fn, void *arg) {
+	struct pool_loop loop;
+
+	loop.fn = fn;
+	loop.arg = arg;
+	loop.ntasks = ntasks;
+	loop.next = 0;
+
+	// Never ask for more threads than tasks (the caller is one of them)
+	if(threads > ntasks) threads = (int) ntasks;
+	pool_call(pool, threads - 1, pool_worker, &loop);
+}
+
+// Jobs of a thread: the owner works on the tail, thieves on the head
+struct pool_deque {
+	pthread_mutex_t lock;
+	void **jobs;
+	size_t head;
+	size_t tail;
+	size_t size;
+};
+
+struct pool_steal_ctx {
+	pool_job_fn fn;
+	void *arg;
+	int threads;
+	struct pool_deque *deques;
+	struct pool_worker *workers;
+	long pending;	// Jobs submitted and not finished yet
+};
+
+struct pool_worker {
+	struct pool_steal_ctx *ctx;
+	int id;
+};
+
+static void *pool_take(struct pool_deque *deque, int steal) {
+	void *job = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->head < deque->tail) job = steal ? deque->jobs[deque->head++] : deque->jobs[--deque->tail];
+	if(deque->head == deque->tail) deque->head = deque->tail = 0;
+	pthread_mutex_unlock(&deque->lock);
+
+	return job;
+}
+
+int pool_submit(struct pool_worker *worker, void *job) {
+	struct pool_deque *deque = &worker->ctx->deques[worker->id];
+	void **jobs;
+	size_t size;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->tail == deque->size) {
+
+		// Reuse the room left by thieves before growing
+		if(deque->head > 0) {
+			memmove(deque->jobs, deque->jobs + deque->head, (deque->tail - deque->head) * sizeof(void *));
+			deque->tail -= deque->head;
+			deque->head = 0;
+		}
+		else {
+			size = deque->size ? deque->size * 2 : 64;
+			jobs = realloc(deque->jobs, size * sizeof(void *));
+			if(!jobs) {
+				pthread_mutex_unlock(&deque->lock);
+				errno = ENOMEM;
+				return -1;
+			}
+			deque->jobs = jobs;
+			deque->size = size;
+		}
+	}
+	__sync_fetch_and_add(&worker->ctx->pending, 1);
+	deque->jobs[deque->tail++] = job;
+	pthread_mutex_unlock(&deque->lock);
+
+	return 0;
+}
+
+int pool_worker_id(const struct pool_worker *worker) {
+	return worker->id;
+}
+
+static void pool_thief(struct pool_worker *worker) {
+	struct pool_steal_ctx *ctx = worker->ctx;
+	struct timespec nap = { 0, 50000 };
+	int i, misses = 0;
+	void *job;
+
+	for(;;) {
+
+		// Own jobs first, then anybody else's
+		job = pool_take(&ctx->deques[worker->id], 0);
+		for(i = 1; !job && i < ctx->threads; i++) job = pool_take(&ctx->deques[(worker->id + i) % ctx->threads], 1);
+
+		if(job) {
+			misses = 0;
+			ctx->fn(ctx->arg, job, worker);
+			__sync_sub_and_fetch(&ctx->pending, 1);
+			continue;
+		}
+
+		// Nothing queued: done if nothing is running either, else wait for more
+		if(__sync_fetch_and_add(&ctx->pending, 0) == 0) break;
+		if(++misses < 64) sched_yield();
+		else nanosleep(&nap, NULL);
+	}
+}
+
+static void pool_steal_helper(void *data, int helper) {
+	struct pool_steal_ctx *ctx = data;
+
+	pool_thief(&ctx->workers[helper]);
+}
+
+void pool_steal(struct pool *pool, int threads, void *job, pool_job_fn fn, void *arg) {
+	struct pool_steal_ctx ctx;
+	struct pool_deque single_deque;
+	struct pool_worker single_worker;
+	int i;
+
+	if(threads < 1) threads = 1;
+	ctx.fn = fn;
+	ctx.arg = arg;
+	ctx.pending = 0;
+	ctx.deques = threads > 1 ? calloc(threads, sizeof(struct pool_deque)) : NULL;
+	ctx.workers = threads > 1 ? calloc(threads, sizeof(struct pool_worker)) : NULL;
+
+	// A single thread (or no memory for more) needs no allocations
+	if(!ctx.deques || !ctx.workers) {
+		free(ctx.deques);
+		free(ctx.workers);
+		threads = 1;
+		memset(&single_deque, 0, sizeof(struct pool_deque));
+		ctx.deques = &single_deque;
+		ctx.workers = &single_worker;
+	}
+	ctx.threads = threads;
+	for(i = 0; i < threads; i++) {
+		pthread_mutex_init(&ctx.deques[i].lock, NULL);
+		ctx.workers[i].ctx = &ctx;
+		ctx.workers[i].id = i;
+	}
+
+	// First job goes to the calling thread (inline if it cannot be queued),
+	// then every thread takes part until the jobs it submitted are done
+	if(pool_submit(&ctx.workers[0], job)) fn(arg, job, &ctx.workers[0]);
+	pool_call(pool, threads - 1, pool_steal_helper, &ctx);
+
+	for(i = 0; i < threads; i++) {
+		pthread_mutex_destroy(&ctx.deques[i].lock);
+		free(ctx.deques[i].jobs);
+	}
+	if(ctx.deques != &single_deque) {
+		free(ctx.deques);
+		free(ctx.workers);
+	}
+}
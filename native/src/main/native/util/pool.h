@@ -0,0 +1,87 @@
+#ifndef UTIL_POOL_H
+#define UTIL_POOL_H
+
+#include <stddef.h>
+
+//
+// Helper threads
+//
+// Every backend session has a pool of its own, so that batches of a slow
+// backend only hold back the batches of that backend. Threads are started as
+// batches need them, up to the size of the pool, and then wait for the next
+// batch. A batch never waits for a helper: the calling thread always takes
+// part in it, and helpers that are busy elsewhere are simply not used.
+//
+
+struct pool;
+
+/*
+ * Creates a pool of up to threads helper threads (none is started yet).
+ * RETURNS NULL if error (errno set), or the new pool
+ */
+struct pool *pool_create(int threads);
+
+/*
+ * Stops and joins the threads of a pool and releases it. No batch may be
+ * running on the pool.
+ */
+void pool_destroy(struct pool *pool);
+
+/*
+ * RETURNS the number of helper threads started so far
+ */
+int pool_threads(struct pool *pool);
+
+//
+// Parallel loop helper
+//
+// Native batch operations (checksums, bulk deletes, renames...) run the same
+// function over many independent tasks. Workers never touch the JNIEnv: every
+// JNI conversion is done by the calling thread before and after the loop.
+//
+
+typedef void (*pool_task_fn)(void *arg, size_t task);
+
+/*
+ * Runs fn(arg, i) for every i in [0, ntasks) using up to threads threads of
+ * pool (NULL runs every task inline). The calling thread takes part in the
+ * loop, so a value of 1 runs every task inline. If no helper is free the
+ * calling thread does the work alone.
+ * RETURNS once every task has finished
+ */
+void pool_run(struct pool *pool, int threads, size_t ntasks, pool_task_fn fn, void *arg);
+
+//
+// Work-stealing helper
+//
+// Some operations (tree walks, for instance) discover their work as they go.
+// Every thread keeps its own queue of jobs: it takes the newest one from its
+// queue, which keeps walks depth-first and memory bounded, and when the queue
+// is empty it steals the oldest job of another thread.
+//
+
+struct pool_worker;
+
+typedef void (*pool_job_fn)(void *arg, void *job, struct pool_worker *worker);
+
+/*
+ * Runs fn(arg, job, worker) for job and for every job submitted by fn itself
+ * through pool_submit, using up to threads threads of pool (the calling
+ * thread is one of them).
+ * RETURNS once every job has finished
+ */
+void pool_steal(struct pool *pool, int threads, void *job, pool_job_fn fn, void *arg);
+
+/*
+ * Queues a new job on the queue of the worker running the current one.
+ * RETURNS -1 if error (errno set to ENOMEM), 0 if no error
+ */
+int pool_submit(struct pool_worker *worker, void *job);
+
+/*
+ * RETURNS the index of the thread running worker, between 0 and threads - 1,
+ * so that jobs can keep per-thread results without locking
+ */
+int pool_worker_id(const struct pool_worker *worker);
+
+#endif